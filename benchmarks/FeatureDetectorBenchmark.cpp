@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FeatureDetector.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineF>
+#include <QTextStream>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+constexpr auto defaultIterations = 5;
+constexpr auto defaultSeed = 1234;
+constexpr auto minimumFeatureArea = Nedrysoft::FeatureDetector::DefaultMinimumArea;  //! features this size or smaller are ignored, as in the application
+constexpr auto minimumShapeSize = 120;                  //! the smallest shape, a circle of this size is above the minimum feature area
+constexpr auto missedDistance = 5.0;                    //! a shape whose nearest feature is further than this is missed
+constexpr auto resultsVersion = 2;
+
+/**
+ * @brief       A shape that has been drawn into a synthetic background.
+ */
+struct Shape {
+    QPointF centroid;                                   //! the true centre of the shape
+    double area;                                        //! the approximate area of the shape in px^2
+};
+
+/**
+ * @brief       A generated background and the shapes drawn into it.
+ */
+struct Scene {
+    QString name;                                       //! the name of the scene type
+    cv::Mat image;                                      //! the generated image (3 channel)
+    QList<Shape> shapes;                                //! the ground truth
+};
+
+/**
+ * @brief       Returns a random colour that is bright enough to be separated from the black background.
+ */
+static cv::Scalar randomColour(std::mt19937 &random) {
+    std::uniform_int_distribution<int> channel(64, 255);
+
+    return cv::Scalar(channel(random), channel(random), channel(random));
+}
+
+/**
+ * @brief       Draws a rectangle or circle at a random position that does not overlap an existing shape.
+ *
+ * @returns     true if the shape was placed; otherwise false.
+ */
+static bool placeShape(cv::Mat &image, QList<Shape> &shapes, QList<QRect> &occupied, std::mt19937 &random, bool gradient, bool nested) {
+    std::uniform_int_distribution<int> sizeDistribution(std::max(minimumShapeSize, image.cols/20), std::max(minimumShapeSize+40, image.cols/10));
+    std::uniform_int_distribution<int> typeDistribution(0, 1);
+    auto size = sizeDistribution(random);
+    std::uniform_int_distribution<int> xDistribution(8, image.cols-size-8);
+    std::uniform_int_distribution<int> yDistribution(8, image.rows-size-8);
+
+    for (auto attempt = 0; attempt < 50; attempt++) {
+        auto rect = QRect(xDistribution(random), yDistribution(random), size, size);
+
+        if (std::any_of(occupied.begin(), occupied.end(), [rect](const QRect &other) {
+                return other.adjusted(-8, -8, 8, 8).intersects(rect);
+            })) {
+
+            continue;
+        }
+
+        occupied.append(rect);
+
+        // contour vertices lie on the outermost pixels, so the centre is measured between the first and last pixel
+
+        auto centroid = QPointF(rect.x() + (rect.width() - 1) / 2.0, rect.y() + (rect.height() - 1) / 2.0);
+        auto isCircle = typeDistribution(random) == 1;
+        auto radius = size / 2;
+
+        if (isCircle) {
+            centroid = QPointF(rect.x() + radius, rect.y() + radius);
+        }
+
+        if (gradient) {
+            // fill with a horizontal gradient, every column is bright enough to be part of the shape
+
+            auto from = randomColour(random);
+            auto to = randomColour(random);
+            cv::Mat mask = cv::Mat::zeros(image.size(), CV_8UC1);
+
+            if (isCircle) {
+                cv::circle(mask, cv::Point(centroid.x(), centroid.y()), radius, cv::Scalar(255), cv::FILLED);
+            } else {
+                cv::rectangle(mask, cv::Rect(rect.x(), rect.y(), rect.width(), rect.height()), cv::Scalar(255), cv::FILLED);
+            }
+
+            for (auto x = rect.left(); x <= rect.right(); x++) {
+                auto ratio = static_cast<double>(x - rect.left()) / rect.width();
+                auto colour = from * (1.0 - ratio) + to * ratio;
+
+                image(cv::Rect(x, rect.y(), 1, rect.height())).setTo(colour, mask(cv::Rect(x, rect.y(), 1, rect.height())));
+            }
+        } else if (isCircle) {
+            cv::circle(image, cv::Point(centroid.x(), centroid.y()), radius, randomColour(random), cv::FILLED);
+        } else {
+            cv::rectangle(image, cv::Rect(rect.x(), rect.y(), rect.width(), rect.height()), randomColour(random), cv::FILLED);
+        }
+
+        if ((nested) && (size >= 24)) {
+            // cut a hole and place a smaller shape inside it, all three contours share the same centre
+
+            cv::circle(image, cv::Point(rect.x() + radius, rect.y() + radius), radius / 2, cv::Scalar(0, 0, 0), cv::FILLED);
+            cv::circle(image, cv::Point(rect.x() + radius, rect.y() + radius), radius / 4, randomColour(random), cv::FILLED);
+        }
+
+        shapes.append(Shape{centroid, isCircle ? M_PI * radius * radius : static_cast<double>(size * size)});
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief       Generates a background of the given type.
+ */
+static Scene generateScene(const QString &name, const QSize &size, std::mt19937 &random) {
+    Scene scene;
+    QList<QRect> occupied;
+    auto shapeCount = std::max(4, (size.width() * size.height()) / 160000);
+
+    scene.name = name;
+    scene.image = cv::Mat::zeros(size.height(), size.width(), CV_8UC3);
+
+    for (auto shapeIndex = 0; shapeIndex < shapeCount; shapeIndex++) {
+        placeShape(scene.image, scene.shapes, occupied, random, name=="gradient", name=="nested");
+    }
+
+    if (name=="noise") {
+        // single pixel speckles, these produce contours that are below the minimum feature size
+
+        std::uniform_int_distribution<int> xDistribution(0, size.width() - 1);
+        std::uniform_int_distribution<int> yDistribution(0, size.height() - 1);
+        auto speckles = (size.width() * size.height()) / 500;
+
+        for (auto speckle = 0; speckle < speckles; speckle++) {
+            scene.image.at<cv::Vec3b>(yDistribution(random), xDistribution(random)) = cv::Vec3b(96, 96, 96);
+        }
+    }
+
+    return scene;
+}
+
+/**
+ * @brief       Returns the sum of the stage timings in nanoseconds.
+ */
+static qint64 totalTime(const Nedrysoft::FeatureDetector::Timings &timings) {
+    return timings.tiles + timings.regions + timings.grayscale + timings.threshold + timings.contours + timings.features;
+}
+
+/**
+ * @brief       Converts the stage timings to a json object in milliseconds per iteration.
+ */
+static QJsonObject timingsObject(const Nedrysoft::FeatureDetector::Timings &timings, int iterations) {
+    auto toMilliseconds = [iterations](qint64 nanoseconds) {
+        return static_cast<double>(nanoseconds) / 1e6 / iterations;
+    };
+
+    return QJsonObject {
+        {"tiles", toMilliseconds(timings.tiles)},
+        {"regions", toMilliseconds(timings.regions)},
+        {"grayscale", toMilliseconds(timings.grayscale)},
+        {"threshold", toMilliseconds(timings.threshold)},
+        {"contours", toMilliseconds(timings.contours)},
+        {"features", toMilliseconds(timings.features)},
+        {"total", toMilliseconds(totalTime(timings))}
+    };
+}
+
+/**
+ * @brief       Measures the distance from each ground truth shape to the nearest detected feature.
+ */
+static QJsonObject errorObject(const QList<Shape> &shapes, const QList<Nedrysoft::FeatureDetector::Feature> &features) {
+    double sumError = 0, maximumError = 0;
+    auto matched = 0, missed = 0;
+
+    for (auto const &shape : shapes) {
+        auto closestDistance = std::numeric_limits<double>::max();
+
+        for (auto const &feature : features) {
+            if (feature.area <= minimumFeatureArea) {
+                continue;
+            }
+
+            closestDistance = std::min(closestDistance, QLineF(shape.centroid, feature.centroid).length());
+        }
+
+        if (closestDistance > missedDistance) {
+            missed++;
+            continue;
+        }
+
+        sumError += closestDistance;
+        maximumError = std::max(maximumError, closestDistance);
+        matched++;
+    }
+
+    return QJsonObject {
+        {"shapes", shapes.count()},
+        {"matched", matched},
+        {"missed", missed},
+        {"mean", matched ? sumError / matched : 0.0},
+        {"max", maximumError}
+    };
+}
+
+/**
+ * @brief       Returns the number of features in a that do not have an identical feature in b.
+ */
+static int featureDifference(const QList<Nedrysoft::FeatureDetector::Feature> &a, const QList<Nedrysoft::FeatureDetector::Feature> &b) {
+    auto difference = 0;
+
+    for (auto const &feature : a) {
+        if (std::none_of(b.begin(), b.end(), [feature](const Nedrysoft::FeatureDetector::Feature &other) {
+                return (other.bounds == feature.bounds) && (other.outline == feature.outline);
+            })) {
+
+            difference++;
+        }
+    }
+
+    return difference;
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication application(argc, argv);
+    QCommandLineParser parser;
+
+    QCoreApplication::setApplicationName("FeatureDetectorBenchmark");
+
+    parser.setApplicationDescription("Measures the speed and accuracy of the background feature detector.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption({"o", "output"}, "Write the results to <file> (default is stdout).", "file"));
+    parser.addOption(QCommandLineOption({"i", "iterations"}, "Number of times each scene is processed.", "count", QString::number(defaultIterations)));
+    parser.addOption(QCommandLineOption({"s", "seed"}, "Seed for the scene generator.", "seed", QString::number(defaultSeed)));
+
+    parser.process(application);
+
+    auto iterations = std::max(1, parser.value("iterations").toInt());
+    auto seed = parser.value("seed").toUInt();
+    auto sceneTypes = QStringList() << "shapes" << "noise" << "gradient" << "nested";
+    auto resolutions = QList<QSize>() << QSize(640, 480) << QSize(1280, 960) << QSize(2560, 1920);
+    QJsonArray results;
+
+    std::mt19937 random(seed);
+
+    for (auto const &resolution : resolutions) {
+        for (auto const &sceneType : sceneTypes) {
+            auto scene = generateScene(sceneType, resolution, random);
+            Nedrysoft::FeatureDetector::Timings detectTimings, updateTimings;
+            Nedrysoft::FeatureDetector::Result result;
+
+            for (auto iteration = 0; iteration < iterations; iteration++) {
+                result = Nedrysoft::FeatureDetector::detect(scene.image, Nedrysoft::FeatureDetector::DefaultTileSize, &detectTimings);
+            }
+
+            // simulate an edit in one corner of the background and compare the incremental result with a full
+            // detection of the edited image, they should contain the same features.
+
+            auto editedImage = scene.image.clone();
+            auto editSize = std::min(resolution.width(), resolution.height()) / 8;
+
+            cv::rectangle(editedImage, cv::Rect(resolution.width() - editSize - 4, 4, editSize, editSize), cv::Scalar(200, 200, 200), cv::FILLED);
+
+            Nedrysoft::FeatureDetector::Result updatedResult;
+            QList<QRect> regions;
+
+            for (auto iteration = 0; iteration < iterations; iteration++) {
+                updatedResult = Nedrysoft::FeatureDetector::update(editedImage, result, &regions, &updateTimings);
+            }
+
+            auto fullResult = Nedrysoft::FeatureDetector::detect(editedImage);
+            auto regionArea = 0;
+
+            for (auto const &region : regions) {
+                regionArea += region.width() * region.height();
+            }
+
+            results.append(QJsonObject {
+                {"scene", scene.name},
+                {"width", resolution.width()},
+                {"height", resolution.height()},
+                {"features", result.features.count()},
+                {"detect", timingsObject(detectTimings, iterations)},
+                {"update", timingsObject(updateTimings, iterations)},
+                {"updateArea", static_cast<double>(regionArea) / (resolution.width() * resolution.height())},
+                {"updateDifference", featureDifference(updatedResult.features, fullResult.features) + featureDifference(fullResult.features, updatedResult.features)},
+                {"error", errorObject(scene.shapes, result.features)}
+            });
+
+            QTextStream(stderr) << QString("%1 %2x%3: detect %4 ms, update %5 ms\n")
+                    .arg(scene.name, -10)
+                    .arg(resolution.width())
+                    .arg(resolution.height())
+                    .arg(static_cast<double>(totalTime(detectTimings)) / 1e6 / iterations, 0, 'f', 2)
+                    .arg(static_cast<double>(totalTime(updateTimings)) / 1e6 / iterations, 0, 'f', 2);
+        }
+    }
+
+    auto document = QJsonDocument(QJsonObject {
+        {"version", resultsVersion},
+        {"iterations", iterations},
+        {"seed", static_cast<qint64>(seed)},
+        {"results", results}
+    });
+
+    if (parser.isSet("output")) {
+        QFile outputFile(parser.value("output"));
+
+        if (!outputFile.open(QFile::WriteOnly)) {
+            QTextStream(stderr) << QString("unable to write to %1\n").arg(parser.value("output"));
+
+            return 1;
+        }
+
+        outputFile.write(document.toJson());
+    } else {
+        QTextStream(stdout) << document.toJson();
+    }
+
+    return 0;
+}
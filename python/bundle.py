@@ -0,0 +1,107 @@
+#
+# Copyright (C) 2020 Adrian Carpenter
+#
+# This file is part of dmgee
+#
+# Created by Adrian Carpenter on 18/10/2026.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Compiles the vendored packages to bytecode and stores them in a single zip archive that is embedded in dmgee.
+#
+# Only the bytecode is stored, using the legacy .pyc layout that zipimport expects, the .pyc files use unchecked
+# hashes so that they never refer to the source.  Entries are written in a fixed order with a fixed timestamp so
+# the same sources always give the same archive.  The archive comment holds the bytecode magic number, dmgee only
+# uses the archive if the magic matches the interpreter that it is linked with.
+#
+# usage: bundle.py <output.zip> <package folder> [<package folder> ...]
+
+import importlib.util
+import os
+import py_compile
+import sys
+import tempfile
+import zipfile
+
+archiveTimestamp = (1980, 1, 1, 0, 0, 0)
+excludedFolders = ('__pycache__', 'tests')
+excludedExtensions = ('.pyc', '.pyo')
+
+
+def packageFolders(distributionFolder):
+    # each distribution folder (e.g. dmgbuild-1.4.2) contains the package alongside the setup files
+
+    for name in sorted(os.listdir(distributionFolder)):
+        path = os.path.join(distributionFolder, name)
+
+        if os.path.isfile(os.path.join(path, '__init__.py')):
+            yield path
+
+
+def packageFiles(packageFolder):
+    for folder, folders, files in os.walk(packageFolder):
+        folders[:] = sorted(name for name in folders if name not in excludedFolders and not name.startswith('.'))
+
+        for name in sorted(files):
+            if name.startswith('.') or name.endswith(excludedExtensions):
+                continue
+
+            yield os.path.join(folder, name)
+
+
+def addEntry(archive, name, data):
+    entry = zipfile.ZipInfo(name, archiveTimestamp)
+
+    entry.compress_type = zipfile.ZIP_DEFLATED
+    entry.external_attr = 0o644 << 16
+
+    archive.writestr(entry, data)
+
+
+def bundle(outputFilename, distributionFolders):
+    temporaryFilename = outputFilename + '.tmp'
+
+    with tempfile.TemporaryDirectory() as workFolder, zipfile.ZipFile(temporaryFilename, 'w') as archive:
+        for distributionFolder in distributionFolders:
+            for packageFolder in packageFolders(distributionFolder):
+                root = os.path.dirname(packageFolder)
+
+                for filename in packageFiles(packageFolder):
+                    name = os.path.relpath(filename, root).replace(os.sep, '/')
+
+                    if not filename.endswith('.py'):
+                        with open(filename, 'rb') as file:
+                            addEntry(archive, name, file.read())
+
+                        continue
+
+                    compiledFilename = os.path.join(workFolder, 'module.pyc')
+
+                    py_compile.compile(filename, cfile=compiledFilename, dfile=name, doraise=True,
+                                       invalidation_mode=py_compile.PycInvalidationMode.UNCHECKED_HASH)
+
+                    with open(compiledFilename, 'rb') as file:
+                        addEntry(archive, name + 'c', file.read())
+
+        archive.comment = importlib.util.MAGIC_NUMBER.hex().encode('ascii')
+
+    os.replace(temporaryFilename, outputFilename)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.exit('usage: bundle.py <output.zip> <package folder> [<package folder> ...]')
+
+    bundle(sys.argv[1], sys.argv[2:])
@@ -2,7 +2,7 @@
 from __future__ import unicode_literals
 
 import os
-import pkg_resources
+import pkgutil
 import platform
 import re
 import shutil
@@ -59,6 +59,14 @@ MACOS_VERSION = tuple(int(v) for v in platform.mac_ver()[0].split('.'))
 class DMGError(Exception):
     pass
 
+def builtin_background(name):
+    # pkgutil reads the resource through the module loader, so this also works
+    # when dmgbuild is imported from a zip archive
+    try:
+        return pkgutil.get_data('dmgbuild', 'resources/' + name + '.tiff')
+    except (IOError, OSError):
+        return None
+
 def hdiutil(cmd, *args, **kwargs):
     plist = kwargs.get('plist', True)
     all_args = ['/usr/bin/hdiutil', cmd]
@@ -156,7 +164,18 @@ def load_json(filename, settings):
     settings['icon_locations'] = icon_locations
 
 def build_dmg(filename, volume_name, settings_file=None, settings={},
-              defines={}, lookForHiDPI=True, detach_retries=5):
+              defines={}, lookForHiDPI=True, detach_retries=5, callback=None):
+    def notify(event_type, operation=None, **kwargs):
+        if callback is None:
+            return
+        event = {'type': event_type}
+        if operation is not None:
+            event['operation'] = operation
+        event.update(kwargs)
+        callback(event)
+
+    notify('build::started')
+
     options = {
         # Default settings
         'filename': filename,
@@ -227,6 +246,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
         }
 
     # Execute the settings file
+    notify('operation::start', 'settings::load')
+
     if settings_file:
         # We now support JSON settings files using appdmg's format
         if settings_file.endswith('.json'):
@@ -403,6 +424,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
 
     total_size = options['size']
     if total_size == None:
+        notify('operation::start', 'size::calculate')
+
         # Start with a size of 128MB - this way we don't need to calculate the
         # size of the background image, volume icon, and .DS_Store file (and
         # 128 MB should be well sufficient for even the most outlandish image
@@ -429,6 +452,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
 
         total_size = str(max(total_size / 1000, 1024)) + 'K'
 
+    notify('operation::start', 'dmg::create')
+
     ret, output = hdiutil('create',
                           '-ov',
                           '-volname', volume_name,
@@ -479,6 +504,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
 
         background_bmk = None
 
+        notify('operation::start', 'background::create')
+
         if not isinstance(background, (str, unicode)):
             pass
         elif colors.isAColor(background):
@@ -528,16 +555,16 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
                 _, kind = os.path.splitext(background)
                 path_in_image = os.path.join(mount_point, '.background' + kind)
                 shutil.copyfile(background, path_in_image)
-            elif pkg_resources.resource_exists('dmgbuild', 'resources/' + background + '.tiff'):
-                tiffdata = pkg_resources.resource_string(
-                    'dmgbuild',
-                    'resources/' + background + '.tiff')
+            else:
+                tiffdata = builtin_background(background)
+
+                if tiffdata is None:
+                    raise ValueError('background file "%s" not found' % background)
+
                 path_in_image = os.path.join(mount_point, '.background.tiff')
 
                 with open(path_in_image, 'wb') as f:
                     f.write(tiffdata)
-            else:
-                raise ValueError('background file "%s" not found' % background)
 
             alias = Alias.for_file(path_in_image)
             background_bmk = Bookmark.for_file(path_in_image)
@@ -545,6 +572,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
             icvp['backgroundType'] = 2
             icvp['backgroundImageAlias'] = plist_bytes(alias.to_bytes())
 
+        notify('operation::start', 'files::add', count=len(options['files']))
+
         for f in options['files']:
             if isinstance(f, tuple):
                 f_in_image = os.path.join(mount_point, f[1])
@@ -553,13 +582,20 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
                 basename = os.path.basename(f.rstrip('/'))
                 f_in_image = os.path.join(mount_point, basename)
 
+            notify('operation::start', 'file::add', file=f)
+
             # use system ditto command to preserve code signing, etc.
             subprocess.call(['/usr/bin/ditto', f, f_in_image])
 
+        notify('operation::start', 'symlinks::add', count=len(options['symlinks']))
+
         for name,target in iteritems(options['symlinks']):
             name_in_image = os.path.join(mount_point, name)
+            notify('operation::start', 'symlink::add', file=name, target=target)
             os.symlink(target, name_in_image)
 
+        notify('operation::start', 'extensions::hide')
+
         to_hide = []
         for name in options['hide_extensions']:
             name_in_image = os.path.join(mount_point, name)
@@ -582,6 +618,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
 
         image_dsstore = os.path.join(mount_point, '.DS_Store')
 
+        notify('operation::start', 'dsstore::create')
+
         with DSStore.open(image_dsstore, 'w+') as d:
             d['.']['vSrn'] = ('long', 1)
             d['.']['bwsp'] = bwsp
@@ -614,6 +652,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
         raise DMGError('Unable to detach device cleanly')
 
     # Shrink the output to the minimum possible size
+    notify('operation::start', 'dmg::shrink')
+
     ret, output = hdiutil('resize',
                           '-quiet',
                           '-sectors', 'min',
@@ -642,6 +682,8 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
         raise DMGError('Unable to convert')
 
     if options['license']:
+        notify('operation::start', 'dmg::addlicense')
+
         ret, output = hdiutil('unflatten', '-quiet', filename, plist=False)
 
         if ret:
@@ -653,3 +695,5 @@ def build_dmg(filename, volume_name, settings_file=None, settings={},
 
         if ret:
             raise DMGError('Unable to flatten after adding license')
+
+    notify('build::finished')
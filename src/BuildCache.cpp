@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! @note Python must be included first!
+
+#include "Python.h"
+
+#include "BuildCache.h"
+
+#include <QDataStream>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if defined(Q_OS_MACOS)
+#include <sys/clonefile.h>
+#endif
+
+constexpr quint32 buildCacheIndexMagic = 0x444d4249;                //! "DMBI"
+constexpr quint32 buildCacheIndexVersion = 1;
+constexpr auto buildCacheVersion = "1";                             //! must change if the key calculation changes
+constexpr auto buildCacheFolder = "builds";
+constexpr auto buildCacheIndexFilename = "index";
+constexpr auto buildCacheExtension = ".dmg";
+
+static qint64 nanoseconds(const struct timespec &time) {
+    return (static_cast<qint64>(time.tv_sec)*1000000000LL)+time.tv_nsec;
+}
+
+static void statTimes(const struct stat &fileStat, qint64 &modified, qint64 &changed) {
+#if defined(Q_OS_MACOS)
+    modified = nanoseconds(fileStat.st_mtimespec);
+    changed = nanoseconds(fileStat.st_ctimespec);
+#else
+    modified = nanoseconds(fileStat.st_mtim);
+    changed = nanoseconds(fileStat.st_ctim);
+#endif
+}
+
+Nedrysoft::BuildCache::BuildCache() :
+        m_cacheFolder(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(buildCacheFolder)),
+        m_indexLoaded(false),
+        m_indexModified(false),
+        m_isLinkEnabled(false),
+        m_hashedFiles(0),
+        m_unchangedFiles(0) {
+
+}
+
+QString Nedrysoft::BuildCache::key(const Builder::Manifest &manifest, QStringList *log) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    loadIndex();
+
+    m_hashedFiles = 0;
+    m_unchangedFiles = 0;
+
+    hash.addData(buildCacheVersion);
+    hash.addData(manifest.configuration);
+
+    for (auto const &input : manifest.inputs) {
+        addInput(hash, input, log);
+    }
+
+    saveIndex();
+
+    auto key = QString::fromLatin1(hash.result().toHex());
+
+    if (log) {
+        log->append(QString("cache: manifest %1 (%2 files hashed, %3 files unchanged since they were last hashed).")
+                .arg(key.left(16))
+                .arg(m_hashedFiles)
+                .arg(m_unchangedFiles));
+    }
+
+    return key;
+}
+
+void Nedrysoft::BuildCache::addInput(QCryptographicHash &hash, const QString &filename, QStringList *log) {
+    QStringList names;
+
+    // the input itself is named by its position in the manifest, entries inside a folder are named relative to it
+
+    hash.addData("input\0", 6);
+
+    if (!addEntry(hash, filename, QString())) {
+        if (log) {
+            log->append(QString("cache: input %1 does not exist.").arg(filename));
+        }
+
+        return;
+    }
+
+    if (!QFileInfo(filename).isDir() || QFileInfo(filename).isSymLink()) {
+        return;
+    }
+
+    QDirIterator dirIterator(filename, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    QDir inputDir(filename);
+
+    while (dirIterator.hasNext()) {
+        names.append(inputDir.relativeFilePath(dirIterator.next()));
+    }
+
+    // the order that entries are returned in is not defined, sorting makes the key independent of it
+
+    std::sort(names.begin(), names.end());
+
+    for (auto const &name : names) {
+        addEntry(hash, inputDir.filePath(name), name);
+    }
+}
+
+bool Nedrysoft::BuildCache::addEntry(QCryptographicHash &hash, const QString &filename, const QString &name) {
+    struct stat fileStat;
+    auto nativeFilename = QFile::encodeName(filename);
+
+    if (::lstat(nativeFilename.constData(), &fileStat)!=0) {
+        hash.addData("missing\0", 8);
+
+        return false;
+    }
+
+    auto mode = QByteArray::number(fileStat.st_mode & 07777, 8);
+
+    if (S_ISLNK(fileStat.st_mode)) {
+        hash.addData("L\0", 2);
+        hash.addData(name.toUtf8());
+        hash.addData(QFile::encodeName(QFileInfo(filename).symLinkTarget()));
+    } else if (S_ISDIR(fileStat.st_mode)) {
+        hash.addData("D\0", 2);
+        hash.addData(name.toUtf8());
+        hash.addData(mode);
+    } else {
+        FileState state;
+
+        state.device = static_cast<quint64>(fileStat.st_dev);
+        state.inode = static_cast<quint64>(fileStat.st_ino);
+        state.size = static_cast<qint64>(fileStat.st_size);
+
+        statTimes(fileStat, state.modified, state.changed);
+
+        hash.addData("F\0", 2);
+        hash.addData(name.toUtf8());
+        hash.addData(mode);
+        hash.addData(contentHash(filename, state));
+    }
+
+    hash.addData("\0", 1);
+
+    return true;
+}
+
+QByteArray Nedrysoft::BuildCache::contentHash(const QString &filename, FileState &state) {
+    auto indexIterator = m_index.constFind(filename);
+
+    if (indexIterator!=m_index.constEnd()) {
+        auto const &previous = indexIterator.value();
+
+        if ((previous.device==state.device) && (previous.inode==state.inode) && (previous.size==state.size) &&
+            (previous.modified==state.modified) && (previous.changed==state.changed)) {
+
+            m_unchangedFiles++;
+
+            return previous.hash;
+        }
+    }
+
+    QFile file(filename);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    if ((!file.open(QFile::ReadOnly)) || (!hash.addData(&file))) {
+        return QByteArray();
+    }
+
+    state.hash = hash.result();
+
+    m_index[filename] = state;
+    m_indexModified = true;
+    m_hashedFiles++;
+
+    return state.hash;
+}
+
+void Nedrysoft::BuildCache::loadIndex() {
+    quint32 magic, version, entryCount;
+
+    if (m_indexLoaded) {
+        return;
+    }
+
+    m_indexLoaded = true;
+
+    QFile indexFile(QDir(m_cacheFolder).filePath(buildCacheIndexFilename));
+
+    if (!indexFile.open(QFile::ReadOnly)) {
+        return;
+    }
+
+    QDataStream indexStream(&indexFile);
+
+    indexStream >> magic >> version >> entryCount;
+
+    if ((magic!=buildCacheIndexMagic) || (version!=buildCacheIndexVersion)) {
+        return;
+    }
+
+    for (quint32 entryIndex = 0; (entryIndex<entryCount) && (indexStream.status()==QDataStream::Ok); entryIndex++) {
+        QString filename;
+        FileState state;
+
+        indexStream >> filename >> state.device >> state.inode >> state.size >> state.modified >> state.changed >> state.hash;
+
+        m_index[filename] = state;
+    }
+
+    if (indexStream.status()!=QDataStream::Ok) {
+        m_index.clear();
+    }
+}
+
+void Nedrysoft::BuildCache::saveIndex() {
+    if ((!m_indexModified) || (!QDir().mkpath(m_cacheFolder))) {
+        return;
+    }
+
+    // entries for files that no longer exist are dropped so that the index does not grow forever
+
+    for (auto indexIterator = m_index.begin(); indexIterator!=m_index.end();) {
+        if (!QFileInfo::exists(indexIterator.key())) {
+            indexIterator = m_index.erase(indexIterator);
+        } else {
+            ++indexIterator;
+        }
+    }
+
+    QSaveFile indexFile(QDir(m_cacheFolder).filePath(buildCacheIndexFilename));
+
+    if (!indexFile.open(QFile::WriteOnly)) {
+        return;
+    }
+
+    QDataStream indexStream(&indexFile);
+
+    indexStream << buildCacheIndexMagic << buildCacheIndexVersion << static_cast<quint32>(m_index.count());
+
+    for (auto indexIterator = m_index.constBegin(); indexIterator!=m_index.constEnd(); ++indexIterator) {
+        auto const &state = indexIterator.value();
+
+        indexStream << indexIterator.key() << state.device << state.inode << state.size << state.modified << state.changed << state.hash;
+    }
+
+    if (indexFile.commit()) {
+        m_indexModified = false;
+    }
+}
+
+QString Nedrysoft::BuildCache::entryFilename(const QString &key) const {
+    return QDir(m_cacheFolder).filePath(key+buildCacheExtension);
+}
+
+bool Nedrysoft::BuildCache::fetch(const QString &key, const QString &outputFilename, QStringList *log) const {
+    auto entry = entryFilename(key);
+
+    if (!QFileInfo::exists(entry)) {
+        if (log) {
+            log->append(QString("cache: miss, no image for manifest %1, building.").arg(key.left(16)));
+        }
+
+        return false;
+    }
+
+    if (!QDir().mkpath(QFileInfo(outputFilename).absolutePath())) {
+        if (log) {
+            log->append(QString("cache: unable to create the folder for %1, building.").arg(outputFilename));
+        }
+
+        return false;
+    }
+
+    if (QFileInfo::exists(outputFilename) && (!QFile::remove(outputFilename))) {
+        if (log) {
+            log->append(QString("cache: unable to replace %1, building.").arg(outputFilename));
+        }
+
+        return false;
+    }
+
+    // mark the entry as recently used so that it is the last to be pruned
+
+    ::utimes(QFile::encodeName(entry).constData(), nullptr);
+
+    if (m_isLinkEnabled) {
+        if (::link(QFile::encodeName(entry).constData(), QFile::encodeName(outputFilename).constData())==0) {
+            if (log) {
+                log->append(QString("cache: hit, hard linked the cached image to %1.").arg(outputFilename));
+            }
+
+            return true;
+        }
+
+        if (log) {
+            log->append(QString("cache: unable to hard link the cached image (%1), copying.").arg(QString::fromLocal8Bit(strerror(errno))));
+        }
+    }
+
+    // the output is an independent file so that signing or stapling it in place cannot change the cached image, on
+    // APFS a clone shares the data of the entry until either of them is written.
+
+    auto isCopied = false;
+    auto method = QString("copied");
+
+#if defined(Q_OS_MACOS)
+    if (clonefile(QFile::encodeName(entry).constData(), QFile::encodeName(outputFilename).constData(), CLONE_NOFOLLOW)==0) {
+        isCopied = true;
+        method = "cloned";
+    }
+#endif
+
+    if (!isCopied) {
+        isCopied = QFile::copy(entry, outputFilename);
+    }
+
+    if (isCopied) {
+        QFile::setPermissions(outputFilename, QFile::permissions(outputFilename) | QFile::WriteOwner);
+
+        if (log) {
+            log->append(QString("cache: hit, %1 the cached image to %2.").arg(method).arg(outputFilename));
+        }
+
+        return true;
+    }
+
+    if (log) {
+        log->append(QString("cache: hit, but the cached image could not be copied to %1, building.").arg(outputFilename));
+    }
+
+    return false;
+}
+
+void Nedrysoft::BuildCache::setLinkEnabled(bool isEnabled) {
+    m_isLinkEnabled = isEnabled;
+}
+
+bool Nedrysoft::BuildCache::store(const QString &key, const QString &outputFilename, QStringList *log) const {
+    auto entry = entryFilename(key);
+    auto temporaryEntry = QString("%1.%2.tmp").arg(entry).arg(QCoreApplication::applicationPid());
+
+    if (!QDir().mkpath(m_cacheFolder)) {
+        return false;
+    }
+
+    // the image is copied rather than linked so that later changes to the output can never alter the cache
+
+    QFile::remove(temporaryEntry);
+
+    if (!QFile::copy(outputFilename, temporaryEntry)) {
+        if (log) {
+            log->append(QString("cache: unable to store %1.").arg(outputFilename));
+        }
+
+        return false;
+    }
+
+    QFile::setPermissions(temporaryEntry, QFile::ReadOwner | QFile::ReadUser | QFile::ReadGroup | QFile::ReadOther);
+
+    if (::rename(QFile::encodeName(temporaryEntry).constData(), QFile::encodeName(entry).constData())!=0) {
+        QFile::remove(temporaryEntry);
+
+        if (log) {
+            log->append(QString("cache: unable to store %1.").arg(outputFilename));
+        }
+
+        return false;
+    }
+
+    if (log) {
+        log->append(QString("cache: stored the image for manifest %1.").arg(key.left(16)));
+    }
+
+    prune(log);
+
+    return true;
+}
+
+void Nedrysoft::BuildCache::prune(QStringList *log) const {
+    auto entries = QDir(m_cacheFolder).entryInfoList(QStringList() << QString("*%1").arg(buildCacheExtension), QDir::Files, QDir::Time);
+
+    // the list is sorted newest first
+
+    for (auto entryIndex = MaximumEntries; entryIndex<entries.count(); entryIndex++) {
+        if (QFile::remove(entries[entryIndex].absoluteFilePath()) && log) {
+            log->append(QString("cache: removed the least recently used image %1.").arg(entries[entryIndex].fileName()));
+        }
+    }
+}
+
+void Nedrysoft::BuildCache::detach(const QString &outputFilename, QStringList *log) {
+    struct stat fileStat;
+
+    if (::lstat(QFile::encodeName(outputFilename).constData(), &fileStat)!=0) {
+        return;
+    }
+
+    if (S_ISREG(fileStat.st_mode) && (fileStat.st_nlink>1)) {
+        if (QFile::remove(outputFilename) && log) {
+            log->append(QString("cache: removed %1 before building as it is linked to a cached image.").arg(outputFilename));
+        }
+    }
+}
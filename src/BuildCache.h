@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDCACHE_H
+#define NEDRYSOFT_BUILDCACHE_H
+
+#include "Builder.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildCache class keeps built DMG images so that a build whose inputs have not changed can
+     *              be skipped.
+     *
+     * @details     Images are stored under a key which is a hash of the build manifest and of the content of every
+     *              input file, folders such as application bundles are walked and every file, folder and symlink
+     *              inside them is included.  Hashing large payloads is avoided by remembering the device, inode,
+     *              size and modification times of each file along with its hash, a file whose metadata has not
+     *              changed is not read again.
+     *
+     *              Cached images are read only and are copied (cloned on APFS) to the output so that the output can
+     *              be modified, for example by codesign, without changing the cache.  Every decision is described
+     *              in the log so that it is clear why a build was or was not skipped.
+     */
+    class BuildCache {
+        public:
+            static constexpr auto MaximumEntries = 16;          //! the number of images kept, older images are removed
+
+        public:
+            /**
+             * @brief       Constructs a new BuildCache instance which uses the users cache folder.
+             */
+            explicit BuildCache();
+
+            /**
+             * @brief       Returns the cache key for a build.
+             *
+             * @param[in]   manifest the manifest of the build.
+             * @param[out]  log if not null, a description of the work done is appended.
+             *
+             * @returns     the key as a hex string.
+             */
+            QString key(const Builder::Manifest &manifest, QStringList *log = nullptr);
+
+            /**
+             * @brief       Places the cached image for a key at the output filename.
+             *
+             * @param[in]   key the cache key.
+             * @param[in]   outputFilename the absolute filename of the DMG.
+             * @param[out]  log if not null, the decisions that were made are appended.
+             *
+             * @returns     true if the cached image was used; otherwise false.
+             */
+            bool fetch(const QString &key, const QString &outputFilename, QStringList *log = nullptr) const;
+
+            /**
+             * @brief       Sets whether a cached image is hard linked to the output rather than copied.
+             *
+             * @note        A linked output shares its data with the read only cache entry, it must not be modified
+             *              (for example signed or stapled) as that would either fail or change the cached image.
+             *
+             * @param[in]   isEnabled true to hard link cached images when possible; otherwise false.
+             */
+            void setLinkEnabled(bool isEnabled);
+
+            /**
+             * @brief       Adds a newly built image to the cache.
+             *
+             * @param[in]   key the cache key.
+             * @param[in]   outputFilename the absolute filename of the DMG.
+             * @param[out]  log if not null, the decisions that were made are appended.
+             *
+             * @returns     true if the image was stored; otherwise false.
+             */
+            bool store(const QString &key, const QString &outputFilename, QStringList *log = nullptr) const;
+
+            /**
+             * @brief       Removes the output if it is a hard link to another file.
+             *
+             * @note        This is called before building so that the build never writes into a cached image that
+             *              was linked to the output by an earlier run.
+             *
+             * @param[in]   outputFilename the absolute filename of the DMG.
+             * @param[out]  log if not null, the decisions that were made are appended.
+             */
+            static void detach(const QString &outputFilename, QStringList *log = nullptr);
+
+        private:
+            /**
+             * @brief       Holds the metadata and content hash of a file that has been hashed before.
+             */
+            struct FileState {
+                quint64 device;                                 //! the device the file is on
+                quint64 inode;                                  //! the inode of the file
+                qint64 size;                                    //! the size of the file in bytes
+                qint64 modified;                                //! the modification time in nanoseconds
+                qint64 changed;                                 //! the status change time in nanoseconds
+                QByteArray hash;                                //! the SHA-256 of the content
+            };
+
+            /**
+             * @brief       Adds an input file or folder to the key hash.
+             *
+             * @param[in]   hash the key hash.
+             * @param[in]   filename the absolute path of the input.
+             * @param[out]  log if not null, missing inputs are described.
+             */
+            void addInput(QCryptographicHash &hash, const QString &filename, QStringList *log);
+
+            /**
+             * @brief       Adds a single file, folder or symlink to the key hash.
+             *
+             * @param[in]   hash the key hash.
+             * @param[in]   filename the absolute path of the entry.
+             * @param[in]   name the name of the entry relative to the input.
+             *
+             * @returns     true if the entry exists; otherwise false.
+             */
+            bool addEntry(QCryptographicHash &hash, const QString &filename, const QString &name);
+
+            /**
+             * @brief       Returns the content hash of a file, using the stored state if the file has not changed.
+             *
+             * @param[in]   filename the absolute path of the file.
+             * @param[in]   state the current metadata of the file, the hash is filled in.
+             *
+             * @returns     the SHA-256 of the content; or an empty array if the file could not be read.
+             */
+            QByteArray contentHash(const QString &filename, FileState &state);
+
+            /**
+             * @brief       Loads the file state index.
+             */
+            void loadIndex();
+
+            /**
+             * @brief       Saves the file state index if it has changed.
+             */
+            void saveIndex();
+
+            /**
+             * @brief       Returns the filename of the cached image for a key.
+             *
+             * @param[in]   key the cache key.
+             *
+             * @returns     the full path to the cached image.
+             */
+            QString entryFilename(const QString &key) const;
+
+            /**
+             * @brief       Removes the least recently used images until the cache holds MaximumEntries images.
+             *
+             * @param[out]  log if not null, the removed images are described.
+             */
+            void prune(QStringList *log) const;
+
+        private:
+            QString m_cacheFolder;                              //! the folder that images are stored in
+            QHash<QString, FileState> m_index;                  //! the known state of previously hashed files
+            bool m_indexLoaded;                                 //! whether the index has been loaded
+            bool m_indexModified;                               //! whether the index needs to be saved
+            bool m_isLinkEnabled;                               //! whether cached images are hard linked to the output
+            int m_hashedFiles;                                  //! files read during the current key calculation
+            int m_unchangedFiles;                               //! files skipped during the current key calculation
+    };
+}
+
+#endif //NEDRYSOFT_BUILDCACHE_H
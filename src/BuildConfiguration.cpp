@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Python.h"                         //! @note must be included first
+
+#include "BuildConfiguration.h"
+
+using Configuration = Nedrysoft::BuildConfiguration;
+
+#ifdef Py_TPFLAGS_DISALLOW_INSTANTIATION
+constexpr auto configurationTypeFlags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DISALLOW_INSTANTIATION;
+#else
+constexpr auto configurationTypeFlags = Py_TPFLAGS_DEFAULT;
+#endif
+
+/**
+ * @brief       The layout of all of the configuration objects, the lists and items are views onto the shared
+ *              configuration and the items hold their index in the list.
+ */
+struct ConfigurationObject {
+    PyObject_HEAD
+    std::shared_ptr<const Configuration> *configuration;    //! the configuration, nullptr if not created by dmgee
+    Py_ssize_t index;                                       //! the index of the item in its list
+};
+
+static PyObject *pythonValue(const QString &value) {
+    auto utf8Value = value.toUtf8();
+
+    return PyUnicode_FromStringAndSize(utf8Value.constData(), utf8Value.size());
+}
+
+static PyObject *pythonValue(int value) {
+    return PyLong_FromLong(value);
+}
+
+static PyObject *pythonValue(const QPoint &value) {
+    return Py_BuildValue("(ii)", value.x(), value.y());
+}
+
+static PyObject *pythonValue(const QSize &value) {
+    return Py_BuildValue("(ii)", value.width(), value.height());
+}
+
+static PyObject *newObject(PyTypeObject *type, const std::shared_ptr<const Configuration> &configuration, Py_ssize_t index) {
+    if (!type) {
+        return nullptr;
+    }
+
+    // tp_alloc zeroes the object and adds the reference to the heap type that is released by the deallocator
+
+    auto object = reinterpret_cast<ConfigurationObject *>(type->tp_alloc(type, 0));
+
+    if (object) {
+        object->configuration = new std::shared_ptr<const Configuration>(configuration);
+        object->index = index;
+    }
+
+    return reinterpret_cast<PyObject *>(object);
+}
+
+static void deallocObject(PyObject *self) {
+    auto type = Py_TYPE(self);
+
+    delete reinterpret_cast<ConfigurationObject *>(self)->configuration;
+
+    type->tp_free(self);
+
+    Py_DECREF(type);
+}
+
+static const Configuration *configurationOf(PyObject *self) {
+    auto object = reinterpret_cast<ConfigurationObject *>(self);
+
+    if (!object->configuration) {
+        PyErr_SetString(PyExc_TypeError, "the object was not created by dmgee");
+
+        return nullptr;
+    }
+
+    return object->configuration->get();
+}
+
+template<typename Item, QVector<Item> Configuration::*list>
+static const Item *itemOf(PyObject *self) {
+    auto configuration = configurationOf(self);
+
+    if (!configuration) {
+        return nullptr;
+    }
+
+    return &(configuration->*list)[reinterpret_cast<ConfigurationObject *>(self)->index];
+}
+
+template<auto member>
+static PyObject *configurationAttribute(PyObject *self, void *closure) {
+    auto configuration = configurationOf(self);
+
+    return configuration ? pythonValue(configuration->*member) : nullptr;
+}
+
+template<typename Item, QVector<Item> Configuration::*list, auto member>
+static PyObject *itemAttribute(PyObject *self, void *closure) {
+    auto item = itemOf<Item, list>(self);
+
+    return item ? pythonValue(item->*member) : nullptr;
+}
+
+template<typename Item, QVector<Item> Configuration::*list>
+static PyObject *itemX(PyObject *self, void *closure) {
+    auto item = itemOf<Item, list>(self);
+
+    return item ? pythonValue(item->position.x()) : nullptr;
+}
+
+template<typename Item, QVector<Item> Configuration::*list>
+static PyObject *itemY(PyObject *self, void *closure) {
+    auto item = itemOf<Item, list>(self);
+
+    return item ? pythonValue(item->position.y()) : nullptr;
+}
+
+template<typename Item, QVector<Item> Configuration::*list, QString Item::*label>
+static PyObject *itemRepr(PyObject *self) {
+    auto item = itemOf<Item, list>(self);
+
+    if (!item) {
+        return nullptr;
+    }
+
+    Nedrysoft::PyRef labelObject(pythonValue(item->*label));
+
+    if (!labelObject) {
+        return nullptr;
+    }
+
+    return PyUnicode_FromFormat("<%s %R at (%d, %d)>", Py_TYPE(self)->tp_name, labelObject.get(), item->position.x(), item->position.y());
+}
+
+static PyTypeObject *cachedType(PyObject *&type, PyType_Spec &spec) {
+    // the types are created when first used, this happens with the GIL held so no further locking is needed
+
+    if (!type) {
+        type = PyType_FromSpec(&spec);
+    }
+
+    return reinterpret_cast<PyTypeObject *>(type);
+}
+
+static PyGetSetDef fileAttributes[] = {
+    {"path", itemAttribute<Configuration::File, &Configuration::files, &Configuration::File::path>, nullptr, PyDoc_STR("the absolute path of the file"), nullptr},
+    {"position", itemAttribute<Configuration::File, &Configuration::files, &Configuration::File::position>, nullptr, PyDoc_STR("the position of the icon as (x, y)"), nullptr},
+    {"x", itemX<Configuration::File, &Configuration::files>, nullptr, PyDoc_STR("the x coordinate of the icon"), nullptr},
+    {"y", itemY<Configuration::File, &Configuration::files>, nullptr, PyDoc_STR("the y coordinate of the icon"), nullptr},
+    {nullptr}
+};
+
+static PyType_Slot fileSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void *>(deallocObject)},
+    {Py_tp_getset, fileAttributes},
+    {Py_tp_repr, reinterpret_cast<void *>(itemRepr<Configuration::File, &Configuration::files, &Configuration::File::path>)},
+    {Py_tp_doc, const_cast<char *>("a file that is copied into the image")},
+    {0, nullptr}
+};
+
+static PyType_Spec fileSpec = {
+    "dmgee.File", sizeof(ConfigurationObject), 0, configurationTypeFlags, fileSlots
+};
+
+static PyGetSetDef symlinkAttributes[] = {
+    {"name", itemAttribute<Configuration::Symlink, &Configuration::symlinks, &Configuration::Symlink::name>, nullptr, PyDoc_STR("the name of the symlink"), nullptr},
+    {"target", itemAttribute<Configuration::Symlink, &Configuration::symlinks, &Configuration::Symlink::target>, nullptr, PyDoc_STR("the path that the symlink points to"), nullptr},
+    {"position", itemAttribute<Configuration::Symlink, &Configuration::symlinks, &Configuration::Symlink::position>, nullptr, PyDoc_STR("the position of the icon as (x, y)"), nullptr},
+    {"x", itemX<Configuration::Symlink, &Configuration::symlinks>, nullptr, PyDoc_STR("the x coordinate of the icon"), nullptr},
+    {"y", itemY<Configuration::Symlink, &Configuration::symlinks>, nullptr, PyDoc_STR("the y coordinate of the icon"), nullptr},
+    {nullptr}
+};
+
+static PyType_Slot symlinkSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void *>(deallocObject)},
+    {Py_tp_getset, symlinkAttributes},
+    {Py_tp_repr, reinterpret_cast<void *>(itemRepr<Configuration::Symlink, &Configuration::symlinks, &Configuration::Symlink::name>)},
+    {Py_tp_doc, const_cast<char *>("a symlink that is created in the image")},
+    {0, nullptr}
+};
+
+static PyType_Spec symlinkSpec = {
+    "dmgee.Symlink", sizeof(ConfigurationObject), 0, configurationTypeFlags, symlinkSlots
+};
+
+static PyTypeObject *fileType() {
+    static PyObject *type = nullptr;
+
+    return cachedType(type, fileSpec);
+}
+
+static PyTypeObject *symlinkType() {
+    static PyObject *type = nullptr;
+
+    return cachedType(type, symlinkSpec);
+}
+
+template<typename Item, QVector<Item> Configuration::*list>
+static Py_ssize_t listLength(PyObject *self) {
+    auto configuration = configurationOf(self);
+
+    return configuration ? (configuration->*list).size() : -1;
+}
+
+template<typename Item, QVector<Item> Configuration::*list, PyTypeObject *(*itemType)()>
+static PyObject *listItem(PyObject *self, Py_ssize_t index) {
+    auto configuration = configurationOf(self);
+
+    if (!configuration) {
+        return nullptr;
+    }
+
+    // negative indices have already been adjusted by python using the length
+
+    if ((index<0) || (index>=(configuration->*list).size())) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+
+        return nullptr;
+    }
+
+    return newObject(itemType(), *reinterpret_cast<ConfigurationObject *>(self)->configuration, index);
+}
+
+static PyType_Slot fileListSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void *>(deallocObject)},
+    {Py_sq_length, reinterpret_cast<void *>(listLength<Configuration::File, &Configuration::files>)},
+    {Py_sq_item, reinterpret_cast<void *>(listItem<Configuration::File, &Configuration::files, fileType>)},
+    {Py_tp_doc, const_cast<char *>("the files that are copied into the image")},
+    {0, nullptr}
+};
+
+static PyType_Spec fileListSpec = {
+    "dmgee.FileList", sizeof(ConfigurationObject), 0, configurationTypeFlags, fileListSlots
+};
+
+static PyType_Slot symlinkListSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void *>(deallocObject)},
+    {Py_sq_length, reinterpret_cast<void *>(listLength<Configuration::Symlink, &Configuration::symlinks>)},
+    {Py_sq_item, reinterpret_cast<void *>(listItem<Configuration::Symlink, &Configuration::symlinks, symlinkType>)},
+    {Py_tp_doc, const_cast<char *>("the symlinks that are created in the image")},
+    {0, nullptr}
+};
+
+static PyType_Spec symlinkListSpec = {
+    "dmgee.SymlinkList", sizeof(ConfigurationObject), 0, configurationTypeFlags, symlinkListSlots
+};
+
+static PyTypeObject *fileListType() {
+    static PyObject *type = nullptr;
+
+    return cachedType(type, fileListSpec);
+}
+
+static PyTypeObject *symlinkListType() {
+    static PyObject *type = nullptr;
+
+    return cachedType(type, symlinkListSpec);
+}
+
+template<PyTypeObject *(*listType)()>
+static PyObject *configurationList(PyObject *self, void *closure) {
+    if (!configurationOf(self)) {
+        return nullptr;
+    }
+
+    return newObject(listType(), *reinterpret_cast<ConfigurationObject *>(self)->configuration, 0);
+}
+
+static PyGetSetDef configurationAttributes[] = {
+    {"volume_name", configurationAttribute<&Configuration::volumeName>, nullptr, PyDoc_STR("the name of the volume"), nullptr},
+    {"format", configurationAttribute<&Configuration::format>, nullptr, PyDoc_STR("the format of the final image"), nullptr},
+    {"output_file", configurationAttribute<&Configuration::outputFilename>, nullptr, PyDoc_STR("the filename of the final image"), nullptr},
+    {"background", configurationAttribute<&Configuration::background>, nullptr, PyDoc_STR("the absolute path of the background image"), nullptr},
+    {"icon", configurationAttribute<&Configuration::icon>, nullptr, PyDoc_STR("the absolute path of the volume icon"), nullptr},
+    {"text_position", configurationAttribute<&Configuration::textPosition>, nullptr, PyDoc_STR("the position of the icon labels"), nullptr},
+    {"icon_size", configurationAttribute<&Configuration::iconSize>, nullptr, PyDoc_STR("the size of the icons"), nullptr},
+    {"text_size", configurationAttribute<&Configuration::textSize>, nullptr, PyDoc_STR("the size of the icon labels"), nullptr},
+    {"grid_size", configurationAttribute<&Configuration::gridSize>, nullptr, PyDoc_STR("the grid spacing as (width, height)"), nullptr},
+    {"window_size", configurationAttribute<&Configuration::windowSize>, nullptr, PyDoc_STR("the size of the finder window as (width, height)"), nullptr},
+    {"files", configurationList<fileListType>, nullptr, PyDoc_STR("the files that are copied into the image"), nullptr},
+    {"symlinks", configurationList<symlinkListType>, nullptr, PyDoc_STR("the symlinks that are created in the image"), nullptr},
+    {nullptr}
+};
+
+static PyType_Slot configurationSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void *>(deallocObject)},
+    {Py_tp_getset, configurationAttributes},
+    {Py_tp_doc, const_cast<char *>("the configuration that the build was started with")},
+    {0, nullptr}
+};
+
+static PyType_Spec configurationSpec = {
+    "dmgee.Configuration", sizeof(ConfigurationObject), 0, configurationTypeFlags, configurationSlots
+};
+
+static PyTypeObject *configurationType() {
+    static PyObject *type = nullptr;
+
+    return cachedType(type, configurationSpec);
+}
+
+Nedrysoft::PyRef Nedrysoft::toPython(std::shared_ptr<const BuildConfiguration> configuration) {
+    if (!configuration) {
+        return PyRef::borrowed(Py_None);
+    }
+
+    return PyRef(newObject(configurationType(), configuration, 0));
+}
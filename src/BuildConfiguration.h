@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDCONFIGURATION_H
+#define NEDRYSOFT_BUILDCONFIGURATION_H
+
+#include "PyRef.h"
+
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildConfiguration structure holds the configuration that a build was started with.
+     *
+     * @details     A configuration is taken when a build starts and is not modified afterwards, so it can be read
+     *              by the build thread while the user continues to edit the layout.  It is exposed to python as
+     *              dmgee.configuration(), the attributes of the python objects are converted from the C++ values
+     *              when they are read, so a script only pays for the entries that it uses.
+     */
+    struct BuildConfiguration {
+        /**
+         * @brief       Holds a file that is copied into the image.
+         */
+        struct File {
+            QString path;                                   //! the absolute path of the file
+            QPoint position;                                //! the position of the icon
+        };
+
+        /**
+         * @brief       Holds a symlink that is created in the image.
+         */
+        struct Symlink {
+            QString name;                                   //! the name of the symlink
+            QString target;                                 //! the path that the symlink points to
+            QPoint position;                                //! the position of the icon
+        };
+
+        QString volumeName;                                 //! the name of the volume
+        QString format;                                     //! the format of the final image
+        QString outputFilename;                             //! the filename of the final image
+        QString background;                                 //! the absolute path of the background image
+        QString icon;                                       //! the absolute path of the volume icon
+        QString textPosition;                               //! the position of the icon labels
+        int iconSize = 0;                                   //! the size of the icons
+        int textSize = 0;                                   //! the size of the icon labels
+        QSize gridSize;                                     //! the grid spacing
+        QSize windowSize;                                   //! the size of the finder window
+        QVector<File> files;                                //! the files that are copied into the image
+        QVector<Symlink> symlinks;                          //! the symlinks that are created in the image
+    };
+
+    /**
+     * @brief       Wraps a build configuration in a dmgee.Configuration python object.
+     *
+     * @details     The object, and the dmgee.File and dmgee.Symlink objects that are read from it, share ownership
+     *              of the configuration, so they remain valid after the build has finished.
+     *
+     * @note        The GIL must be held.
+     *
+     * @param[in]   configuration the configuration.
+     *
+     * @returns     the object; or an empty PyRef with a python exception set.
+     */
+    PyRef toPython(std::shared_ptr<const BuildConfiguration> configuration);
+}
+
+#endif //NEDRYSOFT_BUILDCONFIGURATION_H
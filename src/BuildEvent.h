@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDEVENT_H
+#define NEDRYSOFT_BUILDEVENT_H
+
+#include <QMetaType>
+#include <QString>
+#include <QtGlobal>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildEvent structure describes a single progress event from the build script.
+     *
+     * @details     Events are decoded directly from the python objects passed to the dmgee module, they are plain
+     *              values so that they can be queued between threads without any serialisation.
+     */
+    struct BuildEvent {
+        /**
+         * @brief       The kind of event.
+         */
+        enum Type {
+            Unknown = 0,                                    /**< The event was not recognised. */
+            BuildStarted = 1,                               /**< The build has started. */
+            BuildFinished = 2,                              /**< The build has finished. */
+            OperationStart = 3,                             /**< An operation within the build has started. */
+            OperationProgress = 4,                          /**< An operation has processed more data, bytes is the running total. */
+            ToolOutput = 5                                  /**< A tool run by the build wrote a line, path, channel and text are set. */
+        };
+
+        /**
+         * @brief       The operation that an OperationStart or OperationProgress event refers to.
+         */
+        enum Operation {
+            NoOperation = 0,                                /**< The event does not refer to an operation. */
+            SettingsLoad = 1,                               /**< Loading the settings. */
+            SizeCalculate = 2,                              /**< Calculating the size of the image. */
+            DmgCreate = 3,                                  /**< Creating the image. */
+            DmgShrink = 4,                                  /**< Shrinking the image. */
+            DmgAddLicense = 5,                              /**< Adding the licence to the image. */
+            BackgroundCreate = 6,                           /**< Creating the background image. */
+            FilesAdd = 7,                                   /**< Adding the files, bytes is the expected payload size, if known. */
+            FileAdd = 8,                                    /**< Adding a single file, path is set. */
+            SymlinksAdd = 9,                                /**< Adding the symlinks. */
+            SymlinkAdd = 10,                                /**< Adding a single symlink, path is set. */
+            ExtensionsHide = 11,                            /**< Hiding file extensions. */
+            DsStoreCreate = 12,                             /**< Creating the .DS_Store file. */
+            DsStoreCached = 13,                             /**< The .DS_Store file was taken from the layout cache. */
+            PayloadStaged = 14,                             /**< The payload was staged, bytes, count and duration are set. */
+            DmgConvert = 15                                 /**< Converting the image to the final format, bytes is the size of the input. */
+        };
+
+        /**
+         * @brief       The stream that a ToolOutput line was written to.
+         */
+        enum Channel {
+            NoChannel = 0,                                  /**< The event is not tool output. */
+            StandardOutput = 1,                             /**< The line was written to standard output. */
+            StandardError = 2                               /**< The line was written to standard error. */
+        };
+
+        Type type = Unknown;                                //! the kind of event
+        Operation operation = NoOperation;                  //! the operation for operation events
+        qint64 bytes = 0;                                   //! number of bytes processed, if known
+        qint64 count = 0;                                   //! number of items processed, if known
+        QString path;                                       //! the file, symlink target or tool the event refers to
+        qint64 timestamp = 0;                               //! the time of the event in nanoseconds (monotonic clock)
+        qint64 duration = 0;                                //! the time taken by the operation in nanoseconds, if known
+        Channel channel = NoChannel;                        //! the stream of a ToolOutput line
+        QString text;                                       //! the line written by the tool, without the line ending
+    };
+}
+
+Q_DECLARE_METATYPE(Nedrysoft::BuildEvent);
+
+#endif //NEDRYSOFT_BUILDEVENT_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BuildEventQueue.h"
+
+#include <thread>
+
+Nedrysoft::BuildEventQueue::BuildEventQueue() :
+        m_head(0),
+        m_tail(0),
+        m_notified(false) {
+
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of 2");
+}
+
+bool Nedrysoft::BuildEventQueue::push(const BuildEvent &event) {
+    auto head = m_head.load(std::memory_order_relaxed);
+
+    while (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+        std::this_thread::yield();
+    }
+
+    m_events[head & (Capacity - 1)] = event;
+
+    // the store of the head and the exchange of the flag must not be reordered with the flag being cleared and the
+    // head being loaded by drain, so both sides are sequentially consistent.  Either drain sees the new head or this
+    // sees the cleared flag and notifies again.
+
+    m_head.store(head + 1, std::memory_order_seq_cst);
+
+    return !m_notified.exchange(true, std::memory_order_seq_cst);
+}
+
+int Nedrysoft::BuildEventQueue::drain(QVector<BuildEvent> &events) {
+    // clear the flag first, an event pushed while draining will then cause another notification
+
+    m_notified.store(false, std::memory_order_seq_cst);
+
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    auto head = m_head.load(std::memory_order_seq_cst);
+    auto count = 0;
+
+    // the head is checked again once the events have been taken, events pushed in the meantime are taken as well
+
+    while (tail != head) {
+        events.reserve(events.size() + static_cast<int>(head - tail));
+
+        while (tail != head) {
+            events.append(std::move(m_events[tail & (Capacity - 1)]));
+
+            m_events[tail & (Capacity - 1)] = BuildEvent();
+
+            tail++;
+            count++;
+        }
+
+        m_tail.store(tail, std::memory_order_release);
+
+        head = m_head.load(std::memory_order_seq_cst);
+    }
+
+    return count;
+}
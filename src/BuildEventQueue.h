@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDEVENTQUEUE_H
+#define NEDRYSOFT_BUILDEVENTQUEUE_H
+
+#include "BuildEvent.h"
+
+#include <QVector>
+#include <array>
+#include <atomic>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildEventQueue class is a lock free single producer/single consumer ring of build events.
+     *
+     * @details     The build thread pushes events and the GUI thread drains them.  Rather than signalling for every
+     *              event, push reports when the consumer needs to be woken, which only happens for the first event
+     *              after the queue has been drained, so the GUI receives at most one notification per drain.
+     */
+    class BuildEventQueue {
+        public:
+            static constexpr auto Capacity = 4096;              //! number of events the ring can hold (power of 2)
+
+        public:
+            /**
+             * @brief       Constructs a new BuildEventQueue instance.
+             */
+            explicit BuildEventQueue();
+
+            /**
+             * @brief       Adds an event to the queue.
+             *
+             * @note        Must only be called from the producer thread.  If the ring is full the producer yields
+             *              until the consumer has made space, events are never discarded.
+             *
+             * @param[in]   event the event to add.
+             *
+             * @returns     true if the consumer should be notified; otherwise false.
+             */
+            bool push(const BuildEvent &event);
+
+            /**
+             * @brief       Removes all pending events from the queue.
+             *
+             * @note        Must only be called from the consumer thread.
+             *
+             * @param[out]  events the list that the events are appended to.
+             *
+             * @returns     the number of events that were removed.
+             */
+            int drain(QVector<BuildEvent> &events);
+
+        private:
+            std::array<BuildEvent, Capacity> m_events;          //! the ring storage
+            alignas(64) std::atomic<quint64> m_head;            //! the number of events pushed (producer)
+            alignas(64) std::atomic<quint64> m_tail;            //! the number of events removed (consumer)
+            alignas(64) std::atomic<bool> m_notified;           //! whether the consumer has been notified since the last drain
+    };
+}
+
+#endif //NEDRYSOFT_BUILDEVENTQUEUE_H
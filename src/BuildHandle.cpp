@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Python.h"                         //! @note must be included first
+
+#include "BuildHandle.h"
+
+#include <chrono>
+
+Nedrysoft::BuildHandle::BuildHandle(QObject *parent) :
+        QObject(parent),
+        m_threadId(0),
+        m_isCancelled(false),
+        m_isTimedOut(false),
+        m_isFinished(false),
+        m_result(-1),
+        m_exitCode(0) {
+
+    m_timeoutTimer.setSingleShot(true);
+
+    connect(&m_timeoutTimer, &QTimer::timeout, this, [=]() {
+        if (!isFinished()) {
+            m_isTimedOut = true;
+
+            cancel();
+        }
+    });
+}
+
+void Nedrysoft::BuildHandle::cancel() {
+    if ((isFinished()) || (m_isCancelled.exchange(true))) {
+        return;
+    }
+
+    Q_EMIT cancelRequested();
+
+    // the async exception is only checked by the thread it is raised in, if the script has not started yet then
+    // the runner sees the cancelled flag and does not start it.
+
+    if (!Py_IsInitialized()) {
+        return;
+    }
+
+    auto gilState = PyGILState_Ensure();
+
+    if (m_threadId) {
+        PyThreadState_SetAsyncExc(m_threadId, PyExc_KeyboardInterrupt);
+    }
+
+    PyGILState_Release(gilState);
+}
+
+void Nedrysoft::BuildHandle::setTimeout(int timeout) {
+    if (timeout>0) {
+        m_timeoutTimer.start(timeout);
+    } else {
+        m_timeoutTimer.stop();
+    }
+}
+
+bool Nedrysoft::BuildHandle::wait(int timeout) const {
+    std::unique_lock<std::mutex> stateLock(m_stateMutex);
+
+    if (timeout<0) {
+        m_finishedCondition.wait(stateLock, [=]() { return m_isFinished; });
+
+        return true;
+    }
+
+    return m_finishedCondition.wait_for(stateLock, std::chrono::milliseconds(timeout), [=]() { return m_isFinished; });
+}
+
+bool Nedrysoft::BuildHandle::isFinished() const {
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+    return m_isFinished;
+}
+
+bool Nedrysoft::BuildHandle::isCancelled() const {
+    return m_isCancelled;
+}
+
+bool Nedrysoft::BuildHandle::isTimedOut() const {
+    return m_isTimedOut;
+}
+
+int Nedrysoft::BuildHandle::result() const {
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+    return m_result;
+}
+
+int Nedrysoft::BuildHandle::exitCode() const {
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+    return m_exitCode;
+}
+
+QString Nedrysoft::BuildHandle::traceback() const {
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+    return m_traceback;
+}
+
+Nedrysoft::ScriptProfile Nedrysoft::BuildHandle::profile() const {
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+    return m_profile;
+}
+
+void Nedrysoft::BuildHandle::setThreadId(unsigned long threadId) {
+    m_threadId = threadId;
+}
+
+void Nedrysoft::BuildHandle::setFinished(int result, int exitCode, const QString &traceback, const ScriptProfile &profile) {
+    {
+        std::lock_guard<std::mutex> stateLock(m_stateMutex);
+
+        m_isFinished = true;
+        m_result = result;
+        m_exitCode = exitCode;
+        m_traceback = traceback;
+        m_profile = profile;
+    }
+
+    m_finishedCondition.notify_all();
+
+    // the timer belongs to the thread that created the handle, so it is stopped from there
+
+    QMetaObject::invokeMethod(&m_timeoutTimer, "stop", Qt::QueuedConnection);
+
+    // the signal is emitted from the thread that owns the handle, a connection made in the same event loop turn as
+    // the script was started in is then made before the signal is emitted, even if the script fails immediately.
+
+    QMetaObject::invokeMethod(this, [this, result]() {
+        Q_EMIT finished(result);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDHANDLE_H
+#define NEDRYSOFT_BUILDHANDLE_H
+
+#include "ScriptProfile.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Nedrysoft {
+    class Python;
+
+    /**
+     * @brief       The BuildHandle class refers to a script that has been started by Python::runScript.
+     *
+     * @details     The handle is returned as soon as the script has been queued, it is used to cancel the script,
+     *              to limit how long the script may run for and to find out how the script ended.  A script that
+     *              raised an exception has its formatted traceback stored in the handle, a script that called
+     *              sys.exit has its exit code stored.
+     *
+     *              Cancelling raises a KeyboardInterrupt in the thread that is running the script, native code that
+     *              runs with the GIL released is told through the cancelRequested signal so that it can stop any
+     *              work (or child processes) that would otherwise delay the interrupt.
+     *
+     * @note        The state of the handle may be read from any thread, the timeout uses a timer so the handle must
+     *              be created by a thread with an event loop.
+     */
+    class BuildHandle :
+            public QObject {
+
+        private:
+            Q_OBJECT
+
+        public:
+            /**
+             * @brief       Constructs a new BuildHandle instance.
+             *
+             * @param[in]   parent the owner object.
+             */
+            explicit BuildHandle(QObject *parent = nullptr);
+
+            /**
+             * @brief       Cancels the script.
+             *
+             * @details     The cancelRequested signal is emitted (from the calling thread) and a KeyboardInterrupt
+             *              is raised in the script, a script that has not started yet is not run.  The finished signal
+             *              is emitted once the script has unwound.
+             *
+             * @note        May be called from any thread.
+             */
+            void cancel();
+
+            /**
+             * @brief       Sets the maximum time that the script may run for, the script is cancelled when the time
+             *              has elapsed.
+             *
+             * @param[in]   timeout the time in milliseconds, 0 removes the limit.
+             */
+            void setTimeout(int timeout);
+
+            /**
+             * @brief       Waits for the script to finish.
+             *
+             * @param[in]   timeout the maximum time to wait in milliseconds, or -1 to wait until it has finished.
+             *
+             * @returns     true if the script has finished; otherwise false.
+             */
+            bool wait(int timeout = -1) const;
+
+            /**
+             * @brief       Returns whether the script has finished.
+             *
+             * @returns     true if finished; otherwise false.
+             */
+            bool isFinished() const;
+
+            /**
+             * @brief       Returns whether the script has been cancelled (including by the timeout).
+             *
+             * @returns     true if cancelled; otherwise false.
+             */
+            bool isCancelled() const;
+
+            /**
+             * @brief       Returns whether the script was cancelled because it ran for longer than the timeout.
+             *
+             * @returns     true if timed out; otherwise false.
+             */
+            bool isTimedOut() const;
+
+            /**
+             * @brief       Returns the result of the script.
+             *
+             * @returns     the Python::ErrorCode result; or -1 if the script has not finished.
+             */
+            int result() const;
+
+            /**
+             * @brief       Returns the exit code that the script passed to sys.exit.
+             *
+             * @returns     the exit code; or 0 if the script did not call sys.exit.
+             */
+            int exitCode() const;
+
+            /**
+             * @brief       Returns the traceback of the exception that ended the script.
+             *
+             * @returns     the formatted traceback; or an empty string if the script did not raise an exception.
+             */
+            QString traceback() const;
+
+            /**
+             * @brief       Returns the profile of the script.
+             *
+             * @returns     the profile; or an empty profile if profiling was not enabled.
+             */
+            ScriptProfile profile() const;
+
+        public:
+            /**
+             * @brief       This signal is emitted when the script has been asked to stop.
+             *
+             * @note        The signal is emitted from the thread that cancelled the script, a direct connection
+             *              can be used to stop native work that is running on the script thread.
+             */
+            Q_SIGNAL void cancelRequested();
+
+            /**
+             * @brief       This signal is emitted when the script has finished.
+             *
+             * @note        The signal is emitted from the event loop of the thread that owns the handle, so it is
+             *              never missed by a connection made in the same turn of the event loop that started the
+             *              script.
+             *
+             * @param[in]   result the Python::ErrorCode result of the script.
+             */
+            Q_SIGNAL void finished(int result);
+
+        private:
+            /**
+             * @brief       Records the thread that is running the script.
+             *
+             * @note        Called by Python with the GIL held.
+             *
+             * @param[in]   threadId the python thread id, or 0 once the script has returned.
+             */
+            void setThreadId(unsigned long threadId);
+
+            /**
+             * @brief       Records how the script ended, wakes any waiting threads and posts the finished signal.
+             *
+             * @note        Called by Python from the script thread.
+             *
+             * @param[in]   result the Python::ErrorCode result.
+             * @param[in]   exitCode the exit code passed to sys.exit.
+             * @param[in]   traceback the formatted traceback.
+             * @param[in]   profile the profile of the script, empty if it was not profiled.
+             */
+            void setFinished(int result, int exitCode, const QString &traceback, const ScriptProfile &profile = ScriptProfile());
+
+            friend class Python;
+
+        private:
+            mutable std::mutex m_stateMutex;                    //! protects the result of the script
+            mutable std::condition_variable m_finishedCondition;    //! signalled when the script has finished
+
+            QTimer m_timeoutTimer;                              //! cancels the script when it runs for too long
+
+            std::atomic<unsigned long> m_threadId;              //! the python thread id of the running script
+            std::atomic<bool> m_isCancelled;                    //! set when the script has been cancelled
+            std::atomic<bool> m_isTimedOut;                     //! set when the script was cancelled by the timeout
+            bool m_isFinished;                                  //! whether the script has finished
+            int m_result;                                       //! the Python::ErrorCode result
+            int m_exitCode;                                     //! the exit code passed to sys.exit
+            QString m_traceback;                                //! the traceback of the exception that ended the script
+            ScriptProfile m_profile;                            //! the profile of the script
+    };
+}
+
+#endif //NEDRYSOFT_BUILDHANDLE_H
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BuildProgress.h"
+
+#include <QtGlobal>
+
+constexpr auto stepShare = 0.05;                                //! the share of the progress given to the steps that are not measured in bytes
+constexpr auto expectedSteps = 8;                               //! the number of steps that dmgbuild reports in a typical build
+constexpr auto throughputSmoothing = 0.3;                       //! the weight given to each new throughput sample
+constexpr qint64 minimumSampleInterval = 250*1000*1000;         //! the minimum time between throughput samples (ns)
+constexpr qint64 nanosecondsPerSecond = 1000*1000*1000;
+
+/**
+ * @brief       The operation that starts each byte phase and the relative cost of a byte in the phase.
+ *
+ * @note        Compressing a byte costs roughly twice as much as copying it, the weights only need to be close
+ *              as the throughput is measured in weighted bytes.
+ */
+constexpr struct {
+    Nedrysoft::BuildEvent::Operation operation;
+    double weight;
+} bytePhases[] = {
+    {Nedrysoft::BuildEvent::FilesAdd, 1.0},
+    {Nedrysoft::BuildEvent::DmgConvert, 2.0},
+};
+
+Nedrysoft::BuildProgress::BuildProgress() :
+        m_activePhase(-1),
+        m_steps(0),
+        m_fraction(0),
+        m_throughput(0),
+        m_sampleWork(0),
+        m_sampleTimestamp(0),
+        m_isFinished(false) {
+
+}
+
+void Nedrysoft::BuildProgress::clear() {
+    for (auto &phase : m_phases) {
+        phase = Phase();
+    }
+
+    m_activePhase = -1;
+    m_steps = 0;
+    m_fraction = 0;
+    m_throughput = 0;
+    m_sampleWork = 0;
+    m_sampleTimestamp = 0;
+    m_isFinished = false;
+}
+
+void Nedrysoft::BuildProgress::addEvent(const BuildEvent &event) {
+    switch (event.type) {
+        case BuildEvent::BuildStarted: {
+            clear();
+
+            return;
+        }
+
+        case BuildEvent::BuildFinished: {
+            finishPhase(event.timestamp);
+
+            m_isFinished = true;
+            m_fraction = 1;
+
+            return;
+        }
+
+        case BuildEvent::OperationProgress: {
+            if ((m_activePhase!=-1) && (bytePhases[m_activePhase].operation==event.operation)) {
+                auto &phase = m_phases[m_activePhase];
+
+                phase.processedBytes = qMax(phase.processedBytes, event.bytes);
+
+                sample(event.timestamp);
+            }
+
+            break;
+        }
+
+        case BuildEvent::OperationStart: {
+            switch (event.operation) {
+                case BuildEvent::FileAdd:
+                case BuildEvent::SymlinkAdd: {
+                    break;
+                }
+
+                case BuildEvent::FilesAdd: {
+                    // dmgbuild reports adding files again after dmgee has staged the payload
+
+                    if (!m_phases[Staging].isStarted) {
+                        startPhase(Staging, event.bytes, event.timestamp);
+                    }
+
+                    break;
+                }
+
+                case BuildEvent::PayloadStaged: {
+                    // the staged total replaces the estimate, it includes the contents of folders
+
+                    m_phases[Staging].isStarted = true;
+                    m_phases[Staging].bytes = event.bytes;
+                    m_phases[Staging].processedBytes = event.bytes;
+
+                    if (m_activePhase==Staging) {
+                        finishPhase(event.timestamp);
+                    }
+
+                    break;
+                }
+
+                case BuildEvent::DmgConvert: {
+                    startPhase(Compression, event.bytes, event.timestamp);
+
+                    break;
+                }
+
+                default: {
+                    finishPhase(event.timestamp);
+
+                    m_steps++;
+
+                    break;
+                }
+            }
+
+            break;
+        }
+
+        default: {
+            return;
+        }
+    }
+
+    double totalWork;
+    auto completedWork = work(totalWork);
+    auto steps = static_cast<double>(qMin(m_steps, expectedSteps))/expectedSteps;
+    auto fraction = stepShare*steps;
+
+    if (totalWork>0) {
+        fraction += (1-stepShare)*completedWork/totalWork;
+    }
+
+    m_fraction = qBound(m_fraction, fraction, 1.0);
+}
+
+void Nedrysoft::BuildProgress::addEvents(const QVector<BuildEvent> &events) {
+    for (auto const &event : events) {
+        addEvent(event);
+    }
+}
+
+double Nedrysoft::BuildProgress::fraction() const {
+    return m_fraction;
+}
+
+qint64 Nedrysoft::BuildProgress::remainingTime() const {
+    double totalWork;
+
+    if (m_isFinished) {
+        return 0;
+    }
+
+    auto completedWork = work(totalWork);
+
+    if ((m_throughput<=0) || (totalWork<=0)) {
+        return -1;
+    }
+
+    return static_cast<qint64>((totalWork-completedWork)/m_throughput);
+}
+
+QString Nedrysoft::BuildProgress::durationString(qint64 duration) {
+    auto seconds = (qMax<qint64>(duration, 0)+(nanosecondsPerSecond/2))/nanosecondsPerSecond;
+
+    if (seconds>=3600) {
+        return QString("%1h %2m").arg(seconds/3600).arg((seconds%3600)/60, 2, 10, QChar('0'));
+    }
+
+    if (seconds>=60) {
+        return QString("%1m %2s").arg(seconds/60).arg(seconds%60, 2, 10, QChar('0'));
+    }
+
+    return QString("%1s").arg(seconds);
+}
+
+double Nedrysoft::BuildProgress::work(double &totalWork) const {
+    double completedWork = 0;
+
+    totalWork = 0;
+
+    for (auto phaseIndex = 0; phaseIndex<PhaseCount; phaseIndex++) {
+        auto const &phase = m_phases[phaseIndex];
+        auto bytes = phase.bytes;
+
+        // until the image is converted its size is not known, it holds the payload so that is used as the estimate
+
+        if ((phaseIndex==Compression) && (!phase.isStarted)) {
+            bytes = m_phases[Staging].bytes;
+        }
+
+        auto processedBytes = phase.isFinished ? bytes : qMin(phase.processedBytes, bytes);
+
+        totalWork += bytePhases[phaseIndex].weight*static_cast<double>(bytes);
+        completedWork += bytePhases[phaseIndex].weight*static_cast<double>(processedBytes);
+    }
+
+    return completedWork;
+}
+
+void Nedrysoft::BuildProgress::startPhase(int phaseIndex, qint64 bytes, qint64 timestamp) {
+    double totalWork;
+
+    finishPhase(timestamp);
+
+    m_phases[phaseIndex].isStarted = true;
+    m_phases[phaseIndex].isFinished = false;
+    m_phases[phaseIndex].bytes = bytes;
+    m_phases[phaseIndex].processedBytes = 0;
+
+    m_activePhase = phaseIndex;
+    m_sampleWork = work(totalWork);
+    m_sampleTimestamp = timestamp;
+}
+
+void Nedrysoft::BuildProgress::finishPhase(qint64 timestamp) {
+    if (m_activePhase==-1) {
+        return;
+    }
+
+    m_phases[m_activePhase].isFinished = true;
+
+    sample(timestamp, true);
+
+    m_activePhase = -1;
+}
+
+void Nedrysoft::BuildProgress::sample(qint64 timestamp, bool isPhaseEnd) {
+    double totalWork;
+    auto elapsed = timestamp-m_sampleTimestamp;
+
+    if ((m_activePhase==-1) || (elapsed<=0)) {
+        return;
+    }
+
+    if ((elapsed<minimumSampleInterval) && (!((isPhaseEnd) && (m_throughput<=0)))) {
+        return;
+    }
+
+    auto completedWork = work(totalWork);
+    auto throughput = (completedWork-m_sampleWork)/static_cast<double>(elapsed);
+
+    if (m_throughput>0) {
+        m_throughput = (throughputSmoothing*throughput)+((1-throughputSmoothing)*m_throughput);
+    } else {
+        m_throughput = throughput;
+    }
+
+    m_sampleWork = completedWork;
+    m_sampleTimestamp = timestamp;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDPROGRESS_H
+#define NEDRYSOFT_BUILDPROGRESS_H
+
+#include "BuildEvent.h"
+
+#include <QString>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildProgress class estimates how much of a build is complete and how long is left.
+     *
+     * @details     The time taken by a build is dominated by copying the payload into the image and compressing
+     *              the image, so progress is measured in bytes for those two phases and each byte is weighted by the
+     *              relative cost of the phase.  The remaining steps that dmgbuild reports take a small share of the
+     *              progress.  The time remaining is the weighted work left divided by an exponentially smoothed
+     *              throughput, which is sampled while a phase is processing bytes so that the steps in between do
+     *              not drag the estimate down.
+     */
+    class BuildProgress {
+        public:
+            /**
+             * @brief       Constructs a new BuildProgress instance.
+             */
+            BuildProgress();
+
+            /**
+             * @brief       Resets the progress to the start of a build.
+             */
+            void clear();
+
+            /**
+             * @brief       Updates the progress with an event.
+             *
+             * @note        A BuildStarted event resets the progress from a previous build.
+             *
+             * @param[in]   event the progress event.
+             */
+            void addEvent(const BuildEvent &event);
+
+            /**
+             * @brief       Updates the progress with a list of events.
+             *
+             * @param[in]   events the progress events, in the order that they were generated.
+             */
+            void addEvents(const QVector<BuildEvent> &events);
+
+            /**
+             * @brief       Returns how much of the build is complete.
+             *
+             * @note        The value never decreases during a build, even if the size of the work is revised.
+             *
+             * @returns     the fraction complete, from 0 to 1.
+             */
+            double fraction() const;
+
+            /**
+             * @brief       Returns the estimated time until the build finishes.
+             *
+             * @returns     the time in nanoseconds; or -1 if there is not yet enough information for an estimate.
+             */
+            qint64 remainingTime() const;
+
+            /**
+             * @brief       Returns a short human readable form of a duration, such as "2m 05s".
+             *
+             * @param[in]   duration the duration in nanoseconds.
+             *
+             * @returns     the formatted duration.
+             */
+            static QString durationString(qint64 duration);
+
+        private:
+            /**
+             * @brief       The phases of the build that are measured in bytes.
+             */
+            enum PhaseIndex {
+                Staging = 0,                                    /**< Copying the payload into the image. */
+                Compression = 1,                                /**< Converting the image to its final format. */
+                PhaseCount = 2                                  /**< The number of phases. */
+            };
+
+            /**
+             * @brief       Holds a phase of the build that processes a known number of bytes.
+             */
+            struct Phase {
+                qint64 bytes = 0;                               //! the number of bytes the phase is expected to process
+                qint64 processedBytes = 0;                      //! the number of bytes processed so far
+                bool isStarted = false;                         //! whether the phase has started
+                bool isFinished = false;                        //! whether the phase has finished
+            };
+
+            /**
+             * @brief       Returns the weighted work of the byte phases.
+             *
+             * @param[out]  totalWork receives the weighted work of the whole build.
+             *
+             * @returns     the weighted work that has been completed.
+             */
+            double work(double &totalWork) const;
+
+            /**
+             * @brief       Starts a phase, finishing the phase that was processing bytes.
+             *
+             * @param[in]   phaseIndex the phase.
+             * @param[in]   bytes the number of bytes the phase is expected to process.
+             * @param[in]   timestamp the time of the event in nanoseconds.
+             */
+            void startPhase(int phaseIndex, qint64 bytes, qint64 timestamp);
+
+            /**
+             * @brief       Finishes the phase that is processing bytes, if any.
+             *
+             * @note        Any bytes that were not reported are counted as processed, so a phase whose backend cannot
+             *              report progress still provides a throughput sample when it finishes.
+             *
+             * @param[in]   timestamp the time of the event in nanoseconds.
+             */
+            void finishPhase(qint64 timestamp);
+
+            /**
+             * @brief       Adds a throughput sample if the active phase has run for long enough since the last one.
+             *
+             * @param[in]   timestamp the time of the event in nanoseconds.
+             * @param[in]   isPhaseEnd true if the phase is finishing, a short phase is then sampled if there is no
+             *              estimate yet.
+             */
+            void sample(qint64 timestamp, bool isPhaseEnd = false);
+
+        private:
+            Phase m_phases[PhaseCount];                         //! the phases measured in bytes
+            int m_activePhase;                                  //! the index of the phase processing bytes; or -1
+            int m_steps;                                        //! the number of other steps that have started
+            double m_fraction;                                  //! the fraction complete
+            double m_throughput;                                //! the smoothed weighted work per nanosecond
+            double m_sampleWork;                                //! the completed work at the last sample
+            qint64 m_sampleTimestamp;                           //! the time of the last sample
+            bool m_isFinished;                                  //! whether the build has finished
+    };
+}
+
+#endif //NEDRYSOFT_BUILDPROGRESS_H
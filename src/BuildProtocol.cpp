@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BuildProtocol.h"
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QtEndian>
+
+constexpr auto frameHeaderSize = static_cast<int>(sizeof(quint32));
+
+static QDataStream &operator<<(QDataStream &stream, const Nedrysoft::BuildEvent &event) {
+    return stream << static_cast<quint8>(event.type)
+                  << static_cast<quint8>(event.operation)
+                  << event.bytes
+                  << event.count
+                  << event.timestamp
+                  << event.duration
+                  << event.path
+                  << static_cast<quint8>(event.channel)
+                  << event.text;
+}
+
+static QDataStream &operator>>(QDataStream &stream, Nedrysoft::BuildEvent &event) {
+    quint8 type, operation, channel;
+
+    stream >> type >> operation >> event.bytes >> event.count >> event.timestamp >> event.duration >> event.path >> channel >> event.text;
+
+    event.type = static_cast<Nedrysoft::BuildEvent::Type>(type);
+    event.operation = static_cast<Nedrysoft::BuildEvent::Operation>(operation);
+    event.channel = static_cast<Nedrysoft::BuildEvent::Channel>(channel);
+
+    return stream;
+}
+
+static QDataStream &operator<<(QDataStream &stream, const Nedrysoft::ScriptProfile::Function &function) {
+    return stream << function.name << function.module << function.calls << function.totalTime << function.ownTime;
+}
+
+static QDataStream &operator>>(QDataStream &stream, Nedrysoft::ScriptProfile::Function &function) {
+    return stream >> function.name >> function.module >> function.calls >> function.totalTime >> function.ownTime;
+}
+
+static QDataStream &operator<<(QDataStream &stream, const Nedrysoft::ScriptProfile::Module &module) {
+    return stream << module.name << module.calls << module.ownTime << module.retainedMemory;
+}
+
+static QDataStream &operator>>(QDataStream &stream, Nedrysoft::ScriptProfile::Module &module) {
+    return stream >> module.name >> module.calls >> module.ownTime >> module.retainedMemory;
+}
+
+static QDataStream &operator<<(QDataStream &stream, const Nedrysoft::ScriptProfile &profile) {
+    stream << profile.start << profile.duration << profile.currentMemory << profile.peakMemory;
+    stream << static_cast<quint32>(profile.functions.count());
+
+    for (auto const &function : profile.functions) {
+        stream << function;
+    }
+
+    stream << static_cast<quint32>(profile.modules.count());
+
+    for (auto const &module : profile.modules) {
+        stream << module;
+    }
+
+    return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, Nedrysoft::ScriptProfile &profile) {
+    quint32 functionCount, moduleCount;
+
+    stream >> profile.start >> profile.duration >> profile.currentMemory >> profile.peakMemory;
+    stream >> functionCount;
+
+    for (quint32 functionIndex = 0; (functionIndex<functionCount) && (stream.status()==QDataStream::Ok); functionIndex++) {
+        Nedrysoft::ScriptProfile::Function function;
+
+        stream >> function;
+
+        profile.functions.append(function);
+    }
+
+    stream >> moduleCount;
+
+    for (quint32 moduleIndex = 0; (moduleIndex<moduleCount) && (stream.status()==QDataStream::Ok); moduleIndex++) {
+        Nedrysoft::ScriptProfile::Module module;
+
+        stream >> module;
+
+        profile.modules.append(module);
+    }
+
+    return stream;
+}
+
+/**
+ * @brief       Encodes a message body, calls the writer to add the fields for the message and adds the frame header.
+ */
+template <typename Writer>
+static QByteArray frame(Nedrysoft::BuildProtocol::Type type, qint32 jobId, Writer writer) {
+    QByteArray frameData(frameHeaderSize, 0);
+
+    {
+        QDataStream stream(&frameData, QIODevice::WriteOnly | QIODevice::Append);
+
+        stream << static_cast<quint8>(type) << jobId;
+
+        writer(stream);
+    }
+
+    qToLittleEndian<quint32>(static_cast<quint32>(frameData.size()-frameHeaderSize), frameData.data());
+
+    return frameData;
+}
+
+QByteArray Nedrysoft::BuildProtocol::hello(qint64 processId) {
+    return frame(Hello, -1, [=](QDataStream &stream) {
+        stream << processId;
+    });
+}
+
+QByteArray Nedrysoft::BuildProtocol::build(qint32 jobId, const QString &configurationFilename, const QString &outputFilename, qint32 timeout, bool profile) {
+    return frame(Build, jobId, [&](QDataStream &stream) {
+        stream << configurationFilename << outputFilename << timeout << profile;
+    });
+}
+
+QByteArray Nedrysoft::BuildProtocol::events(qint32 jobId, const QVector<BuildEvent> &events) {
+    return frame(Events, jobId, [&](QDataStream &stream) {
+        stream << static_cast<quint32>(events.count());
+
+        for (auto const &event : events) {
+            stream << event;
+        }
+    });
+}
+
+QByteArray Nedrysoft::BuildProtocol::finished(qint32 jobId, qint32 result, const QString &traceback, const ScriptProfile &scriptProfile) {
+    return frame(Finished, jobId, [&](QDataStream &stream) {
+        stream << result << traceback << scriptProfile;
+    });
+}
+
+QByteArray Nedrysoft::BuildProtocol::cancel(qint32 jobId) {
+    return frame(Cancel, jobId, [](QDataStream &) {});
+}
+
+QByteArray Nedrysoft::BuildProtocol::quit() {
+    return frame(Quit, -1, [](QDataStream &) {});
+}
+
+void Nedrysoft::BuildProtocol::Reader::append(const QByteArray &data) {
+    m_buffer.append(data);
+}
+
+bool Nedrysoft::BuildProtocol::Reader::next(Message &message) {
+    if (m_hasError || (m_buffer.size()<frameHeaderSize)) {
+        return false;
+    }
+
+    auto frameSize = qFromLittleEndian<quint32>(m_buffer.constData());
+
+    if (frameSize>MaximumFrameSize) {
+        m_hasError = true;
+
+        return false;
+    }
+
+    if (static_cast<quint32>(m_buffer.size()-frameHeaderSize)<frameSize) {
+        return false;
+    }
+
+    auto body = m_buffer.mid(frameHeaderSize, static_cast<int>(frameSize));
+
+    m_buffer.remove(0, frameHeaderSize+static_cast<int>(frameSize));
+
+    QDataStream stream(body);
+    quint8 type;
+
+    message = Message();
+
+    stream >> type >> message.jobId;
+
+    message.type = static_cast<Type>(type);
+
+    switch (message.type) {
+        case Hello: {
+            stream >> message.processId;
+            break;
+        }
+
+        case Build: {
+            stream >> message.configurationFilename >> message.outputFilename >> message.timeout >> message.profile;
+            break;
+        }
+
+        case Events: {
+            quint32 eventCount;
+
+            stream >> eventCount;
+
+            for (quint32 eventIndex = 0; (eventIndex<eventCount) && (stream.status()==QDataStream::Ok); eventIndex++) {
+                BuildEvent event;
+
+                stream >> event;
+
+                message.events.append(event);
+            }
+
+            break;
+        }
+
+        case Finished: {
+            stream >> message.result >> message.traceback >> message.scriptProfile;
+            break;
+        }
+
+        case Cancel:
+        case Quit: {
+            break;
+        }
+
+        default: {
+            message.type = Invalid;
+            break;
+        }
+    }
+
+    if ((stream.status()!=QDataStream::Ok) || (message.type==Invalid)) {
+        m_hasError = true;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Nedrysoft::BuildProtocol::Reader::hasError() const {
+    return m_hasError;
+}
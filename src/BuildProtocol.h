@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDPROTOCOL_H
+#define NEDRYSOFT_BUILDPROTOCOL_H
+
+#include "BuildEvent.h"
+#include "ScriptProfile.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildProtocol class encodes and decodes the messages exchanged with build worker processes.
+     *
+     * @details     Each message is a frame made up of a 32 bit little endian length followed by the body, the body
+     *              starts with the message type and the id of the job that the message refers to.  Events are
+     *              sent in batches so that a worker writes at most one frame per drain of its event queue.
+     */
+    class BuildProtocol {
+        public:
+            /**
+             * @brief       The kind of message.
+             */
+            enum Type : quint8 {
+                Invalid = 0,                                    /**< The message could not be decoded. */
+                Hello = 1,                                      /**< worker -> editor, the worker is ready. */
+                Build = 2,                                      /**< editor -> worker, build a configuration. */
+                Events = 3,                                     /**< worker -> editor, a batch of build events. */
+                Finished = 4,                                   /**< worker -> editor, the build has finished. */
+                Cancel = 5,                                     /**< editor -> worker, cancel the current build. */
+                Quit = 6                                        /**< editor -> worker, exit the worker process. */
+            };
+
+            /**
+             * @brief       Holds a decoded message, only the fields for the message type are valid.
+             */
+            struct Message {
+                Type type = Invalid;                            //! the kind of message
+                qint32 jobId = -1;                              //! the job the message refers to
+                qint64 processId = 0;                           //! the process id of the worker (Hello)
+                QString configurationFilename;                  //! the configuration to build (Build)
+                QString outputFilename;                         //! the output filename or empty (Build)
+                qint32 timeout = 0;                             //! the build time limit in milliseconds or 0 (Build)
+                bool profile = false;                           //! whether the build script is profiled (Build)
+                QVector<BuildEvent> events;                     //! the events (Events)
+                qint32 result = 0;                              //! the Python::ErrorCode result (Finished)
+                QString traceback;                              //! the traceback of a failed build (Finished)
+                ScriptProfile scriptProfile;                    //! the profile of a profiled build (Finished)
+            };
+
+            /**
+             * @brief       Accumulates data from a socket and splits it into messages.
+             */
+            class Reader {
+                public:
+                    /**
+                     * @brief       Adds data received from the socket.
+                     *
+                     * @param[in]   data the received data.
+                     */
+                    void append(const QByteArray &data);
+
+                    /**
+                     * @brief       Removes the next complete message.
+                     *
+                     * @param[out]  message the decoded message.
+                     *
+                     * @returns     true if a message was removed; otherwise false.
+                     */
+                    bool next(Message &message);
+
+                    /**
+                     * @brief       Returns whether the stream contained a frame that could not be decoded.
+                     *
+                     * @returns     true if the stream is corrupt; otherwise false.
+                     */
+                    bool hasError() const;
+
+                private:
+                    QByteArray m_buffer;                        //! data that has not been decoded yet
+                    bool m_hasError = false;                    //! whether a bad frame was received
+            };
+
+        public:
+            static constexpr quint32 MaximumFrameSize = 16*1024*1024;   //! frames larger than this are treated as corrupt
+
+        public:
+            /**
+             * @brief       Encodes a Hello message.
+             *
+             * @param[in]   processId the process id of the worker.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray hello(qint64 processId);
+
+            /**
+             * @brief       Encodes a Build message.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   configurationFilename the configuration to build.
+             * @param[in]   outputFilename the output filename (or empty to use the value in the configuration).
+             * @param[in]   timeout the time in milliseconds after which the build is cancelled, 0 for no limit.
+             * @param[in]   profile true if the build script should be profiled; otherwise false.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray build(qint32 jobId, const QString &configurationFilename, const QString &outputFilename, qint32 timeout = 0, bool profile = false);
+
+            /**
+             * @brief       Encodes an Events message.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   events the events.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray events(qint32 jobId, const QVector<BuildEvent> &events);
+
+            /**
+             * @brief       Encodes a Finished message.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   result the Python::ErrorCode result of the build.
+             * @param[in]   traceback the traceback of the exception that failed the build.
+             * @param[in]   scriptProfile the profile of the build script, empty if it was not profiled.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray finished(qint32 jobId, qint32 result, const QString &traceback = QString(), const ScriptProfile &scriptProfile = ScriptProfile());
+
+            /**
+             * @brief       Encodes a Cancel message.
+             *
+             * @param[in]   jobId the id of the job.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray cancel(qint32 jobId);
+
+            /**
+             * @brief       Encodes a Quit message.
+             *
+             * @returns     the frame.
+             */
+            static QByteArray quit();
+    };
+}
+
+#endif //NEDRYSOFT_BUILDPROTOCOL_H
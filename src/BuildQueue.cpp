@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! @note Python must be included first!
+
+#include "Python.h"
+
+#include "BuildQueue.h"
+
+#include "Builder.h"
+#include "PreflightCheck.h"
+
+#include <QFileInfo>
+#include <QLocale>
+#include <QThread>
+
+
+Nedrysoft::BuildQueue::BuildQueue(QObject *parent) :
+        QObject(parent),
+        m_nextId(0),
+        m_maximumJobs(qMax(1, QThread::idealThreadCount())),
+        m_runningJobs(0),
+        m_cacheEnabled(true),
+        m_timeout(0),
+        m_isProfiling(false) {
+
+    m_workerPool.setMaximumWorkers(m_maximumJobs);
+
+    connect(&m_workerPool, &BuildWorkerPool::jobEvents, this, [=](int id, QVector<Nedrysoft::BuildEvent> events) {
+        auto job = m_jobs.value(id, nullptr);
+
+        if (job) {
+            processJobEvents(job, events);
+        }
+    });
+
+    connect(&m_workerPool, &BuildWorkerPool::jobProfiled, this, [=](int id, Nedrysoft::ScriptProfile profile) {
+        auto job = m_jobs.value(id, nullptr);
+
+        if ((!job) || (job->state!=Running)) {
+            return;
+        }
+
+        job->trace.setProfile(profile);
+
+        for (auto const &line : profile.summary()) {
+            appendLog(job, line);
+        }
+    });
+
+    connect(&m_workerPool, &BuildWorkerPool::jobFinished, this, [=](int id, int result, QString traceback) {
+        auto job = m_jobs.value(id, nullptr);
+
+        if (job) {
+            onJobFinished(job, result, traceback);
+        }
+    });
+}
+
+Nedrysoft::BuildQueue::~BuildQueue() {
+    m_workerPool.disconnect(this);
+
+    qDeleteAll(m_jobs);
+}
+
+void Nedrysoft::BuildQueue::setMaximumJobs(int maximumJobs) {
+    m_maximumJobs = qMax(1, maximumJobs);
+
+    m_workerPool.setMaximumWorkers(m_maximumJobs);
+
+    startJobs();
+}
+
+int Nedrysoft::BuildQueue::maximumJobs() const {
+    return m_maximumJobs;
+}
+
+void Nedrysoft::BuildQueue::setCacheEnabled(bool isEnabled) {
+    m_cacheEnabled = isEnabled;
+}
+
+void Nedrysoft::BuildQueue::setCacheLinkEnabled(bool isEnabled) {
+    m_buildCache.setLinkEnabled(isEnabled);
+}
+
+void Nedrysoft::BuildQueue::setTimeout(int timeout) {
+    m_timeout = qMax(0, timeout);
+}
+
+void Nedrysoft::BuildQueue::setProfiling(bool isProfiling) {
+    m_isProfiling = isProfiling;
+}
+
+int Nedrysoft::BuildQueue::enqueue(const QString &configurationFilename, const QString &outputFilename, int priority) {
+    Builder builder;
+
+    // the configuration is loaded here to check that it is valid and to snapshot it for the pre-flight check, the
+    // build itself is run by a worker process.
+
+    if (!builder.loadConfiguration(configurationFilename)) {
+        return -1;
+    }
+
+    auto job = new Job{m_nextId++, priority, configurationFilename, outputFilename, Pending, BuildProgress(), QStringList()};
+
+    job->manifest = builder.manifest();
+    job->resolvedOutputFilename = builder.normalisedFilename(outputFilename.isEmpty() ? builder.property("outputfile").toString() : outputFilename);
+    job->configuration = builder.configurationSnapshot(job->resolvedOutputFilename);
+
+    m_jobs[job->id] = job;
+
+    // keep the pending list ordered by priority, jobs with the same priority are started in the order they were added
+
+    auto insertIndex = 0;
+
+    while ((insertIndex<m_pendingJobs.count()) && (m_pendingJobs[insertIndex]->priority>=priority)) {
+        insertIndex++;
+    }
+
+    m_pendingJobs.insert(insertIndex, job);
+
+    QMetaObject::invokeMethod(this, &BuildQueue::startJobs, Qt::QueuedConnection);
+
+    return job->id;
+}
+
+void Nedrysoft::BuildQueue::cancel(int id) {
+    auto job = m_jobs.value(id, nullptr);
+
+    if (!job) {
+        return;
+    }
+
+    if (job->state==Pending) {
+        m_pendingJobs.removeAll(job);
+
+        job->state = Cancelled;
+
+        Q_EMIT jobFinished(job->id, Cancelled);
+
+        if (isIdle()) {
+            Q_EMIT idle();
+        }
+    } else if (job->state==Running) {
+        // the job is finished when the worker reports that the script has unwound (or the worker is killed)
+
+        m_workerPool.cancel(job->id);
+    }
+}
+
+void Nedrysoft::BuildQueue::cancelAll() {
+    for (auto id : m_jobs.keys()) {
+        cancel(id);
+    }
+}
+
+Nedrysoft::BuildQueue::State Nedrysoft::BuildQueue::state(int id) const {
+    auto job = m_jobs.value(id, nullptr);
+
+    return job ? job->state : Failed;
+}
+
+QString Nedrysoft::BuildQueue::configurationFilename(int id) const {
+    auto job = m_jobs.value(id, nullptr);
+
+    return job ? job->configurationFilename : QString();
+}
+
+QStringList Nedrysoft::BuildQueue::log(int id) const {
+    auto job = m_jobs.value(id, nullptr);
+
+    return job ? job->log : QStringList();
+}
+
+Nedrysoft::BuildTrace Nedrysoft::BuildQueue::trace(int id) const {
+    auto job = m_jobs.value(id, nullptr);
+
+    return job ? job->trace : BuildTrace();
+}
+
+qint64 Nedrysoft::BuildQueue::remainingTime(int id) const {
+    auto job = m_jobs.value(id, nullptr);
+
+    return ((job) && (job->state==Running)) ? job->progress.remainingTime() : -1;
+}
+
+bool Nedrysoft::BuildQueue::isIdle() const {
+    return m_pendingJobs.isEmpty() && (m_runningJobs==0);
+}
+
+void Nedrysoft::BuildQueue::startJobs() {
+    while ((m_runningJobs<m_maximumJobs) && !m_pendingJobs.isEmpty()) {
+        auto job = m_pendingJobs.takeFirst();
+
+        job->state = Running;
+
+        Q_EMIT jobStarted(job->id);
+
+        // a job that would fail is stopped before the build cache is checked or a worker is started
+
+        auto preflight = PreflightCheck().check(*job->configuration);
+
+        for (auto const &line : preflight.lines()) {
+            appendLog(job, line);
+        }
+
+        if (preflight.hasErrors()) {
+            job->state = Failed;
+
+            Q_EMIT jobFinished(job->id, Failed);
+
+            continue;
+        }
+
+        if (m_cacheEnabled) {
+            QStringList cacheLog;
+
+            job->cacheKey = m_buildCache.key(job->manifest, &cacheLog);
+
+            auto isCached = m_buildCache.fetch(job->cacheKey, job->resolvedOutputFilename, &cacheLog);
+
+            if (!isCached) {
+                BuildCache::detach(job->resolvedOutputFilename, &cacheLog);
+            }
+
+            for (auto const &line : cacheLog) {
+                appendLog(job, line);
+            }
+
+            if (isCached) {
+                job->state = Finished;
+
+                Q_EMIT jobProgress(job->id, ProgressMaximum, ProgressMaximum);
+                Q_EMIT jobFinished(job->id, Finished);
+
+                continue;
+            }
+        }
+
+        m_runningJobs++;
+
+        m_workerPool.start(job->id, job->configurationFilename, job->outputFilename, m_timeout, m_isProfiling);
+    }
+
+    if (isIdle()) {
+        Q_EMIT idle();
+    }
+}
+
+void Nedrysoft::BuildQueue::processJobEvents(Job *job, const QVector<BuildEvent> &events) {
+    if (job->state!=Running) {
+        return;
+    }
+
+    job->trace.addEvents(events);
+    job->progress.addEvents(events);
+
+    for (auto const &event : events) {
+        auto line = describe(event);
+
+        if (!line.isEmpty()) {
+            appendLog(job, line);
+        }
+    }
+
+    Q_EMIT jobProgress(job->id, static_cast<int>(job->progress.fraction()*ProgressMaximum), ProgressMaximum);
+}
+
+void Nedrysoft::BuildQueue::appendLog(Job *job, const QString &line) {
+    job->log.append(line);
+
+    Q_EMIT jobLog(job->id, line);
+}
+
+void Nedrysoft::BuildQueue::onJobFinished(Job *job, int result, const QString &traceback) {
+    if (job->state!=Running) {
+        return;
+    }
+
+    if (result==Python::ScriptTimedOut) {
+        appendLog(job, tr("The build was cancelled as it took longer than %1 seconds.").arg(m_timeout/1000.0));
+    }
+
+    if (!traceback.isEmpty()) {
+        for (auto const &line : traceback.trimmed().split('\n')) {
+            appendLog(job, line);
+        }
+    }
+
+    switch (result) {
+        case Python::Ok: {
+            job->state = Finished;
+            break;
+        }
+
+        case Python::ScriptCancelled: {
+            job->state = Cancelled;
+            break;
+        }
+
+        default: {
+            job->state = Failed;
+            break;
+        }
+    }
+
+    m_runningJobs--;
+
+    if ((job->state==Finished) && (!job->cacheKey.isEmpty())) {
+        QStringList cacheLog;
+
+        m_buildCache.store(job->cacheKey, job->resolvedOutputFilename, &cacheLog);
+
+        for (auto const &line : cacheLog) {
+            appendLog(job, line);
+        }
+    }
+
+    Q_EMIT jobFinished(job->id, job->state);
+
+    startJobs();
+}
+
+QString Nedrysoft::BuildQueue::describe(const BuildEvent &event) {
+    switch (event.type) {
+        case BuildEvent::BuildStarted: {
+            return tr("Build started.");
+        }
+
+        case BuildEvent::BuildFinished: {
+            return tr("Build finished.");
+        }
+
+        case BuildEvent::OperationStart: {
+            break;
+        }
+
+        case BuildEvent::ToolOutput: {
+            return QString("%1: %2").arg(QFileInfo(event.path).fileName()).arg(event.text);
+        }
+
+        default: {
+            return QString();
+        }
+    }
+
+    switch (event.operation) {
+        case BuildEvent::SettingsLoad: {
+            return tr("Loading settings...");
+        }
+
+        case BuildEvent::SizeCalculate: {
+            return tr("Calculating DMG size...");
+        }
+
+        case BuildEvent::DmgCreate: {
+            return tr("Creating DMG...");
+        }
+
+        case BuildEvent::DmgShrink: {
+            return tr("Shrinking DMG...");
+        }
+
+        case BuildEvent::DmgAddLicense: {
+            return tr("Adding license...");
+        }
+
+        case BuildEvent::BackgroundCreate: {
+            return tr("Creating Background Image...");
+        }
+
+        case BuildEvent::FilesAdd: {
+            return tr("Adding files to DMG...");
+        }
+
+        case BuildEvent::FileAdd: {
+            return tr("Adding file \"%1\"...").arg(QFileInfo(event.path).fileName());
+        }
+
+        case BuildEvent::SymlinksAdd: {
+            return tr("Creating symlinks in DMG...");
+        }
+
+        case BuildEvent::SymlinkAdd: {
+            return tr("Adding symlink \"%1\"...").arg(event.path);
+        }
+
+        case BuildEvent::ExtensionsHide: {
+            return tr("Hiding files...");
+        }
+
+        case BuildEvent::DsStoreCreate: {
+            return tr("Creating DS_Store...");
+        }
+
+        case BuildEvent::DsStoreCached: {
+            return tr("Reusing cached DS_Store...");
+        }
+
+        case BuildEvent::DmgConvert: {
+            return tr("Compressing DMG (%1)...").arg(QLocale().formattedDataSize(event.bytes));
+        }
+
+        case BuildEvent::PayloadStaged: {
+            QLocale locale;
+            auto throughput = event.duration>0 ? static_cast<qint64>(static_cast<double>(event.bytes)*1e9/static_cast<double>(event.duration)) : event.bytes;
+
+            return tr("Staged %1 files (%2) at %3/s").arg(event.count).arg(locale.formattedDataSize(event.bytes)).arg(locale.formattedDataSize(throughput));
+        }
+
+        default: {
+            return QString();
+        }
+    }
+}
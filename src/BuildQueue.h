@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDQUEUE_H
+#define NEDRYSOFT_BUILDQUEUE_H
+
+#include "BuildCache.h"
+#include "BuildConfiguration.h"
+#include "BuildEvent.h"
+#include "BuildProgress.h"
+#include "BuildTrace.h"
+#include "BuildWorkerPool.h"
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildQueue class builds a number of DMG configurations, running several at once.
+     *
+     * @details     Each job is built by a worker process so that jobs do not share any state and a failure only
+     *              affects the job that caused it, the number of jobs that run at the same time is limited and
+     *              pending jobs are started in priority order.  Every job reports its own progress and log lines,
+     *              and any job can be cancelled individually.
+     *
+     *              A job is checked by a PreflightCheck when it is started, a job that would fail is stopped
+     *              before the build cache is checked or a worker is used.
+     */
+    class BuildQueue :
+            public QObject {
+
+        private:
+            Q_OBJECT
+
+        public:
+            static constexpr auto ProgressMaximum = 1000;       //! the maximum value passed to jobProgress
+
+        public:
+            /**
+             * @brief       The state of a job.
+             */
+            enum State {
+                Pending,                                        /**< The job is waiting to start. */
+                Running,                                        /**< The job is building. */
+                Finished,                                       /**< The job completed successfully. */
+                Failed,                                         /**< The job failed. */
+                Cancelled                                       /**< The job was cancelled. */
+            };
+
+            Q_ENUM(State)
+
+        public:
+            /**
+             * @brief       Constructs a new BuildQueue instance.
+             *
+             * @param[in]   parent the owner object.
+             */
+            explicit BuildQueue(QObject *parent = nullptr);
+
+            /**
+             * @brief       Destroys the BuildQueue.
+             *
+             * @note        The worker processes are stopped.
+             */
+            ~BuildQueue();
+
+            /**
+             * @brief       Sets the maximum number of jobs that are built at the same time.
+             *
+             * @param[in]   maximumJobs the number of jobs.
+             */
+            void setMaximumJobs(int maximumJobs);
+
+            /**
+             * @brief       Returns the maximum number of jobs that are built at the same time.
+             *
+             * @returns     the number of jobs.
+             */
+            int maximumJobs() const;
+
+            /**
+             * @brief       Sets whether jobs whose inputs have not changed reuse a previously built image.
+             *
+             * @param[in]   isEnabled true to use the build cache; otherwise false.
+             */
+            void setCacheEnabled(bool isEnabled);
+
+            /**
+             * @brief       Sets whether images from the build cache are hard linked to the output rather than copied.
+             *
+             * @note        A linked output must not be modified, see BuildCache::setLinkEnabled.
+             *
+             * @param[in]   isEnabled true to hard link cached images; otherwise false.
+             */
+            void setCacheLinkEnabled(bool isEnabled);
+
+            /**
+             * @brief       Sets the time after which a running job is cancelled.
+             *
+             * @note        Only affects jobs that are started after the call.
+             *
+             * @param[in]   timeout the time in milliseconds, 0 for no limit.
+             */
+            void setTimeout(int timeout);
+
+            /**
+             * @brief       Sets whether the build scripts of jobs are profiled.
+             *
+             * @details     The summary of the profile is added to the log of the job and the profile is added to
+             *              its trace.
+             *
+             * @note        Only affects jobs that are started after the call.
+             *
+             * @param[in]   isProfiling true if jobs should be profiled; otherwise false.
+             */
+            void setProfiling(bool isProfiling);
+
+            /**
+             * @brief       Adds a configuration to the queue.
+             *
+             * @param[in]   configurationFilename the configuration to build.
+             * @param[in]   outputFilename the output filename (or empty to use the value in the configuration).
+             * @param[in]   priority jobs with a higher priority are started first.
+             *
+             * @returns     the id of the job; or -1 if the configuration could not be loaded.
+             */
+            int enqueue(const QString &configurationFilename, const QString &outputFilename = QString(), int priority = 0);
+
+            /**
+             * @brief       Cancels a job.
+             *
+             * @param[in]   id the id of the job.
+             */
+            void cancel(int id);
+
+            /**
+             * @brief       Cancels all pending and running jobs.
+             */
+            void cancelAll();
+
+            /**
+             * @brief       Returns the state of a job.
+             *
+             * @param[in]   id the id of the job.
+             *
+             * @returns     the state.
+             */
+            State state(int id) const;
+
+            /**
+             * @brief       Returns the configuration filename of a job.
+             *
+             * @param[in]   id the id of the job.
+             *
+             * @returns     the configuration filename.
+             */
+            QString configurationFilename(int id) const;
+
+            /**
+             * @brief       Returns the log lines of a job.
+             *
+             * @param[in]   id the id of the job.
+             *
+             * @returns     the log lines.
+             */
+            QStringList log(int id) const;
+
+            /**
+             * @brief       Returns the trace of a job.
+             *
+             * @note        A job that was satisfied from the build cache has an empty trace.
+             *
+             * @param[in]   id the id of the job.
+             *
+             * @returns     the trace.
+             */
+            BuildTrace trace(int id) const;
+
+            /**
+             * @brief       Returns the estimated time until a job finishes.
+             *
+             * @param[in]   id the id of the job.
+             *
+             * @returns     the time in nanoseconds; or -1 if the job is not running or there is no estimate yet.
+             */
+            qint64 remainingTime(int id) const;
+
+            /**
+             * @brief       Returns whether the queue has no pending or running jobs.
+             *
+             * @returns     true if idle; otherwise false.
+             */
+            bool isIdle() const;
+
+        public:
+            /**
+             * @brief       This signal is emitted when a job starts building.
+             *
+             * @param[in]   id the id of the job.
+             */
+            Q_SIGNAL void jobStarted(int id);
+
+            /**
+             * @brief       This signal is emitted when the progress of a job changes.
+             *
+             * @details     The progress is estimated from the bytes processed by the build, see BuildProgress.
+             *
+             * @param[in]   id the id of the job.
+             * @param[in]   value the progress of the job.
+             * @param[in]   maximum the value when the job is complete (ProgressMaximum).
+             */
+            Q_SIGNAL void jobProgress(int id, int value, int maximum);
+
+            /**
+             * @brief       This signal is emitted when a line is added to the log of a job.
+             *
+             * @param[in]   id the id of the job.
+             * @param[in]   line the log line.
+             */
+            Q_SIGNAL void jobLog(int id, QString line);
+
+            /**
+             * @brief       This signal is emitted when a job has finished, failed or been cancelled.
+             *
+             * @param[in]   id the id of the job.
+             * @param[in]   state the final state of the job.
+             */
+            Q_SIGNAL void jobFinished(int id, Nedrysoft::BuildQueue::State state);
+
+            /**
+             * @brief       This signal is emitted when the last job in the queue has finished.
+             */
+            Q_SIGNAL void idle();
+
+        private:
+            /**
+             * @brief       Holds the information for a single job.
+             */
+            struct Job {
+                int id;                                         //! the id of the job
+                int priority;                                   //! the priority of the job
+                QString configurationFilename;                  //! the configuration to build
+                QString outputFilename;                         //! the output filename (or empty)
+                State state;                                    //! the state of the job
+                BuildProgress progress;                         //! the estimated progress of the build
+                QStringList log;                                //! the log lines
+                Builder::Manifest manifest;                     //! the inputs of the build
+                QString resolvedOutputFilename;                 //! the absolute filename of the DMG
+                QString cacheKey;                               //! the build cache key, if the cache is used
+                BuildTrace trace;                               //! the timed phases of the build
+                std::shared_ptr<const BuildConfiguration> configuration;    //! the configuration checked before the job starts
+            };
+
+            /**
+             * @brief       Starts pending jobs until the job limit is reached.
+             */
+            void startJobs();
+
+            /**
+             * @brief       Updates the progress and log of a job.
+             *
+             * @param[in]   job the job.
+             * @param[in]   events the events received from the worker.
+             */
+            void processJobEvents(Job *job, const QVector<BuildEvent> &events);
+
+            /**
+             * @brief       Adds a line to the log of a job.
+             *
+             * @param[in]   job the job.
+             * @param[in]   line the log line.
+             */
+            void appendLog(Job *job, const QString &line);
+
+            /**
+             * @brief       Called when the worker running a job has finished.
+             *
+             * @param[in]   job the job.
+             * @param[in]   result the Python::ErrorCode result of the build.
+             * @param[in]   traceback the traceback of the exception that failed the build, if any.
+             */
+            void onJobFinished(Job *job, int result, const QString &traceback);
+
+            /**
+             * @brief       Returns a plain text description of an event for the log.
+             *
+             * @param[in]   event the event.
+             *
+             * @returns     the description; or an empty string if the event is not logged.
+             */
+            static QString describe(const BuildEvent &event);
+
+        private:
+            QMap<int, Job *> m_jobs;                            //! all jobs by id
+            QList<Job *> m_pendingJobs;                         //! pending jobs in the order they will be started
+            int m_nextId;                                       //! the id of the next job
+            int m_maximumJobs;                                  //! the maximum number of running jobs
+            int m_runningJobs;                                  //! the number of running jobs
+            BuildWorkerPool m_workerPool;                       //! the worker processes that run the jobs
+            BuildCache m_buildCache;                            //! images from previous builds
+            bool m_cacheEnabled;                                //! whether the build cache is used
+            int m_timeout;                                      //! the time limit of a job in milliseconds or 0
+            bool m_isProfiling;                                 //! whether jobs are profiled
+    };
+}
+
+Q_DECLARE_METATYPE(Nedrysoft::BuildQueue::State);
+
+#endif //NEDRYSOFT_BUILDQUEUE_H
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Python.h"                         //! @note must be included first
+
+#include "BuildSettings.h"
+
+#include <tuple>
+
+/**
+ * @brief       Describes a member of a structure and the python key that it is stored under.
+ */
+template<typename Owner, typename Type>
+struct SettingsField {
+    const char *key;                                    //! the python dictionary key
+    Type Owner::*member;                                //! the member that holds the value
+};
+
+template<typename Owner, typename Type>
+static constexpr SettingsField<Owner, Type> settingsField(const char *key, Type Owner::*member) {
+    return SettingsField<Owner, Type>{key, member};
+}
+
+constexpr auto buildSettingsFields = std::make_tuple(
+    settingsField("format", &Nedrysoft::BuildSettings::format),
+    settingsField("size", &Nedrysoft::BuildSettings::size),
+    settingsField("icon", &Nedrysoft::BuildSettings::icon),
+    settingsField("background", &Nedrysoft::BuildSettings::background),
+    settingsField("show_status_bar", &Nedrysoft::BuildSettings::showStatusBar),
+    settingsField("show_tab_view", &Nedrysoft::BuildSettings::showTabView),
+    settingsField("show_toolbar", &Nedrysoft::BuildSettings::showToolbar),
+    settingsField("show_pathbar", &Nedrysoft::BuildSettings::showPathbar),
+    settingsField("show_sidebar", &Nedrysoft::BuildSettings::showSidebar),
+    settingsField("sidebar_width", &Nedrysoft::BuildSettings::sidebarWidth),
+    settingsField("window_rect", &Nedrysoft::BuildSettings::windowRect),
+    settingsField("default_view", &Nedrysoft::BuildSettings::defaultView),
+    settingsField("show_icon_preview", &Nedrysoft::BuildSettings::showIconPreview),
+    settingsField("include_icon_view_settings", &Nedrysoft::BuildSettings::includeIconViewSettings),
+    settingsField("include_list_view_settings", &Nedrysoft::BuildSettings::includeListViewSettings),
+    settingsField("arrange_by", &Nedrysoft::BuildSettings::arrangeBy),
+    settingsField("grid_offset", &Nedrysoft::BuildSettings::gridOffset),
+    settingsField("grid_spacing", &Nedrysoft::BuildSettings::gridSpacing),
+    settingsField("label_pos", &Nedrysoft::BuildSettings::labelPosition),
+    settingsField("text_size", &Nedrysoft::BuildSettings::textSize),
+    settingsField("icon_size", &Nedrysoft::BuildSettings::iconSize),
+    settingsField("list_icon_size", &Nedrysoft::BuildSettings::listIconSize),
+    settingsField("list_text_size", &Nedrysoft::BuildSettings::listTextSize),
+    settingsField("list_scroll_position", &Nedrysoft::BuildSettings::listScrollPosition),
+    settingsField("list_sort_by", &Nedrysoft::BuildSettings::listSortBy),
+    settingsField("list_use_relative_dates", &Nedrysoft::BuildSettings::listUseRelativeDates),
+    settingsField("list_calculate_all_sizes", &Nedrysoft::BuildSettings::listCalculateAllSizes),
+    settingsField("list_columns", &Nedrysoft::BuildSettings::listColumns),
+    settingsField("list_column_widths", &Nedrysoft::BuildSettings::listColumnWidths),
+    settingsField("list_column_sort_directions", &Nedrysoft::BuildSettings::listColumnSortDirections),
+    settingsField("icon_locations", &Nedrysoft::BuildSettings::iconLocations),
+    settingsField("files", &Nedrysoft::BuildSettings::files),
+    settingsField("symlinks", &Nedrysoft::BuildSettings::symlinks)
+);
+
+constexpr auto buildParametersFields = std::make_tuple(
+    settingsField("volume_name", &Nedrysoft::BuildParameters::volumeName),
+    settingsField("filename", &Nedrysoft::BuildParameters::filename),
+    settingsField("lookForHiDPI", &Nedrysoft::BuildParameters::lookForHiDPI),
+    settingsField("detach_retries", &Nedrysoft::BuildParameters::detachRetries),
+    settingsField("layout_key", &Nedrysoft::BuildParameters::layoutKey),
+    settingsField("layout_cache", &Nedrysoft::BuildParameters::layoutCache)
+);
+
+static Nedrysoft::PyRef pythonValue(bool value) {
+    return Nedrysoft::PyRef::borrowed(value ? Py_True : Py_False);
+}
+
+static Nedrysoft::PyRef pythonValue(int value) {
+    return Nedrysoft::PyRef(PyLong_FromLong(value));
+}
+
+static Nedrysoft::PyRef pythonValue(const QString &value) {
+    auto utf8 = value.toUtf8();
+
+    return Nedrysoft::PyRef(PyUnicode_FromStringAndSize(utf8.constData(), utf8.size()));
+}
+
+static Nedrysoft::PyRef pythonValue(const std::optional<QString> &value) {
+    if (!value) {
+        return Nedrysoft::PyRef::borrowed(Py_None);
+    }
+
+    return pythonValue(*value);
+}
+
+static Nedrysoft::PyRef pythonValue(const QPoint &value) {
+    return Nedrysoft::PyRef(Py_BuildValue("(ii)", value.x(), value.y()));
+}
+
+static Nedrysoft::PyRef pythonValue(const QRect &value) {
+    return Nedrysoft::PyRef(Py_BuildValue("((ii)(ii))", value.x(), value.y(), value.width(), value.height()));
+}
+
+static Nedrysoft::PyRef pythonValue(const QStringList &value) {
+    Nedrysoft::PyRef list(PyList_New(value.count()));
+
+    if (!list) {
+        return list;
+    }
+
+    for (auto index = 0; index<value.count(); index++) {
+        auto item = pythonValue(value.at(index));
+
+        if (!item) {
+            return Nedrysoft::PyRef();
+        }
+
+        // PyList_SET_ITEM steals the reference
+
+        PyList_SET_ITEM(list.get(), index, item.release());
+    }
+
+    return list;
+}
+
+template<typename Type>
+static Nedrysoft::PyRef pythonValue(const QMap<QString, Type> &value) {
+    Nedrysoft::PyRef dictionary(PyDict_New());
+
+    if (!dictionary) {
+        return dictionary;
+    }
+
+    for (auto iterator = value.constBegin(); iterator!=value.constEnd(); ++iterator) {
+        auto key = pythonValue(iterator.key());
+        auto item = pythonValue(iterator.value());
+
+        if (!key || !item || (PyDict_SetItem(dictionary.get(), key.get(), item.get())<0)) {
+            return Nedrysoft::PyRef();
+        }
+    }
+
+    return dictionary;
+}
+
+/**
+ * @brief       Converts a structure to a python dictionary using a field table.
+ *
+ * @details     The table is expanded at compile time into one conversion per field, the keys are interned the
+ *              first time that a table is used and are then shared by every dictionary created from it.
+ *
+ * @param[in]   owner the structure to convert.
+ * @param[in]   fields the field table of the structure.
+ *
+ * @returns     the dictionary; or an empty PyRef with a python exception set.
+ */
+template<typename Owner, typename ...Types>
+static Nedrysoft::PyRef marshal(const Owner &owner, const std::tuple<SettingsField<Owner, Types>...> &fields) {
+    static PyObject *keys[sizeof...(Types)] = {};
+    Nedrysoft::PyRef dictionary(PyDict_New());
+    size_t index = 0;
+
+    if (!dictionary) {
+        return dictionary;
+    }
+
+    auto setItem = [&](const auto &field) {
+        auto &key = keys[index++];
+
+        if (!key) {
+            key = PyUnicode_InternFromString(field.key);
+
+            if (!key) {
+                return false;
+            }
+        }
+
+        auto value = pythonValue(owner.*(field.member));
+
+        return value && (PyDict_SetItem(dictionary.get(), key, value.get())==0);
+    };
+
+    auto succeeded = std::apply([&](const auto &...field) {
+        return (setItem(field) && ...);
+    }, fields);
+
+    return succeeded ? dictionary : Nedrysoft::PyRef();
+}
+
+Nedrysoft::PyRef Nedrysoft::toPython(const BuildSettings &settings) {
+    return marshal(settings, buildSettingsFields);
+}
+
+Nedrysoft::PyRef Nedrysoft::toPython(const BuildParameters &parameters) {
+    return marshal(parameters, buildParametersFields);
+}
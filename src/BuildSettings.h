@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDSETTINGS_H
+#define NEDRYSOFT_BUILDSETTINGS_H
+
+#include "PyRef.h"
+
+#include <QMap>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <optional>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildSettings structure holds the settings dictionary that is passed to dmgbuild.
+     *
+     * @details     Each member corresponds to a dmgbuild setting, the defaults are the values that dmgee always
+     *              uses.  The members are converted to python using a table of keys and member pointers, so adding
+     *              a setting only needs a member and a table entry.
+     */
+    struct BuildSettings {
+        QString format;                                     //! the format of the final image
+        QString size;                                       //! the size of the writable image
+        QString icon;                                       //! the volume icon
+        QString background;                                 //! the background image
+        bool showStatusBar = false;                         //! whether the finder window shows the status bar
+        bool showTabView = false;                           //! whether the finder window shows the tab view
+        bool showToolbar = false;                           //! whether the finder window shows the toolbar
+        bool showPathbar = false;                           //! whether the finder window shows the path bar
+        bool showSidebar = false;                           //! whether the finder window shows the sidebar
+        int sidebarWidth = 180;                             //! the width of the sidebar
+        QRect windowRect;                                   //! the position and size of the finder window
+        QString defaultView = "icon-view";                  //! the view that the finder window opens in
+        bool showIconPreview = false;                       //! whether icons show a preview of the file
+        QString includeIconViewSettings = "auto";           //! whether the icon view settings are written
+        QString includeListViewSettings = "auto";           //! whether the list view settings are written
+        std::optional<QString> arrangeBy;                   //! how the icons are arranged, none by default
+        QPoint gridOffset;                                  //! the offset of the icon grid
+        int gridSpacing = 10;                               //! the spacing of the icon grid
+        QString labelPosition;                              //! the position of the icon labels
+        int textSize = 0;                                   //! the size of the icon labels
+        int iconSize = 0;                                   //! the size of the icons
+        int listIconSize = 16;                              //! the size of the icons in the list view
+        int listTextSize = 12;                              //! the size of the text in the list view
+        QPoint listScrollPosition;                          //! the scroll position of the list view
+        QString listSortBy = "name";                        //! the column that the list view is sorted by
+        bool listUseRelativeDates = true;                   //! whether the list view uses relative dates
+        bool listCalculateAllSizes = false;                 //! whether the list view calculates folder sizes
+        QStringList listColumns = {"name", "date-modified", "size", "kind", "date-added"};     //! the list view columns
+        QMap<QString, int> listColumnWidths = {             //! the width of each list view column
+            {"name", 300}, {"date-modified", 181}, {"date-created", 181}, {"date-added", 181},
+            {"date-last-opened", 181}, {"size", 97}, {"kind", 115}, {"label", 100}, {"version", 75},
+            {"comments", 300}
+        };
+        QMap<QString, QString> listColumnSortDirections = { //! the sort direction of each list view column
+            {"name", "ascending"}, {"date-modified", "descending"}, {"date-created", "descending"},
+            {"date-added", "descending"}, {"date-last-opened", "descending"}, {"size", "auto"},
+            {"kind", "ascending"}, {"label", "ascending"}, {"version", "ascending"}, {"comments", "ascending"}
+        };
+        QMap<QString, QPoint> iconLocations;                //! the position of each icon, by name
+        QStringList files;                                  //! the files that dmgbuild copies into the image
+        QMap<QString, QString> symlinks;                    //! the symlinks to create, name to target
+    };
+
+    /**
+     * @brief       The BuildParameters structure holds the values that the build script passes to build_dmg.
+     */
+    struct BuildParameters {
+        QString volumeName;                                 //! the name of the volume
+        QString filename;                                   //! the filename of the final image
+        bool lookForHiDPI = false;                          //! whether HiDPI backgrounds are searched for
+        int detachRetries = 5;                              //! the number of times a detach is attempted
+        QString layoutKey;                                  //! the layout cache key
+        QString layoutCache;                                //! the layout cache folder
+    };
+
+    /**
+     * @brief       Converts the build settings to a python dictionary.
+     *
+     * @note        The GIL must be held.
+     *
+     * @param[in]   settings the settings.
+     *
+     * @returns     the dictionary; or an empty PyRef with a python exception set.
+     */
+    PyRef toPython(const BuildSettings &settings);
+
+    /**
+     * @brief       Converts the build parameters to a python dictionary.
+     *
+     * @note        The GIL must be held.
+     *
+     * @param[in]   parameters the parameters.
+     *
+     * @returns     the dictionary; or an empty PyRef with a python exception set.
+     */
+    PyRef toPython(const BuildParameters &parameters);
+}
+
+#endif //NEDRYSOFT_BUILDSETTINGS_H
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BuildTrace.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+constexpr auto traceThreadId = 1;
+constexpr auto profileThreadId = 2;
+constexpr auto nanosecondsPerMicrosecond = 1000.0;
+
+/**
+ * @brief       The operations that start a phase of the build and the names of their spans.
+ */
+constexpr struct {
+    Nedrysoft::BuildEvent::Operation operation;
+    const char *name;
+} tracePhases[] = {
+    {Nedrysoft::BuildEvent::SettingsLoad, "settings load"},
+    {Nedrysoft::BuildEvent::SizeCalculate, "size calculation"},
+    {Nedrysoft::BuildEvent::DmgCreate, "dmg create"},
+    {Nedrysoft::BuildEvent::BackgroundCreate, "background create"},
+    {Nedrysoft::BuildEvent::FilesAdd, "files add"},
+    {Nedrysoft::BuildEvent::SymlinksAdd, "symlinks add"},
+    {Nedrysoft::BuildEvent::ExtensionsHide, "extensions hide"},
+    {Nedrysoft::BuildEvent::DsStoreCreate, "dsstore create"},
+    {Nedrysoft::BuildEvent::DsStoreCached, "dsstore cached"},
+    {Nedrysoft::BuildEvent::DmgShrink, "dmg shrink"},
+    {Nedrysoft::BuildEvent::DmgConvert, "dmg convert"},
+    {Nedrysoft::BuildEvent::DmgAddLicense, "dmg addlicense"},
+};
+
+Nedrysoft::BuildTrace::BuildTrace() :
+        m_buildSpan(-1),
+        m_phaseSpan(-1),
+        m_itemSpan(-1),
+        m_lastTimestamp(0) {
+
+}
+
+void Nedrysoft::BuildTrace::clear() {
+    m_spans.clear();
+
+    m_buildSpan = -1;
+    m_phaseSpan = -1;
+    m_itemSpan = -1;
+    m_lastTimestamp = 0;
+    m_profile = ScriptProfile();
+}
+
+int Nedrysoft::BuildTrace::openSpan(const QString &name, int depth, qint64 timestamp) {
+    Span span;
+
+    span.name = name;
+    span.depth = depth;
+    span.start = timestamp;
+
+    m_spans.append(span);
+
+    return m_spans.count()-1;
+}
+
+void Nedrysoft::BuildTrace::closeSpan(int &spanIndex, qint64 timestamp) {
+    if (spanIndex!=-1) {
+        m_spans[spanIndex].end = timestamp;
+    }
+
+    spanIndex = -1;
+}
+
+void Nedrysoft::BuildTrace::addEvent(const BuildEvent &event) {
+    auto timestamp = qMax(event.timestamp, m_lastTimestamp);
+
+    m_lastTimestamp = timestamp;
+
+    switch (event.type) {
+        case BuildEvent::BuildStarted: {
+            clear();
+
+            m_lastTimestamp = timestamp;
+            m_buildSpan = openSpan("build", 0, timestamp);
+
+            return;
+        }
+
+        case BuildEvent::BuildFinished: {
+            closeSpan(m_itemSpan, timestamp);
+            closeSpan(m_phaseSpan, timestamp);
+            closeSpan(m_buildSpan, timestamp);
+
+            return;
+        }
+
+        case BuildEvent::OperationStart: {
+            break;
+        }
+
+        default: {
+            return;
+        }
+    }
+
+    // every event ends the current item, an item only lasts until dmgbuild moves on to the next one
+
+    closeSpan(m_itemSpan, timestamp);
+
+    switch (event.operation) {
+        case BuildEvent::FileAdd:
+        case BuildEvent::SymlinkAdd: {
+            m_itemSpan = openSpan(event.operation==BuildEvent::FileAdd ? "file add" : "symlink add", 2, timestamp);
+
+            m_spans[m_itemSpan].path = event.path;
+            m_spans[m_itemSpan].bytes = event.bytes;
+            m_spans[m_itemSpan].files = 1;
+
+            if (m_phaseSpan!=-1) {
+                m_spans[m_phaseSpan].bytes += event.bytes;
+                m_spans[m_phaseSpan].files++;
+            }
+
+            return;
+        }
+
+        case BuildEvent::PayloadStaged: {
+            // the phase was opened with the expected size, the staged totals include the contents of folders
+
+            if (m_phaseSpan!=-1) {
+                m_spans[m_phaseSpan].bytes = event.bytes;
+                m_spans[m_phaseSpan].files = event.count;
+            }
+
+            return;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    for (auto const &phase : tracePhases) {
+        if (phase.operation==event.operation) {
+            closeSpan(m_phaseSpan, timestamp);
+
+            m_phaseSpan = openSpan(phase.name, 1, timestamp);
+
+            m_spans[m_phaseSpan].bytes = event.bytes;
+            m_spans[m_phaseSpan].files = event.count;
+
+            return;
+        }
+    }
+}
+
+void Nedrysoft::BuildTrace::addEvents(const QVector<BuildEvent> &events) {
+    for (auto const &event : events) {
+        addEvent(event);
+    }
+}
+
+bool Nedrysoft::BuildTrace::isEmpty() const {
+    return m_spans.isEmpty();
+}
+
+QList<Nedrysoft::BuildTrace::Span> Nedrysoft::BuildTrace::spans() const {
+    auto spans = m_spans;
+
+    for (auto &span : spans) {
+        if (span.end==0) {
+            span.end = m_lastTimestamp;
+        }
+    }
+
+    return spans;
+}
+
+void Nedrysoft::BuildTrace::setProfile(const ScriptProfile &profile) {
+    m_profile = profile;
+}
+
+Nedrysoft::ScriptProfile Nedrysoft::BuildTrace::profile() const {
+    return m_profile;
+}
+
+QJsonArray Nedrysoft::BuildTrace::traceEvents(int processId, const QString &processName) const {
+    QJsonArray traceEvents;
+
+    traceEvents.append(QJsonObject{
+        {"name", "process_name"},
+        {"ph", "M"},
+        {"pid", processId},
+        {"args", QJsonObject{{"name", processName}}}
+    });
+
+    // complete ("X") events are used, the timestamps are left on the monotonic clock so that the traces of builds
+    // that ran at the same time line up when they are combined.
+
+    for (auto const &span : spans()) {
+        QJsonObject args{
+            {"bytes", span.bytes},
+            {"files", span.files}
+        };
+
+        if (!span.path.isEmpty()) {
+            args["path"] = span.path;
+        }
+
+        traceEvents.append(QJsonObject{
+            {"name", span.name},
+            {"cat", span.depth==0 ? "build" : (span.depth==1 ? "phase" : "item")},
+            {"ph", "X"},
+            {"ts", static_cast<double>(span.start)/nanosecondsPerMicrosecond},
+            {"dur", static_cast<double>(span.end-span.start)/nanosecondsPerMicrosecond},
+            {"pid", processId},
+            {"tid", traceThreadId},
+            {"args", args}
+        });
+    }
+
+    if (m_profile.isEmpty()) {
+        return traceEvents;
+    }
+
+    // the profile only has totals, so the script is a single span with the hottest functions as its arguments
+
+    QJsonArray functions;
+
+    for (auto const &function : m_profile.functions.mid(0, ScriptProfile::DefaultSummaryCount)) {
+        functions.append(QJsonObject{
+            {"name", QString("%1.%2").arg(function.module).arg(function.name)},
+            {"calls", function.calls},
+            {"own", static_cast<double>(function.ownTime)/nanosecondsPerMicrosecond},
+            {"total", static_cast<double>(function.totalTime)/nanosecondsPerMicrosecond}
+        });
+    }
+
+    traceEvents.append(QJsonObject{
+        {"name", "thread_name"},
+        {"ph", "M"},
+        {"pid", processId},
+        {"tid", profileThreadId},
+        {"args", QJsonObject{{"name", "python"}}}
+    });
+
+    traceEvents.append(QJsonObject{
+        {"name", "python script"},
+        {"cat", "profile"},
+        {"ph", "X"},
+        {"ts", static_cast<double>(m_profile.start)/nanosecondsPerMicrosecond},
+        {"dur", static_cast<double>(m_profile.duration)/nanosecondsPerMicrosecond},
+        {"pid", processId},
+        {"tid", profileThreadId},
+        {"args", QJsonObject{{"functions", functions}}}
+    });
+
+    if (m_profile.peakMemory>=0) {
+        traceEvents.append(QJsonObject{
+            {"name", "python memory"},
+            {"ph", "C"},
+            {"ts", static_cast<double>(m_profile.start+m_profile.duration)/nanosecondsPerMicrosecond},
+            {"pid", processId},
+            {"args", QJsonObject{{"current", m_profile.currentMemory}, {"peak", m_profile.peakMemory}}}
+        });
+    }
+
+    return traceEvents;
+}
+
+bool Nedrysoft::BuildTrace::save(const QString &filename, const QJsonArray &traceEvents, QString *error) {
+    QSaveFile traceFile(filename);
+    QJsonObject trace{
+        {"traceEvents", traceEvents},
+        {"displayTimeUnit", "ms"}
+    };
+
+    if (!traceFile.open(QFile::WriteOnly)) {
+        if (error) {
+            *error = traceFile.errorString();
+        }
+
+        return false;
+    }
+
+    traceFile.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+
+    if (!traceFile.commit()) {
+        if (error) {
+            *error = traceFile.errorString();
+        }
+
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDTRACE_H
+#define NEDRYSOFT_BUILDTRACE_H
+
+#include "BuildEvent.h"
+#include "ScriptProfile.h"
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildTrace class records the phases of a build as timed spans.
+     *
+     * @details     The spans are built from the progress events of a build, each phase that dmgbuild reports starts
+     *              a span which ends when the next phase starts.  Files and symlinks that are added are recorded as
+     *              spans inside their phase.  The spans can be exported in the Chrome trace event format, which can
+     *              be loaded into chrome://tracing or Perfetto.
+     */
+    class BuildTrace {
+        public:
+            /**
+             * @brief       Holds a single span.
+             */
+            struct Span {
+                QString name;                                   //! the name of the phase or item
+                int depth = 0;                                  //! 0 for the build, 1 for a phase and 2 for an item
+                qint64 start = 0;                               //! the start time in nanoseconds (monotonic clock)
+                qint64 end = 0;                                 //! the end time in nanoseconds, 0 while open
+                qint64 bytes = 0;                               //! number of bytes processed, if known
+                qint64 files = 0;                               //! number of files processed
+                QString path;                                   //! the file or symlink an item refers to
+            };
+
+        public:
+            /**
+             * @brief       Constructs a new empty BuildTrace instance.
+             */
+            BuildTrace();
+
+            /**
+             * @brief       Removes all spans.
+             */
+            void clear();
+
+            /**
+             * @brief       Updates the trace with a progress event.
+             *
+             * @note        A BuildStarted event clears any spans from a previous build.
+             *
+             * @param[in]   event the progress event.
+             */
+            void addEvent(const BuildEvent &event);
+
+            /**
+             * @brief       Updates the trace with a list of progress events.
+             *
+             * @param[in]   events the progress events, in the order that they were generated.
+             */
+            void addEvents(const QVector<BuildEvent> &events);
+
+            /**
+             * @brief       Returns whether any spans have been recorded.
+             *
+             * @returns     true if there are no spans; otherwise false.
+             */
+            bool isEmpty() const;
+
+            /**
+             * @brief       Returns the recorded spans.
+             *
+             * @note        Spans that are still open end at the time of the most recent event.
+             *
+             * @returns     the spans in the order that they were started.
+             */
+            QList<Span> spans() const;
+
+            /**
+             * @brief       Sets the profile of the build script.
+             *
+             * @note        The profile is removed when the trace is cleared.
+             *
+             * @param[in]   profile the profile.
+             */
+            void setProfile(const ScriptProfile &profile);
+
+            /**
+             * @brief       Returns the profile of the build script.
+             *
+             * @returns     the profile; or an empty profile if the build was not profiled.
+             */
+            ScriptProfile profile() const;
+
+            /**
+             * @brief       Returns the spans as Chrome trace events.
+             *
+             * @details     If the build was profiled the script is shown as a span on a second thread holding the
+             *              functions that took the most time, along with a counter for the python memory in use.
+             *
+             * @param[in]   processId the process id that the events are shown under.
+             * @param[in]   processName the name shown for the process.
+             *
+             * @returns     the trace events.
+             */
+            QJsonArray traceEvents(int processId, const QString &processName) const;
+
+            /**
+             * @brief       Writes trace events to a Chrome trace file.
+             *
+             * @param[in]   filename the file to write.
+             * @param[in]   traceEvents the events, several traces can be combined by using different process ids.
+             * @param[out]  error if not null, receives a description of the failure.
+             *
+             * @returns     true if the file was written; otherwise false.
+             */
+            static bool save(const QString &filename, const QJsonArray &traceEvents, QString *error = nullptr);
+
+        private:
+            /**
+             * @brief       Starts a new span.
+             *
+             * @param[in]   name the name of the span.
+             * @param[in]   depth the depth of the span.
+             * @param[in]   timestamp the start time.
+             *
+             * @returns     the index of the span.
+             */
+            int openSpan(const QString &name, int depth, qint64 timestamp);
+
+            /**
+             * @brief       Ends a span if it is open.
+             *
+             * @param[in,out]   spanIndex the index of the span, set to -1.
+             * @param[in]       timestamp the end time.
+             */
+            void closeSpan(int &spanIndex, qint64 timestamp);
+
+        private:
+            QList<Span> m_spans;                                //! the recorded spans
+            int m_buildSpan;                                    //! the index of the open build span or -1
+            int m_phaseSpan;                                    //! the index of the open phase span or -1
+            int m_itemSpan;                                     //! the index of the open item span or -1
+            qint64 m_lastTimestamp;                             //! the time of the most recent event
+            ScriptProfile m_profile;                            //! the profile of the build script, if profiled
+    };
+}
+
+#endif //NEDRYSOFT_BUILDTRACE_H
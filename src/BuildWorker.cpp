@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! @note Python must be included first!
+
+#include "Python.h"
+
+#include "BuildWorker.h"
+
+#include "Builder.h"
+
+#include <QCoreApplication>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+constexpr auto workerEventInterval = 16ms;                  //! how often queued events are sent to the editor
+constexpr auto workerConnectTimeout = 5000;                 //! how long to wait for the editor to accept the connection (ms)
+
+Nedrysoft::BuildWorker::BuildWorker(const QString &serverName, QObject *parent) :
+        QObject(parent),
+        m_serverName(serverName),
+        m_builder(nullptr),
+        m_jobId(-1) {
+
+    m_eventTimer.setSingleShot(true);
+    m_eventTimer.setInterval(workerEventInterval);
+
+    connect(&m_eventTimer, &QTimer::timeout, this, &BuildWorker::sendEvents);
+    connect(&m_socket, &QLocalSocket::readyRead, this, &BuildWorker::onReadyRead);
+
+    connect(&m_socket, &QLocalSocket::disconnected, this, [=]() {
+        // the editor has gone away, there is nobody to report to so stop any build and exit
+
+        if (m_builder) {
+            m_builder->cancel();
+        }
+
+        Q_EMIT quit();
+    });
+}
+
+Nedrysoft::BuildWorker::~BuildWorker() {
+    delete m_builder;
+}
+
+bool Nedrysoft::BuildWorker::connectToServer() {
+    m_socket.connectToServer(m_serverName);
+
+    if (!m_socket.waitForConnected(workerConnectTimeout)) {
+        return false;
+    }
+
+    m_socket.write(BuildProtocol::hello(QCoreApplication::applicationPid()));
+
+    return true;
+}
+
+void Nedrysoft::BuildWorker::onReadyRead() {
+    BuildProtocol::Message message;
+
+    m_reader.append(m_socket.readAll());
+
+    while (m_reader.next(message)) {
+        switch (message.type) {
+            case BuildProtocol::Build: {
+                startBuild(message);
+                break;
+            }
+
+            case BuildProtocol::Cancel: {
+                if ((m_builder) && (message.jobId==m_jobId)) {
+                    m_builder->cancel();
+                }
+
+                break;
+            }
+
+            case BuildProtocol::Quit: {
+                Q_EMIT quit();
+                break;
+            }
+
+            default: {
+                break;
+            }
+        }
+    }
+
+    if (m_reader.hasError()) {
+        m_socket.abort();
+    }
+}
+
+void Nedrysoft::BuildWorker::startBuild(const BuildProtocol::Message &message) {
+    if (m_builder) {
+        // the editor only sends a job to an idle worker
+
+        m_socket.write(BuildProtocol::finished(message.jobId, Python::ScriptInvalid));
+
+        return;
+    }
+
+    m_jobId = message.jobId;
+    m_builder = new Builder;
+
+    if (!m_builder->loadConfiguration(message.configurationFilename)) {
+        onBuildFinished(Python::ScriptNotFound);
+
+        return;
+    }
+
+    connect(m_builder, &Builder::eventsPending, this, [=]() {
+        if (!m_eventTimer.isActive()) {
+            m_eventTimer.start();
+        }
+    }, Qt::QueuedConnection);
+
+    auto outputFilename = message.outputFilename.isEmpty() ? m_builder->property("outputfile").toString() : message.outputFilename;
+
+    m_builder->setProfiling(message.profile);
+
+    m_build = m_builder->createDMG(outputFilename, message.timeout);
+
+    if (!m_build) {
+        onBuildFinished(Python::ScriptInvalid);
+
+        return;
+    }
+
+    connect(m_build.data(), &BuildHandle::finished, this, &BuildWorker::onBuildFinished, Qt::QueuedConnection);
+}
+
+void Nedrysoft::BuildWorker::sendEvents() {
+    QVector<BuildEvent> events;
+
+    if (!m_builder) {
+        return;
+    }
+
+    if (m_builder->eventQueue().drain(events)) {
+        m_socket.write(BuildProtocol::events(m_jobId, events));
+    }
+}
+
+void Nedrysoft::BuildWorker::onBuildFinished(int result) {
+    m_eventTimer.stop();
+
+    sendEvents();
+
+    if (m_build) {
+        m_socket.write(BuildProtocol::finished(m_jobId, result, m_build->traceback(), m_build->profile()));
+    } else if ((m_builder) && (m_builder->preflightResult().hasErrors())) {
+        // a build stopped by the pre-flight check has no traceback, the problems are sent in its place
+
+        m_socket.write(BuildProtocol::finished(m_jobId, result, m_builder->preflightResult().lines().join('\n')));
+    } else {
+        m_socket.write(BuildProtocol::finished(m_jobId, result));
+    }
+
+    m_socket.flush();
+
+    m_build.clear();
+
+    // a new builder is used for every job, the interpreter and its code cache are kept
+
+    m_builder->deleteLater();
+
+    m_builder = nullptr;
+    m_jobId = -1;
+}
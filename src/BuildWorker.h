@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDWORKER_H
+#define NEDRYSOFT_BUILDWORKER_H
+
+#include "BuildHandle.h"
+#include "BuildProtocol.h"
+
+#include <QLocalSocket>
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+
+namespace Nedrysoft {
+    class Builder;
+
+    /**
+     * @brief       The BuildWorker class runs builds on behalf of the editor in a separate process.
+     *
+     * @details     The worker is started with --worker and connects to the local server of a BuildWorkerPool, it
+     *              then builds each configuration it is sent one at a time.  The interpreter stays loaded between
+     *              jobs so that a reused worker does not pay the start up cost again.  If the connection to the
+     *              editor is lost the worker exits.
+     */
+    class BuildWorker :
+            public QObject {
+
+        private:
+            Q_OBJECT
+
+        public:
+            /**
+             * @brief       Constructs a new BuildWorker instance.
+             *
+             * @param[in]   serverName the name of the local server to connect to.
+             * @param[in]   parent the owner object.
+             */
+            explicit BuildWorker(const QString &serverName, QObject *parent = nullptr);
+
+            /**
+             * @brief       Destroys the BuildWorker.
+             */
+            ~BuildWorker();
+
+            /**
+             * @brief       Connects to the editor.
+             *
+             * @returns     true if connected; otherwise false.
+             */
+            bool connectToServer();
+
+            /**
+             * @brief       This signal is emitted when the worker should exit.
+             */
+            Q_SIGNAL void quit();
+
+        private:
+            /**
+             * @brief       Reads and handles any messages that have been received.
+             */
+            void onReadyRead();
+
+            /**
+             * @brief       Starts building a configuration.
+             *
+             * @param[in]   message the Build message.
+             */
+            void startBuild(const BuildProtocol::Message &message);
+
+            /**
+             * @brief       Sends the events that are waiting in the builder event queue.
+             */
+            void sendEvents();
+
+            /**
+             * @brief       Called when the builder has finished, the traceback of a failed build is sent with the
+             *              result.
+             *
+             * @param[in]   result the Python::ErrorCode result of the build.
+             */
+            void onBuildFinished(int result);
+
+        private:
+            QString m_serverName;                               //! the name of the local server
+            QLocalSocket m_socket;                              //! the connection to the editor
+            BuildProtocol::Reader m_reader;                     //! splits received data into messages
+            Builder *m_builder;                                 //! the builder for the current job
+            QSharedPointer<BuildHandle> m_build;                //! the handle of the current build
+            qint32 m_jobId;                                     //! the id of the current job or -1
+            QTimer m_eventTimer;                                //! sends queued build events once per frame
+    };
+}
+
+#endif //NEDRYSOFT_BUILDWORKER_H
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! @note Python must be included first!
+
+#include "Python.h"
+
+#include "BuildWorkerPool.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimer>
+#include <memory>
+
+constexpr auto workerOption = "--worker";
+constexpr auto workerCancelTimeout = 5000;                  //! how long a cancelled worker has to stop before it is killed (ms)
+constexpr auto workerQuitTimeout = 1000;                    //! how long a worker has to exit when the pool is destroyed (ms)
+constexpr auto maximumSpawnFailures = 3;                    //! workers in a row that may fail to start before pending jobs fail
+
+Nedrysoft::BuildWorkerPool::BuildWorkerPool(QObject *parent) :
+        QObject(parent),
+        m_maximumWorkers(qMax(1, QThread::idealThreadCount())),
+        m_spawnFailures(0) {
+
+    auto serverName = QString("dmgee-%1-%2")
+            .arg(QCoreApplication::applicationPid())
+            .arg(QRandomGenerator::global()->generate(), 8, 16, QChar('0'));
+
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(&m_server, &QLocalServer::newConnection, this, &BuildWorkerPool::onNewConnection);
+
+    if (!m_server.listen(serverName)) {
+        qWarning() << "unable to start build worker server" << m_server.errorString();
+    }
+}
+
+Nedrysoft::BuildWorkerPool::~BuildWorkerPool() {
+    for (auto worker : m_workers) {
+        worker->process->disconnect(this);
+
+        if (worker->socket) {
+            worker->socket->disconnect(this);
+            worker->socket->write(BuildProtocol::quit());
+            worker->socket->flush();
+        }
+    }
+
+    for (auto worker : m_workers) {
+        if (!worker->process->waitForFinished(workerQuitTimeout)) {
+            worker->process->kill();
+            worker->process->waitForFinished();
+        }
+
+        delete worker->socket;
+        delete worker->process;
+        delete worker;
+    }
+}
+
+void Nedrysoft::BuildWorkerPool::setMaximumWorkers(int maximumWorkers) {
+    m_maximumWorkers = qMax(1, maximumWorkers);
+
+    dispatch();
+}
+
+void Nedrysoft::BuildWorkerPool::start(int jobId, const QString &configurationFilename, const QString &outputFilename, int timeout, bool isProfiling) {
+    m_pendingJobs.append(PendingJob{jobId, QFileInfo(configurationFilename).absoluteFilePath(), outputFilename, timeout, isProfiling});
+
+    dispatch();
+}
+
+void Nedrysoft::BuildWorkerPool::cancel(int jobId) {
+    for (auto jobIndex = 0; jobIndex < m_pendingJobs.count(); jobIndex++) {
+        if (m_pendingJobs[jobIndex].jobId==jobId) {
+            m_pendingJobs.removeAt(jobIndex);
+
+            Q_EMIT jobFinished(jobId, Python::ScriptCancelled, QString());
+
+            return;
+        }
+    }
+
+    for (auto worker : m_workers) {
+        if ((worker->jobId==jobId) && (worker->socket)) {
+            QPointer<QProcess> process = worker->process;
+
+            worker->isCancelRequested = true;
+            worker->socket->write(BuildProtocol::cancel(jobId));
+
+            // a worker that is stuck in native code will not see the cancellation, so it is killed instead
+
+            QTimer::singleShot(workerCancelTimeout, this, [=]() {
+                for (auto currentWorker : m_workers) {
+                    if ((currentWorker->process==process) && (currentWorker->jobId==jobId)) {
+                        process->kill();
+                    }
+                }
+            });
+
+            return;
+        }
+    }
+}
+
+void Nedrysoft::BuildWorkerPool::dispatch() {
+    for (auto worker : m_workers) {
+        if (m_pendingJobs.isEmpty()) {
+            break;
+        }
+
+        if ((worker->socket) && (worker->jobId==-1)) {
+            auto job = m_pendingJobs.takeFirst();
+
+            worker->jobId = job.jobId;
+            worker->isCancelRequested = false;
+            worker->socket->write(BuildProtocol::build(job.jobId, job.configurationFilename, job.outputFilename, job.timeout, job.isProfiling));
+        }
+    }
+
+    // workers that are still starting will pick up a job once they connect
+
+    auto startingWorkers = 0;
+
+    for (auto worker : m_workers) {
+        if (!worker->socket) {
+            startingWorkers++;
+        }
+    }
+
+    while ((m_pendingJobs.count()>startingWorkers) && (m_workers.count()<m_maximumWorkers)) {
+        startWorker();
+
+        startingWorkers++;
+    }
+}
+
+void Nedrysoft::BuildWorkerPool::startWorker() {
+    auto worker = new Worker{new QProcess, nullptr, BuildProtocol::Reader(), -1, false};
+
+    // worker output is passed straight through so that python errors are still visible
+
+    worker->process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+    // stop the worker from appearing in the dock, it never shows a window
+
+    auto environment = QProcessEnvironment::systemEnvironment();
+
+    environment.insert("QT_MAC_DISABLE_FOREGROUND_APPLICATION_TRANSFORM", "1");
+
+    worker->process->setProcessEnvironment(environment);
+
+    connect(worker->process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (exitStatus==QProcess::CrashExit) {
+            removeWorker(worker, tr("The build worker crashed (%1).").arg(worker->process->errorString()));
+        } else {
+            removeWorker(worker, tr("The build worker exited unexpectedly (%1).").arg(exitCode));
+        }
+    });
+
+    connect(worker->process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error) {
+        if (error==QProcess::FailedToStart) {
+            removeWorker(worker, tr("The build worker could not be started (%1).").arg(worker->process->errorString()));
+        }
+    });
+
+    m_workers.append(worker);
+
+    worker->process->start(QCoreApplication::applicationFilePath(), QStringList() << workerOption << m_server.fullServerName());
+}
+
+void Nedrysoft::BuildWorkerPool::onNewConnection() {
+    while (m_server.hasPendingConnections()) {
+        auto socket = m_server.nextPendingConnection();
+
+        // the worker is not known until it has identified itself with a hello message
+
+        auto reader = std::make_shared<BuildProtocol::Reader>();
+
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+
+        connect(socket, &QLocalSocket::readyRead, this, [=]() {
+            auto helloReader = reader;
+            BuildProtocol::Message message;
+
+            helloReader->append(socket->readAll());
+
+            if (!helloReader->next(message)) {
+                if (helloReader->hasError()) {
+                    socket->abort();
+                }
+
+                return;
+            }
+
+            socket->disconnect(this);
+
+            Worker *helloWorker = nullptr;
+
+            for (auto worker : m_workers) {
+                if ((message.type==BuildProtocol::Hello) && (!worker->socket) && (worker->process->processId()==message.processId)) {
+                    helloWorker = worker;
+                }
+            }
+
+            if (!helloWorker) {
+                socket->abort();
+
+                return;
+            }
+
+            // the socket now belongs to the worker and is released when the worker is removed
+
+            disconnect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+
+            helloWorker->socket = socket;
+            helloWorker->reader = *helloReader;
+
+            m_spawnFailures = 0;
+
+            connect(socket, &QLocalSocket::readyRead, this, [=]() {
+                onWorkerReadyRead(helloWorker);
+            });
+
+            onWorkerReadyRead(helloWorker);
+
+            dispatch();
+        });
+    }
+}
+
+void Nedrysoft::BuildWorkerPool::onWorkerReadyRead(Worker *worker) {
+    BuildProtocol::Message message;
+
+    worker->reader.append(worker->socket->readAll());
+
+    while (worker->reader.next(message)) {
+        if (message.jobId!=worker->jobId) {
+            continue;
+        }
+
+        switch (message.type) {
+            case BuildProtocol::Events: {
+                Q_EMIT jobEvents(message.jobId, message.events);
+                break;
+            }
+
+            case BuildProtocol::Finished: {
+                worker->jobId = -1;
+
+                if (!message.scriptProfile.isEmpty()) {
+                    Q_EMIT jobProfiled(message.jobId, message.scriptProfile);
+                }
+
+                Q_EMIT jobFinished(message.jobId, message.result, message.traceback);
+
+                break;
+            }
+
+            default: {
+                break;
+            }
+        }
+    }
+
+    if (worker->reader.hasError()) {
+        worker->process->kill();
+
+        return;
+    }
+
+    dispatch();
+}
+
+void Nedrysoft::BuildWorkerPool::removeWorker(Worker *worker, const QString &reason) {
+    if (!m_workers.removeOne(worker)) {
+        return;
+    }
+
+    auto jobId = worker->jobId;
+    auto isCancelRequested = worker->isCancelRequested;
+    QList<PendingJob> failedJobs;
+
+    if (worker->socket) {
+        worker->socket->disconnect(this);
+        worker->socket->deleteLater();
+    } else if (++m_spawnFailures>=maximumSpawnFailures) {
+        // workers keep failing to start, so the waiting jobs fail rather than starting workers indefinitely.  A
+        // single failure is not reported, dispatch starts a replacement.
+
+        failedJobs = m_pendingJobs;
+
+        m_pendingJobs.clear();
+        m_spawnFailures = 0;
+    }
+
+    worker->process->disconnect(this);
+    worker->process->deleteLater();
+
+    delete worker;
+
+    // a worker that was killed because it did not stop in time was still cancelled by the user
+
+    if ((jobId!=-1) && (isCancelRequested)) {
+        Q_EMIT jobFinished(jobId, Python::ScriptCancelled, QString());
+    } else if (jobId!=-1) {
+        Q_EMIT jobFinished(jobId, Python::ScriptFailed, reason);
+    }
+
+    for (auto const &job : failedJobs) {
+        Q_EMIT jobFinished(job.jobId, Python::ScriptFailed, reason);
+    }
+
+    dispatch();
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_BUILDWORKERPOOL_H
+#define NEDRYSOFT_BUILDWORKERPOOL_H
+
+#include "BuildEvent.h"
+#include "BuildProtocol.h"
+
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+#include <QVector>
+
+class QLocalSocket;
+class QProcess;
+
+namespace Nedrysoft {
+    /**
+     * @brief       The BuildWorkerPool class runs builds in separate worker processes.
+     *
+     * @details     Workers are copies of the application started with --worker, they connect back to a local
+     *              server owned by the pool and are sent one job at a time using the BuildProtocol.  Idle workers
+     *              are kept and reused for later jobs, a worker that crashes or hangs only fails the job that it
+     *              was running and is replaced when another job needs it.
+     */
+    class BuildWorkerPool :
+            public QObject {
+
+        private:
+            Q_OBJECT
+
+        public:
+            /**
+             * @brief       Constructs a new BuildWorkerPool instance.
+             *
+             * @param[in]   parent the owner object.
+             */
+            explicit BuildWorkerPool(QObject *parent = nullptr);
+
+            /**
+             * @brief       Destroys the BuildWorkerPool, all workers are told to exit.
+             */
+            ~BuildWorkerPool();
+
+            /**
+             * @brief       Sets the maximum number of worker processes.
+             *
+             * @param[in]   maximumWorkers the number of workers.
+             */
+            void setMaximumWorkers(int maximumWorkers);
+
+            /**
+             * @brief       Starts a job, if no worker is available the job waits for one.
+             *
+             * @param[in]   jobId the id that identifies the job in signals, chosen by the caller.
+             * @param[in]   configurationFilename the configuration to build.
+             * @param[in]   outputFilename the output filename (or empty to use the value in the configuration).
+             * @param[in]   timeout the time in milliseconds after which the worker cancels the build, 0 for no limit.
+             * @param[in]   isProfiling true if the worker should profile the build script; otherwise false.
+             */
+            void start(int jobId, const QString &configurationFilename, const QString &outputFilename = QString(), int timeout = 0, bool isProfiling = false);
+
+            /**
+             * @brief       Cancels a job.
+             *
+             * @note        If the worker does not stop within a few seconds the process is killed.
+             *
+             * @param[in]   jobId the id of the job.
+             */
+            void cancel(int jobId);
+
+        public:
+            /**
+             * @brief       This signal is emitted when a batch of events is received for a job.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   events the events.
+             */
+            Q_SIGNAL void jobEvents(int jobId, QVector<Nedrysoft::BuildEvent> events);
+
+            /**
+             * @brief       This signal is emitted when a job has finished.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   result the Python::ErrorCode result of the job.
+             * @param[in]   traceback the traceback of the exception that failed the job, if any.
+             */
+            Q_SIGNAL void jobFinished(int jobId, int result, QString traceback);
+
+            /**
+             * @brief       This signal is emitted before jobFinished when a profiled job returns its profile.
+             *
+             * @param[in]   jobId the id of the job.
+             * @param[in]   profile the profile of the build script.
+             */
+            Q_SIGNAL void jobProfiled(int jobId, Nedrysoft::ScriptProfile profile);
+
+        private:
+            /**
+             * @brief       Holds the state of a worker process.
+             */
+            struct Worker {
+                QProcess *process;                              //! the worker process
+                QLocalSocket *socket;                           //! the connection to the worker, once it has said hello
+                BuildProtocol::Reader reader;                   //! splits received data into messages
+                int jobId;                                      //! the job the worker is running or -1
+                bool isCancelRequested;                         //! whether the job has been asked to stop
+            };
+
+            /**
+             * @brief       Holds a job that is waiting for a worker.
+             */
+            struct PendingJob {
+                int jobId;                                      //! the id of the job
+                QString configurationFilename;                  //! the configuration to build
+                QString outputFilename;                         //! the output filename
+                int timeout;                                    //! the build time limit in milliseconds or 0
+                bool isProfiling;                               //! whether the build script is profiled
+            };
+
+            /**
+             * @brief       Gives pending jobs to idle workers and starts new workers if needed.
+             */
+            void dispatch();
+
+            /**
+             * @brief       Starts a new worker process.
+             */
+            void startWorker();
+
+            /**
+             * @brief       Handles a new connection from a worker.
+             */
+            void onNewConnection();
+
+            /**
+             * @brief       Handles messages received from a worker.
+             *
+             * @param[in]   worker the worker.
+             */
+            void onWorkerReadyRead(Worker *worker);
+
+            /**
+             * @brief       Removes a worker that has exited or failed, the job it was running fails.
+             *
+             * @details     A worker that exits before it connects is replaced by dispatch, the pending jobs only fail
+             *              once maximumSpawnFailures workers in a row have failed to start.
+             *
+             * @param[in]   worker the worker.
+             * @param[in]   reason the reason that the worker exited, reported to the jobs that fail.
+             */
+            void removeWorker(Worker *worker, const QString &reason);
+
+        private:
+            QLocalServer m_server;                              //! the server that workers connect to
+            QList<Worker *> m_workers;                          //! the worker processes
+            QList<PendingJob> m_pendingJobs;                    //! jobs waiting for a worker
+            int m_maximumWorkers;                               //! the maximum number of worker processes
+            int m_spawnFailures;                                //! the number of workers in a row that failed to start
+    };
+}
+
+#endif //NEDRYSOFT_BUILDWORKERPOOL_H
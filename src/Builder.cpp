@@ -23,19 +23,30 @@
 
 #include "Builder.h"
 
+#include "BuildSettings.h"
+#include "DirectoryImageBackend.h"
+#include "FeatureDetector.h"
+#include "HdiutilImageBackend.h"
 #include "Helper.h"
 #include "Image.h"
 #include "MacHelper.h"
+#include "ToolProcess.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QMap>
 #include <QPoint>
+#include <QRect>
 #include <QRegularExpression>
+#include <QStandardPaths>
 #include <QStyle>
 #include <QTextStream>
+#include <chrono>
 #include <optional>
 
 constexpr auto BuildScript = R"(
@@ -43,13 +54,159 @@ constexpr auto BuildScript = R"(
 
 import sys
 import os
+import platform
+import shutil
+
+# dmgbuild reads the macOS version when it is imported, a version is supplied so that builds can be run elsewhere
+# with the directory image backend.
+
+if not platform.mac_ver()[0]:
+    platform.mac_ver = lambda *args: ('10.15', ('', '', ''), '')
+
 import dmgbuild
+import dmgbuild.core
+import dmgee
+from ds_store import DSStore
 
 def dmg_callback(data):
-    import dmgee
-    import simplejson
+    dmgee.update(data)
+
+# the payload is copied into the mounted image by dmgee rather than by ditto, dmgbuild calls the create hook once the
+# image has been created and mounted.
+
+def stage_payload(mount_point, options):
+    dmgee.stage(mount_point)
+
+settings["create_hook"] = stage_payload
+
+# every hdiutil command is performed by the image backend selected in dmgee.  The other tools that dmgbuild runs are
+# run by dmgee so that their output is streamed into the build log.  Away from macOS those tools are not available,
+# attributes are not set and aliases are left empty.
+
+def install_image_backend():
+    import subprocess
+
+    def hdiutil(cmd, *args, **kwargs):
+        return dmgee.image(cmd, list(args), kwargs.get('plist', True))
+
+    dmgbuild.core.hdiutil = hdiutil
+
+    class Tools(object):
+        def __getattr__(self, name):
+            return getattr(subprocess, name)
+
+        def call(self, args, *call_args, **call_kwargs):
+            if (sys.platform != 'darwin') and (args[0] == '/usr/bin/SetFile'):
+                return 0
+
+            return dmgee.run([str(arg) for arg in args])
+
+        def check_call(self, args, *call_args, **call_kwargs):
+            exit_code = self.call(args)
+
+            if exit_code != 0:
+                raise subprocess.CalledProcessError(exit_code, args)
+
+            return 0
+
+    dmgbuild.core.subprocess = Tools()
+
+    if sys.platform == 'darwin':
+        return
+
+    class EmptyAlias(object):
+        @staticmethod
+        def for_file(path):
+            return EmptyAlias()
+
+        def to_bytes(self):
+            return b''
+
+    dmgbuild.core.Alias = EmptyAlias
+    dmgbuild.core.Bookmark = EmptyAlias
+
+install_image_backend()
+
+# the .DS_Store only depends on the layout, so it is cached under a hash of the layout.  On a hit the new store is
+# created from the cached records and only the records that hold aliases to the new volume are written.
+
+def install_layout_cache(cache_folder, layout_key):
+    cached_store = os.path.join(cache_folder, layout_key + '.DS_Store')
+    volume_records = ('icvp', 'pBBk')
+
+    class IgnoredEntry(object):
+        def __setitem__(self, code, value):
+            pass
+
+    class VolumeEntry(object):
+        def __init__(self, entry):
+            self.entry = entry
+
+        def __setitem__(self, code, value):
+            if code in volume_records:
+                self.entry[code] = value
+
+    class CachedStore(object):
+        def __init__(self, store):
+            self.store = store
+
+        def __enter__(self):
+            return self
+
+        def __exit__(self, *args):
+            self.store.close()
+            return False
+
+        def __getitem__(self, filename):
+            if filename == '.':
+                return VolumeEntry(self.store['.'])
+
+            return IgnoredEntry()
+
+    class StoringStore(object):
+        def __init__(self, store, path):
+            self.store = store
+            self.path = path
+
+        def __enter__(self):
+            return self
+
+        def __exit__(self, exc_type, exc_value, traceback):
+            self.store.close()
+
+            if exc_type is None:
+                os.makedirs(cache_folder, exist_ok=True)
+                temporary_store = '%s.%d.tmp' % (cached_store, os.getpid())
+                shutil.copyfile(self.path, temporary_store)
+                os.replace(temporary_store, cached_store)
+
+            return False
+
+        def __getitem__(self, filename):
+            return self.store[filename]
+
+    class LayoutCacheDSStore(object):
+        @staticmethod
+        def open(file_or_name, mode='r+', initial_entries=None):
+            if not isinstance(file_or_name, str) or os.path.basename(file_or_name) != '.DS_Store' or 'w' not in mode:
+                return DSStore.open(file_or_name, mode, initial_entries)
+
+            if os.path.isfile(cached_store):
+                dmgee.event(dmgee.EVENT_OPERATION_START, dmgee.OPERATION_DSSTORE_CACHED)
+
+                # ds_store does not keep its record count correct when records are replaced, so rather than editing
+                # a copy of the cached store a new store is built from the cached records.
 
-    dmgee.update(simplejson.dumps(data))
+                with DSStore.open(cached_store, 'r') as cached:
+                    entries = [entry for entry in cached if not (entry.filename == '.' and entry.code.decode('latin_1') in volume_records)]
+
+                return CachedStore(DSStore.open(file_or_name, 'w+', entries))
+
+            return StoringStore(DSStore.open(file_or_name, mode, initial_entries), file_or_name)
+
+    dmgbuild.core.DSStore = LayoutCacheDSStore
+
+install_layout_cache(parameters["layout_cache"], parameters["layout_key"])
 
 dmgbuild.build_dmg(volume_name=parameters["volume_name"],
                        filename=parameters["filename"],
@@ -59,6 +216,9 @@ dmgbuild.build_dmg(volume_name=parameters["volume_name"],
                        callback=dmg_callback)
 )";
 
+constexpr auto layoutCacheFolderName = "layout";                  //! the .DS_Store cache, under the users cache folder
+constexpr qint64 progressEventInterval = 50*1000*1000;            //! the minimum time between progress events (ns)
+
 constexpr auto configurationHeader = R"(
 # This file was generated by dmgee on [date]
 #
@@ -70,16 +230,183 @@ constexpr auto configurationHeader = R"(
 
 PyMethodDef Nedrysoft::Builder::m_moduleMethods[] = {
     {"update", (PyCFunction) Nedrysoft::Builder::update, METH_O, PyDoc_STR("provides gui with updates from python")},
+    {"event", (PyCFunction) (void (*)(void)) Nedrysoft::Builder::event, METH_VARARGS | METH_KEYWORDS, PyDoc_STR("emits a typed build event")},
+    {"stage", (PyCFunction) Nedrysoft::Builder::stage, METH_VARARGS, PyDoc_STR("copies the payload into the mounted image")},
+    {"image", (PyCFunction) Nedrysoft::Builder::image, METH_VARARGS, PyDoc_STR("performs an hdiutil command with the image backend")},
+    {"configuration", (PyCFunction) Nedrysoft::Builder::configuration, METH_NOARGS, PyDoc_STR("returns the configuration that the build was started with")},
+    {"run", (PyCFunction) Nedrysoft::Builder::run, METH_VARARGS, PyDoc_STR("runs a tool and streams its output into the build log")},
     {NULL},
 };
 
+/**
+ * @brief       The names used by dmgbuild for each event type and operation, and the constants exported to python.
+ */
+constexpr struct {
+    const char *name;
+    const char *constant;
+    Nedrysoft::BuildEvent::Type type;
+} eventTypes[] = {
+    {"build::started", "EVENT_BUILD_STARTED", Nedrysoft::BuildEvent::BuildStarted},
+    {"build::finished", "EVENT_BUILD_FINISHED", Nedrysoft::BuildEvent::BuildFinished},
+    {"operation::start", "EVENT_OPERATION_START", Nedrysoft::BuildEvent::OperationStart},
+    {"operation::progress", "EVENT_OPERATION_PROGRESS", Nedrysoft::BuildEvent::OperationProgress},
+};
+
+constexpr struct {
+    const char *name;
+    const char *constant;
+    Nedrysoft::BuildEvent::Operation operation;
+} eventOperations[] = {
+    {"settings::load", "OPERATION_SETTINGS_LOAD", Nedrysoft::BuildEvent::SettingsLoad},
+    {"size::calculate", "OPERATION_SIZE_CALCULATE", Nedrysoft::BuildEvent::SizeCalculate},
+    {"dmg::create", "OPERATION_DMG_CREATE", Nedrysoft::BuildEvent::DmgCreate},
+    {"dmg::shrink", "OPERATION_DMG_SHRINK", Nedrysoft::BuildEvent::DmgShrink},
+    {"dmg::addlicense", "OPERATION_DMG_ADDLICENSE", Nedrysoft::BuildEvent::DmgAddLicense},
+    {"background::create", "OPERATION_BACKGROUND_CREATE", Nedrysoft::BuildEvent::BackgroundCreate},
+    {"files::add", "OPERATION_FILES_ADD", Nedrysoft::BuildEvent::FilesAdd},
+    {"file::add", "OPERATION_FILE_ADD", Nedrysoft::BuildEvent::FileAdd},
+    {"symlinks::add", "OPERATION_SYMLINKS_ADD", Nedrysoft::BuildEvent::SymlinksAdd},
+    {"symlink::add", "OPERATION_SYMLINK_ADD", Nedrysoft::BuildEvent::SymlinkAdd},
+    {"extensions::hide", "OPERATION_EXTENSIONS_HIDE", Nedrysoft::BuildEvent::ExtensionsHide},
+    {"dsstore::create", "OPERATION_DSSTORE_CREATE", Nedrysoft::BuildEvent::DsStoreCreate},
+    {"dsstore::cached", "OPERATION_DSSTORE_CACHED", Nedrysoft::BuildEvent::DsStoreCached},
+    {"payload::staged", "OPERATION_PAYLOAD_STAGED", Nedrysoft::BuildEvent::PayloadStaged},
+    {"dmg::convert", "OPERATION_DMG_CONVERT", Nedrysoft::BuildEvent::DmgConvert},
+};
+
+/**
+ * @brief       Interned python strings used to decode the dmgbuild progress dictionaries.
+ *
+ * @note        Created the first time an event is decoded, the GIL is held at that point.
+ */
+struct EventKeys {
+    PyObject *type;                                         //! the "type" key
+    PyObject *operation;                                    //! the "operation" key
+    PyObject *file;                                         //! the "file" key
+    PyObject *target;                                       //! the "target" key
+    PyObject *bytes;                                        //! the "bytes" key
+    PyObject *count;                                        //! the "count" key
+    PyObject *types;                                        //! dictionary of type name to BuildEvent::Type
+    PyObject *operations;                                   //! dictionary of operation name to BuildEvent::Operation
+};
+
+static const EventKeys &eventKeys() {
+    static EventKeys keys = []() {
+        EventKeys keys;
+
+        keys.type = PyUnicode_InternFromString("type");
+        keys.operation = PyUnicode_InternFromString("operation");
+        keys.file = PyUnicode_InternFromString("file");
+        keys.target = PyUnicode_InternFromString("target");
+        keys.bytes = PyUnicode_InternFromString("bytes");
+        keys.count = PyUnicode_InternFromString("count");
+        keys.types = PyDict_New();
+        keys.operations = PyDict_New();
+
+        for (auto const &eventType : eventTypes) {
+            auto value = PyLong_FromLong(eventType.type);
+
+            PyDict_SetItemString(keys.types, eventType.name, value);
+
+            Py_DECREF(value);
+        }
+
+        for (auto const &eventOperation : eventOperations) {
+            auto value = PyLong_FromLong(eventOperation.operation);
+
+            PyDict_SetItemString(keys.operations, eventOperation.name, value);
+
+            Py_DECREF(value);
+        }
+
+        return keys;
+    }();
+
+    return keys;
+}
+
+static qint64 eventTimestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static QString eventPath(PyObject *value) {
+    Py_ssize_t length;
+
+    if ((!value) || (!PyUnicode_Check(value))) {
+        return QString();
+    }
+
+    auto data = PyUnicode_AsUTF8AndSize(value, &length);
+
+    return data ? QString::fromUtf8(data, static_cast<int>(length)) : QString();
+}
+
 Nedrysoft::Builder::Builder() :
+        m_configuration(),
         m_filename(QString()),
-        m_isModified(false) {
+        m_isModified(false),
+        m_python(new Nedrysoft::Python),
+        m_imageBackend(createImageBackend(qEnvironmentVariable(ImageBackendVariable))),
+        m_progressBytes(0),
+        m_progressTimestamp(0),
+        m_progressOperation(BuildEvent::NoOperation),
+        m_isBuildCancelled(false) {
+
+    if (!m_imageBackend) {
+        m_imageBackend = createImageBackend(QString());
+    }
+
+    m_imageBackend->setProgressFunction([this](qint64 bytes) {
+        addProgress(bytes);
+    });
+
+    m_imageBackend->setOutputFunction([this](const QString &program, BuildEvent::Channel channel, const QString &line) {
+        addToolOutput(program, channel, line);
+    });
+
+    m_python->addModule("dmgee", m_moduleMethods);
+    m_python->setVariable("builderInstance", this);
+
+    connect(m_python, &Nedrysoft::Python::finished, this, [=](int result, int pythonResult) {
+        Q_EMIT buildFinished(result);
+    }, Qt::QueuedConnection);
+
+    for (auto const &eventType : eventTypes) {
+        m_python->addModuleConstant("dmgee", eventType.constant, eventType.type);
+    }
+
+    for (auto const &eventOperation : eventOperations) {
+        m_python->addModuleConstant("dmgee", eventOperation.constant, eventOperation.operation);
+    }
 
     clear();
 }
 
+Nedrysoft::Builder::~Builder() {
+    delete m_python;
+    delete m_imageBackend;
+}
+
+Nedrysoft::IImageBackend *Nedrysoft::Builder::createImageBackend(const QString &name) {
+    if (name.isEmpty()) {
+#if defined(Q_OS_MACOS)
+        return new HdiutilImageBackend;
+#else
+        return new DirectoryImageBackend;
+#endif
+    }
+
+    if (name==HdiutilImageBackend::Name) {
+        return new HdiutilImageBackend;
+    }
+
+    if (name==DirectoryImageBackend::Name) {
+        return new DirectoryImageBackend;
+    }
+
+    return nullptr;
+}
+
 QString Nedrysoft::Builder::normalisedFilename(QString filename) {
     filename = filename.replace(QRegularExpression("(^~)"), QDir::homePath());
 
@@ -96,174 +423,259 @@ QString Nedrysoft::Builder::normalisedFilename(QString filename) {
     return QDir::cleanPath(filename);
 }
 
+Nedrysoft::Builder::Manifest Nedrysoft::Builder::manifest() {
+    Manifest manifest;
+    QStringList lines;
+
+    auto backgroundFilename = normalisedFilename(property("background").toString());
+    auto iconFilename = normalisedFilename(property("icon").toString());
+    auto titleBarHeight = qobject_cast<QApplication *>(QApplication::instance())->style()->pixelMetric(QStyle::PM_TitleBarHeight);
+
+    // the build script is part of the manifest so that changes to it invalidate earlier builds
+
+    lines << QString("script=%1").arg(QString::fromLatin1(QCryptographicHash::hash(BuildScript, QCryptographicHash::Sha256).toHex()));
+    lines << QString("volumename=%1").arg(property("volumename").toString());
+    lines << QString("format=%1").arg(property("format").toString());
+    lines << QString("textposition=%1").arg(property("textposition").toString());
+    lines << QString("iconsize=%1").arg(property("iconsize").toInt());
+    lines << QString("titlebarheight=%1").arg(titleBarHeight);
+    lines << QString("background=%1").arg(QFileInfo(backgroundFilename).fileName());
+    lines << QString("icon=%1").arg(QFileInfo(iconFilename).fileName());
+
+    manifest.inputs << backgroundFilename << iconFilename;
+
+    for (auto file : m_configuration.m_files) {
+        auto absoluteFilename = normalisedFilename(file->file);
+
+        lines << QString("file=%1,%2,%3").arg(QFileInfo(absoluteFilename).fileName()).arg(file->x).arg(file->y);
+
+        manifest.inputs << absoluteFilename;
+    }
+
+    for (auto symlink : m_configuration.m_symlinks) {
+        lines << QString("symlink=%1,%2,%3,%4").arg(symlink->name).arg(normalisedFilename(symlink->shortcut)).arg(symlink->x).arg(symlink->y);
+    }
+
+    manifest.configuration = lines.join("\n").toUtf8();
+
+    return manifest;
+}
+
 QString Nedrysoft::Builder::outputFilename() {
     return  normalisedFilename(m_outputFilename);
 }
 
-bool Nedrysoft::Builder::createDMG(QString filename) {
-    QList<QString> modulePaths;
+QSharedPointer<Nedrysoft::BuildHandle> Nedrysoft::Builder::createDMG(QString filename, int timeout) {
     int imageWidth, imageHeight;
 
+    if (m_python->isRunning()) {
+        return QSharedPointer<BuildHandle>();
+    }
+
     auto dmgFilename = normalisedFilename(filename);
     auto backgroundFilename = normalisedFilename(property("background").toString());
     auto iconFilename = normalisedFilename(property("icon").toString());
 
     m_outputFilename = dmgFilename;
 
+    // the configuration is checked before the background is loaded, a build that would fail stops here rather
+    // than after the image has been created.
+
+    auto buildConfiguration = configurationSnapshot(dmgFilename);
+
+    m_preflightResult = PreflightCheck().check(*buildConfiguration);
+
+    if (m_preflightResult.hasErrors()) {
+        return QSharedPointer<BuildHandle>();
+    }
+
     if (QFileInfo(backgroundFilename).exists()) {
         auto backgroundImage = Nedrysoft::Image(backgroundFilename, true);
 
         imageWidth = static_cast<int>(backgroundImage.width());
         imageHeight = static_cast<int>(backgroundImage.height());
     } else {
-        return false;
+        return QSharedPointer<BuildHandle>();
     }
 
-    auto python = new Nedrysoft::Python();
+    auto titleBarHeight = qobject_cast<QApplication *>(QApplication::instance())->style()->pixelMetric(QStyle::PM_TitleBarHeight);
+
+    // the .DS_Store is cached under a hash of the values that it is generated from, so a build where only the
+    // payload has changed can reuse it.
+
+    QCryptographicHash layoutHash(QCryptographicHash::Sha256);
+    QMap<QString, QPoint> iconPositions;
+    QFile backgroundFile(backgroundFilename);
 
-    auto locals = PyDict_New();
+    layoutHash.addData(BuildScript);
 
-    auto parameters = PyDict_New();
+    layoutHash.addData(QString("%1,%2,%3,%4,%5,%6")
+            .arg(imageWidth)
+            .arg(imageHeight+titleBarHeight)
+            .arg(property("iconsize").toInt())
+            .arg(property("textsize").toInt())
+            .arg(property("textposition").toString())
+            .arg(QFileInfo(backgroundFilename).fileName()).toUtf8());
+
+    for (auto file : m_configuration.m_files) {
+        iconPositions[QFileInfo(normalisedFilename(file->file)).fileName()] = QPoint(file->x, file->y);
+    }
 
-    PyDict_SetItemString(parameters, "volume_name", PyUnicode_FromString( property("volumename").toString().toLatin1().constData()));
+    for (auto symlink : m_configuration.m_symlinks) {
+        iconPositions[symlink->name] = QPoint(symlink->x, symlink->y);
+    }
 
-    PyDict_SetItemString(parameters, "filename",
-                         PyUnicode_FromString(dmgFilename.toLatin1().constData()));
+    for (auto iconIterator = iconPositions.constBegin(); iconIterator!=iconPositions.constEnd(); ++iconIterator) {
+        layoutHash.addData(QString("%1=%2,%3").arg(iconIterator.key()).arg(iconIterator.value().x()).arg(iconIterator.value().y()).toUtf8());
+    }
 
-    PyDict_SetItemString(parameters, "lookForHiDPI", Py_False);
-    PyDict_SetItemString(parameters, "detach_retries", PyLong_FromLong(5));
+    if (backgroundFile.open(QFile::ReadOnly)) {
+        layoutHash.addData(&backgroundFile);
+    }
 
-    auto settings = PyDict_New();
+    auto layoutKey = layoutHash.result().toHex();
 
-    PyDict_SetItemString(settings, "format", PyUnicode_FromString(property("format").toString().toLatin1().constData()));
-    PyDict_SetItemString(settings, "size", Py_None);
-    PyDict_SetItemString(settings, "icon", PyUnicode_FromString(iconFilename.toLatin1().constData()));
-    PyDict_SetItemString(settings, "background", PyUnicode_FromString(backgroundFilename.toLatin1().constData()));
+    // dmgbuild does not copy the payload, so the size of the image is taken from the scan of everything that is
+    // copied into it that was made by the pre-flight check.
 
-    PyDict_SetItemString(settings, "show_status_bar", Py_False);
-    PyDict_SetItemString(settings, "show_tab_view", Py_False);
-    PyDict_SetItemString(settings, "show_toolbar", Py_False);
-    PyDict_SetItemString(settings, "show_pathbar", Py_False);
-    PyDict_SetItemString(settings, "show_sidebar", Py_False);
+    m_payload.clear();
 
-    PyDict_SetItemString(settings, "sidebar_width", PyLong_FromLong(180));
+    for (auto file : m_configuration.m_files) {
+        m_payload.append(normalisedFilename(file->file));
+    }
 
-    auto titleBarHeight = qobject_cast<QApplication *>(QApplication::instance())->style()->pixelMetric(QStyle::PM_TitleBarHeight);
+    auto dmgSize = m_preflightResult.imageSize;
+    auto layoutCacheFolder = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(layoutCacheFolderName);
 
-    auto windowRectOrigin = PyTuple_Pack(2, PyLong_FromLong(0), PyLong_FromLong(0));
-    auto windowRectSize = PyTuple_Pack(2, PyLong_FromLong(imageWidth), PyLong_FromLong(imageHeight+titleBarHeight));
+    BuildSettings settings;
 
-    auto windowRect = PyTuple_Pack(2, windowRectOrigin, windowRectSize);
+    settings.format = property("format").toString();
+    settings.size = QString("%1K").arg(dmgSize/1024);
+    settings.icon = iconFilename;
+    settings.background = backgroundFilename;
+    settings.windowRect = QRect(0, 0, imageWidth, imageHeight+titleBarHeight);
+    settings.labelPosition = property("textposition").toString();
+    settings.textSize = property("iconsize").toInt();
+    settings.iconSize = static_cast<int>(property("iconsize").toFloat()/1.333333);
 
-    PyDict_SetItemString(settings, "window_rect", windowRect);
+    settings.iconLocations = iconPositions;
 
-    PyDict_SetItemString(settings, "default_view", PyUnicode_FromString("icon-view"));
-    PyDict_SetItemString(settings, "show_icon_preview", Py_False);
+    for (auto symlink : m_configuration.m_symlinks) {
+        settings.symlinks[symlink->name] = normalisedFilename(symlink->shortcut);
+    }
 
-    PyDict_SetItemString(settings, "include_icon_view_settings", PyUnicode_FromString("auto"));
-    PyDict_SetItemString(settings, "include_list_view_settings", PyUnicode_FromString("auto"));
+    BuildParameters parameters;
 
-    PyDict_SetItemString(settings, "arrange_by", Py_None);
+    parameters.volumeName = property("volumename").toString();
+    parameters.filename = dmgFilename;
+    parameters.layoutKey = QString::fromLatin1(layoutKey);
+    parameters.layoutCache = layoutCacheFolder;
 
-    auto gridOffset = PyTuple_Pack(2, PyLong_FromLong(0), PyLong_FromLong(0));
+    // scripts read the configuration through dmgee.configuration(), the copy is not modified after this point so
+    // the build thread can read it while the user continues to edit the layout.
 
-    PyDict_SetItemString(settings, "grid_offset", gridOffset);
-    PyDict_SetItemString(settings, "grid_spacing", PyLong_FromLong(10));
-    PyDict_SetItemString(settings, "label_pos", PyUnicode_FromString(property("textposition").toString().toLatin1().constData()));
-    PyDict_SetItemString(settings, "text_size", PyLong_FromLong(property("iconsize").toInt()));
-    PyDict_SetItemString(settings, "icon_size", PyLong_FromLong(property("iconsize").toFloat()/1.333333));
+    buildConfiguration->windowSize = settings.windowRect.size();
 
-    PyDict_SetItemString(settings, "list_icon_size", PyLong_FromLong(16));
-    PyDict_SetItemString(settings, "list_text_size", PyLong_FromLong(12));
+    m_buildConfiguration = buildConfiguration;
 
-    auto listScrollPosition = PyTuple_Pack(2, PyLong_FromLong(0), PyLong_FromLong(0));
+    // the interpreter is shared and normally already running, the GIL must be held while the settings are converted
 
-    PyDict_SetItemString(settings, "list_scroll_position", listScrollPosition);
-    PyDict_SetItemString(settings, "list_sort_by", PyUnicode_FromString("name"));
-    PyDict_SetItemString(settings, "list_use_relative_dates", Py_True);
-    PyDict_SetItemString(settings, "list_calculate_all_sizes", Py_False);
+    Nedrysoft::Python::initialise();
 
-    auto listColumns = PyTuple_Pack(5,
-                                    PyUnicode_FromString("name"),
-                                    PyUnicode_FromString("date-modified"),
-                                    PyUnicode_FromString("size"),
-                                    PyUnicode_FromString("kind"),
-                                    PyUnicode_FromString("date-added"));
+    PyObject *locals = nullptr;
 
-    PyDict_SetItemString(settings, "list_columns", listColumns);
+    auto gilState = PyGILState_Ensure();
 
-    auto listColumnWidths = PyDict_New();
+    // the references are scoped so that they are released before the GIL
 
-    PyDict_SetItemString(listColumnWidths, "name", PyLong_FromLong(300));
-    PyDict_SetItemString(listColumnWidths, "date-modified", PyLong_FromLong(181));
-    PyDict_SetItemString(listColumnWidths, "date-created", PyLong_FromLong(181));
-    PyDict_SetItemString(listColumnWidths, "date-added", PyLong_FromLong(181));
-    PyDict_SetItemString(listColumnWidths, "date-last-opened", PyLong_FromLong(181));
-    PyDict_SetItemString(listColumnWidths, "size", PyLong_FromLong(97));
-    PyDict_SetItemString(listColumnWidths, "kind", PyLong_FromLong(115));
-    PyDict_SetItemString(listColumnWidths, "label", PyLong_FromLong(100));
-    PyDict_SetItemString(listColumnWidths, "version", PyLong_FromLong(75));
-    PyDict_SetItemString(listColumnWidths, "comments", PyLong_FromLong(300));
+    {
+        auto settingsObject = toPython(settings);
+        auto parametersObject = toPython(parameters);
+        PyRef localsObject(PyDict_New());
 
-    PyDict_SetItemString(settings, "list_column_widths", listColumnWidths);
+        if (settingsObject && parametersObject && localsObject &&
+            (PyDict_SetItemString(localsObject.get(), "settings", settingsObject.get())==0) &&
+            (PyDict_SetItemString(localsObject.get(), "parameters", parametersObject.get())==0)) {
 
-    auto listColumnSortDirections = PyDict_New();
+            locals = localsObject.release();
+        } else {
+            PyErr_Print();
+        }
+    }
 
-    PyDict_SetItemString(listColumnSortDirections, "name", PyUnicode_FromString("ascending"));
-    PyDict_SetItemString(listColumnSortDirections, "date-modified", PyUnicode_FromString("descending"));
-    PyDict_SetItemString(listColumnSortDirections, "date-created", PyUnicode_FromString("descending"));
-    PyDict_SetItemString(listColumnSortDirections, "date-added", PyUnicode_FromString("descending"));
-    PyDict_SetItemString(listColumnSortDirections, "date-last-opened", PyUnicode_FromString("descending"));
-    PyDict_SetItemString(listColumnSortDirections, "size", PyUnicode_FromString("auto"));
-    PyDict_SetItemString(listColumnSortDirections, "kind", PyUnicode_FromString("ascending"));
-    PyDict_SetItemString(listColumnSortDirections, "label", PyUnicode_FromString("ascending"));
-    PyDict_SetItemString(listColumnSortDirections, "version", PyUnicode_FromString("ascending"));
-    PyDict_SetItemString(listColumnSortDirections, "comments", PyUnicode_FromString("ascending"));
+    PyGILState_Release(gilState);
 
-    PyDict_SetItemString(settings, "list_column_sort_directions", listColumnSortDirections);
+    if (!locals) {
+        return QSharedPointer<BuildHandle>();
+    }
 
-    auto symLinks = PyDict_New();
-    auto files = PyList_New(0);
-    auto iconLocations = PyDict_New();
+    // the backend is told when the build is cancelled so that it can stop copying and kill any child process, the
+    // script would otherwise not see the interrupt until the native call had returned.
 
-    for(auto file : m_configuration.m_files) {
-        auto absoluteFilename = normalisedFilename(file->file);
-        QFileInfo currentFileInfo(absoluteFilename);
+    m_imageBackend->setCancelled(false);
 
-        PyList_Append(files, PyUnicode_FromString(absoluteFilename.toLatin1().data()));
+    m_isBuildCancelled = false;
 
-        auto position = PyTuple_Pack(2, PyLong_FromLong(file->x), PyLong_FromLong(file->y));
+    m_build = m_python->runScript(BuildScript, locals);
 
-        PyDict_SetItemString(iconLocations, currentFileInfo.fileName().toUtf8().data(), position);
-    }
+    connect(m_build.data(), &BuildHandle::cancelRequested, this, [this, backend = m_imageBackend]() {
+        m_isBuildCancelled = true;
+
+        backend->setCancelled(true);
+    }, Qt::DirectConnection);
+
+    m_build->setTimeout(timeout);
+
+    return m_build;
+}
 
-    for(auto symlink : m_configuration.m_symlinks) {
-        auto absoluteFilename = normalisedFilename(symlink->shortcut);
+std::shared_ptr<Nedrysoft::BuildConfiguration> Nedrysoft::Builder::configurationSnapshot(const QString &outputFilename) {
+    auto buildConfiguration = std::make_shared<BuildConfiguration>();
 
-        PyDict_SetItemString(symLinks, symlink->name.toLatin1().constData(), PyUnicode_FromString(absoluteFilename.toLatin1().constData()));
+    buildConfiguration->volumeName = property("volumename").toString();
+    buildConfiguration->format = property("format").toString();
+    buildConfiguration->outputFilename = outputFilename;
+    buildConfiguration->background = property("background").toString().isEmpty() ? QString() : normalisedFilename(property("background").toString());
+    buildConfiguration->icon = property("icon").toString().isEmpty() ? QString() : normalisedFilename(property("icon").toString());
+    buildConfiguration->textPosition = property("textposition").toString();
+    buildConfiguration->iconSize = property("iconsize").toInt();
+    buildConfiguration->textSize = property("textsize").toInt();
+    buildConfiguration->gridSize = property("gridsize").toSize();
 
-        auto position = PyTuple_Pack(2, PyLong_FromLong(symlink->x), PyLong_FromLong(symlink->y));
+    buildConfiguration->files.reserve(m_configuration.m_files.count());
+    buildConfiguration->symlinks.reserve(m_configuration.m_symlinks.count());
 
-        PyDict_SetItemString(iconLocations, symlink->name.toLatin1().constData(), position);
+    for (auto file : m_configuration.m_files) {
+        buildConfiguration->files.append(BuildConfiguration::File{normalisedFilename(file->file), QPoint(file->x, file->y)});
     }
 
-    PyDict_SetItemString(settings, "icon_locations", iconLocations);
-    PyDict_SetItemString(settings, "files", files);
-    PyDict_SetItemString(settings, "symlinks", symLinks);
+    for (auto symlink : m_configuration.m_symlinks) {
+        buildConfiguration->symlinks.append(BuildConfiguration::Symlink{symlink->name, normalisedFilename(symlink->shortcut), QPoint(symlink->x, symlink->y)});
+    }
 
-    PyDict_SetItemString(locals, "settings", settings);
-    PyDict_SetItemString(locals, "parameters", parameters);
+    return buildConfiguration;
+}
 
-    modulePaths.push_back("python/packages");
+Nedrysoft::PreflightCheck::Result Nedrysoft::Builder::preflight(const QString &outputFilename) {
+    return PreflightCheck().check(*configurationSnapshot(normalisedFilename(outputFilename)));
+}
 
-    //python->addModulePaths(modulePaths);
-    python->addModule("dmgee", m_moduleMethods);
+Nedrysoft::PreflightCheck::Result Nedrysoft::Builder::preflightResult() const {
+    return m_preflightResult;
+}
 
-    python->setVariable("builderInstance", this);
+bool Nedrysoft::Builder::isBuilding() const {
+    return m_python->isRunning();
+}
 
-    python->runScript(BuildScript, locals);
+void Nedrysoft::Builder::cancel() {
+    if (m_build) {
+        m_build->cancel();
+    }
+}
 
-    return true;
+void Nedrysoft::Builder::setProfiling(bool isProfiling) {
+    m_python->setProfiling(isProfiling);
 }
 
 bool Nedrysoft::Builder::saveConfiguration(const QString &filename) {
@@ -458,20 +870,403 @@ QList<Nedrysoft::Builder::File *> Nedrysoft::Builder::files() {
 
 PyObject* Nedrysoft::Builder::update(PyObject *self, PyObject *updateData)
 {
-    auto unicodeString = PyUnicode_AsUCS4Copy(updateData);
     auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+    auto const &keys = eventKeys();
+    Nedrysoft::BuildEvent event;
+
+    if ((!builderInstance) || (!PyDict_Check(updateData))) {
+        Py_RETURN_FALSE;
+    }
+
+    event.timestamp = eventTimestamp();
+
+    // the values are the string constants in dmgbuild, so their hashes are already cached and each lookup is cheap
+
+    auto typeName = PyDict_GetItemWithError(updateData, keys.type);
+    auto type = typeName ? PyDict_GetItemWithError(keys.types, typeName) : nullptr;
+
+    if (type) {
+        event.type = static_cast<Nedrysoft::BuildEvent::Type>(PyLong_AsLong(type));
+    }
+
+    auto operationName = PyDict_GetItemWithError(updateData, keys.operation);
+    auto operation = operationName ? PyDict_GetItemWithError(keys.operations, operationName) : nullptr;
+
+    if (operation) {
+        event.operation = static_cast<Nedrysoft::BuildEvent::Operation>(PyLong_AsLong(operation));
+    }
+
+    event.path = eventPath(PyDict_GetItemWithError(updateData, keys.file));
+
+    if (event.path.isNull()) {
+        event.path = eventPath(PyDict_GetItemWithError(updateData, keys.target));
+    }
+
+    auto bytes = PyDict_GetItemWithError(updateData, keys.bytes);
+
+    if ((bytes) && (PyLong_Check(bytes))) {
+        event.bytes = PyLong_AsLongLong(bytes);
+    }
+
+    auto count = PyDict_GetItemWithError(updateData, keys.count);
+
+    if ((count) && (PyLong_Check(count))) {
+        event.count = PyLong_AsLongLong(count);
+    }
+
+    PyErr_Clear();
+
+    if (builderInstance->m_eventQueue.push(event)) {
+        Q_EMIT builderInstance->eventsPending();
+    }
+
+    Py_RETURN_TRUE;
+}
+
+PyObject *Nedrysoft::Builder::event(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"type", "operation", "path", "bytes", "count", nullptr};
+    auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+    int type, operation = Nedrysoft::BuildEvent::NoOperation;
+    const char *path = nullptr;
+    long long bytes = 0, count = 0;
+    Nedrysoft::BuildEvent event;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|izLL", const_cast<char **>(keywords), &type, &operation, &path, &bytes, &count)) {
+        return nullptr;
+    }
+
+    event.timestamp = eventTimestamp();
+    event.type = static_cast<Nedrysoft::BuildEvent::Type>(type);
+    event.operation = static_cast<Nedrysoft::BuildEvent::Operation>(operation);
+    event.path = path ? QString::fromUtf8(path) : QString();
+    event.bytes = bytes;
+    event.count = count;
 
-    if (unicodeString) {
-        auto jsonString = QString::fromUcs4(unicodeString);
+    if ((builderInstance) && (builderInstance->m_eventQueue.push(event))) {
+        Q_EMIT builderInstance->eventsPending();
+    }
+
+    Py_RETURN_NONE;
+}
 
-        PyMem_Free(unicodeString);
+PyObject *Nedrysoft::Builder::stage(PyObject *self, PyObject *args) {
+    auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+    Nedrysoft::PayloadStager::Statistics statistics;
+    const char *mountPoint = nullptr;
+    Nedrysoft::BuildEvent event;
+    QString error;
+    auto isStaged = true;
+
+    if (!PyArg_ParseTuple(args, "s", &mountPoint)) {
+        return nullptr;
+    }
+
+    if (!builderInstance) {
+        Py_RETURN_NONE;
+    }
+
+    auto destinationFolder = QString::fromUtf8(mountPoint);
+
+    builderInstance->startProgress(Nedrysoft::BuildEvent::FilesAdd, builderInstance->m_preflightResult.payload.bytes);
+
+    event.type = Nedrysoft::BuildEvent::OperationStart;
+
+    // the copy does not touch any python objects, so other python threads can run while it is in progress
+
+    Py_BEGIN_ALLOW_THREADS
+
+    for (auto const &filename : builderInstance->m_payload) {
+        event.operation = Nedrysoft::BuildEvent::FileAdd;
+        event.timestamp = eventTimestamp();
+        event.path = filename;
+
+        if (builderInstance->m_eventQueue.push(event)) {
+            Q_EMIT builderInstance->eventsPending();
+        }
+
+        if (!builderInstance->m_imageBackend->populate(destinationFolder, filename, statistics, error)) {
+            isStaged = false;
+
+            break;
+        }
+    }
+
+    Py_END_ALLOW_THREADS
+
+    if (!isStaged) {
+        PyErr_SetString(PyExc_OSError, error.toUtf8().constData());
+
+        return nullptr;
+    }
 
-        Q_EMIT builderInstance->progressUpdate(jsonString);
+    event.operation = Nedrysoft::BuildEvent::PayloadStaged;
+    event.timestamp = eventTimestamp();
+    event.path = QString();
+    event.bytes = statistics.bytes;
+    event.count = statistics.files;
+    event.duration = statistics.duration;
 
-        return Py_True;
+    if (builderInstance->m_eventQueue.push(event)) {
+        Q_EMIT builderInstance->eventsPending();
     }
 
-    return Py_False;
+    Py_RETURN_NONE;
+}
+
+void Nedrysoft::Builder::startProgress(BuildEvent::Operation operation, qint64 bytes) {
+    Nedrysoft::BuildEvent event;
+
+    m_progressOperation = operation;
+    m_progressBytes = 0;
+    m_progressTimestamp = eventTimestamp();
+
+    event.type = Nedrysoft::BuildEvent::OperationStart;
+    event.operation = operation;
+    event.bytes = bytes;
+    event.timestamp = m_progressTimestamp;
+
+    if (m_eventQueue.push(event)) {
+        Q_EMIT eventsPending();
+    }
+}
+
+void Nedrysoft::Builder::addProgress(qint64 bytes) {
+    auto totalBytes = (m_progressBytes += bytes);
+    std::unique_lock<std::mutex> progressLock(m_progressMutex, std::try_to_lock);
+
+    // the event queue has a single producer, so only the thread holding the lock may push
+
+    if (!progressLock.owns_lock()) {
+        return;
+    }
+
+    auto timestamp = eventTimestamp();
+
+    if (timestamp-m_progressTimestamp<progressEventInterval) {
+        return;
+    }
+
+    Nedrysoft::BuildEvent event;
+
+    event.type = Nedrysoft::BuildEvent::OperationProgress;
+    event.operation = m_progressOperation;
+    event.bytes = qMax(totalBytes, m_progressBytes.load());
+    event.timestamp = timestamp;
+
+    m_progressTimestamp = timestamp;
+
+    if (m_eventQueue.push(event)) {
+        Q_EMIT eventsPending();
+    }
+}
+
+void Nedrysoft::Builder::addToolOutput(const QString &program, BuildEvent::Channel channel, const QString &line) {
+    std::lock_guard<std::mutex> progressLock(m_progressMutex);
+    Nedrysoft::BuildEvent event;
+
+    event.type = Nedrysoft::BuildEvent::ToolOutput;
+    event.timestamp = eventTimestamp();
+    event.path = program;
+    event.channel = channel;
+    event.text = line;
+
+    if (m_eventQueue.push(event)) {
+        Q_EMIT eventsPending();
+    }
+}
+
+PyObject *Nedrysoft::Builder::run(PyObject *self, PyObject *args) {
+    auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+    PyObject *argumentList = nullptr;
+    Nedrysoft::ToolProcess::Result result;
+    QStringList arguments;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &argumentList)) {
+        return nullptr;
+    }
+
+    for (Py_ssize_t argumentIndex = 0; argumentIndex<PyList_Size(argumentList); argumentIndex++) {
+        arguments.append(eventPath(PyList_GetItem(argumentList, argumentIndex)));
+    }
+
+    if (arguments.isEmpty()) {
+        PyErr_SetString(PyExc_ValueError, "no tool was given");
+
+        return nullptr;
+    }
+
+    auto program = arguments.takeFirst();
+
+    // the tool is killed if the build is cancelled, as the KeyboardInterrupt is not seen until the GIL is taken back
+
+    auto tool = Nedrysoft::ToolProcess([builderInstance, &program](BuildEvent::Channel channel, const QString &line) {
+        if ((builderInstance) && (!line.trimmed().isEmpty())) {
+            builderInstance->addToolOutput(program, channel, line);
+        }
+    }, [builderInstance]() {
+        return (builderInstance) && (builderInstance->m_isBuildCancelled);
+    });
+
+    Py_BEGIN_ALLOW_THREADS
+
+    result = tool.run(program, arguments);
+
+    Py_END_ALLOW_THREADS
+
+    if (!result.isStarted) {
+        PyErr_Format(PyExc_OSError, "%s: %s", program.toUtf8().constData(), result.errorString.toUtf8().constData());
+
+        return nullptr;
+    }
+
+    return PyLong_FromLong(result.exitCode);
+}
+
+QStringList Nedrysoft::Builder::imageContents() {
+    QStringList contents;
+
+    for (auto file : m_configuration.m_files) {
+        contents.append(normalisedFilename(file->file));
+    }
+
+    for (auto const &filename : {property("background").toString(), property("icon").toString()}) {
+        if (!filename.isEmpty()) {
+            contents.append(normalisedFilename(filename));
+        }
+    }
+
+    return contents;
+}
+
+qint64 Nedrysoft::Builder::imageSize(const QStringList &contents, int symlinks, PayloadScanner::Totals *totals) {
+    auto scanTotals = PayloadScanner().scan(contents);
+
+    scanTotals.symlinks += symlinks;
+
+    if (totals) {
+        *totals = scanTotals;
+    }
+
+    return PayloadScanner::imageSize(scanTotals);
+}
+
+static qint64 imageSizeFromString(const QString &size) {
+    auto multiplier = 1.0;
+    auto value = size.toLower();
+
+    // hdiutil sizes are in bytes unless they end with a unit, dmgbuild gives its sizes in kilobytes
+
+    if (value.endsWith('k')) {
+        multiplier = 1024.0;
+    } else if (value.endsWith('m')) {
+        multiplier = 1024.0*1024.0;
+    } else if (value.endsWith('g')) {
+        multiplier = 1024.0*1024.0*1024.0;
+    }
+
+    if (multiplier>1.0) {
+        value.chop(1);
+    }
+
+    return static_cast<qint64>(value.toDouble()*multiplier);
+}
+
+PyObject *Nedrysoft::Builder::image(PyObject *self, PyObject *args) {
+    auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+    PyObject *argumentList = nullptr;
+    const char *commandName = nullptr;
+    QString device, mountPoint, error;
+    QStringList arguments;
+    auto isSuccess = false;
+    int isPlist = 1;
+
+    if (!PyArg_ParseTuple(args, "sO!|p", &commandName, &PyList_Type, &argumentList, &isPlist)) {
+        return nullptr;
+    }
+
+    if (!builderInstance) {
+        PyErr_SetString(PyExc_RuntimeError, "no image backend is available");
+
+        return nullptr;
+    }
+
+    for (Py_ssize_t argumentIndex = 0; argumentIndex<PyList_Size(argumentList); argumentIndex++) {
+        arguments.append(eventPath(PyList_GetItem(argumentList, argumentIndex)));
+    }
+
+    auto backend = builderInstance->m_imageBackend;
+    auto command = QString::fromUtf8(commandName);
+    auto filename = arguments.isEmpty() ? QString() : arguments.last();
+
+    auto option = [&arguments](const QString &name) {
+        auto optionIndex = arguments.indexOf(name);
+
+        return ((optionIndex!=-1) && (optionIndex+1<arguments.count())) ? arguments[optionIndex+1] : QString();
+    };
+
+    // the arguments are those that dmgbuild passes to hdiutil, the image is always the last argument except for
+    // convert, where it is the first.  dmgbuild does not report the conversion, which is where most of the time is
+    // spent, so it is reported here.  The writable image holds at least the payload, so for a backend whose image
+    // is not a single file the payload size is used.
+
+    if (command=="convert") {
+        auto inputSize = QFileInfo(arguments.value(0)).size();
+
+        builderInstance->startProgress(Nedrysoft::BuildEvent::DmgConvert, qMax(inputSize, builderInstance->m_preflightResult.payload.bytes));
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+
+    if (command=="create") {
+        isSuccess = backend->create(filename, option("-volname"), imageSizeFromString(option("-size")), error);
+    } else if (command=="attach") {
+        isSuccess = backend->attach(filename, device, mountPoint, error);
+    } else if (command=="detach") {
+        isSuccess = backend->detach(filename, arguments.contains("-force"), error);
+    } else if (command=="resize") {
+        isSuccess = backend->shrink(filename, error);
+    } else if (command=="convert") {
+        auto compressionLevel = option("-imagekey").section('=', 1).toInt();
+
+        isSuccess = backend->convert(arguments.value(0), option("-format"), option("-o"), compressionLevel, error);
+    } else {
+        error = QString("%1 is not supported by the %2 image backend").arg(command).arg(backend->name());
+    }
+
+    Py_END_ALLOW_THREADS
+
+    if (!isSuccess) {
+        // detach is retried by dmgbuild, so it is given an exit code rather than an exception
+
+        if (command=="detach") {
+            return Py_BuildValue("(iy)", 1, error.toUtf8().constData());
+        }
+
+        PyErr_SetString(PyExc_OSError, QString("%1: %2").arg(command).arg(error).toUtf8().constData());
+
+        return nullptr;
+    }
+
+    if (!isPlist) {
+        return Py_BuildValue("(iy)", 0, "");
+    }
+
+    if (command=="attach") {
+        return Py_BuildValue("(i{s[{ssss}]})", 0, "system-entities", "dev-entry", device.toUtf8().constData(), "mount-point", mountPoint.toUtf8().constData());
+    }
+
+    return Py_BuildValue("(i{})", 0);
+}
+
+PyObject *Nedrysoft::Builder::configuration(PyObject *self, PyObject *args) {
+    auto builderInstance = static_cast<Nedrysoft::Builder *>(Python::variable("builderInstance"));
+
+    if ((!builderInstance) || (!builderInstance->m_buildConfiguration)) {
+        Py_RETURN_NONE;
+    }
+
+    return toPython(builderInstance->m_buildConfiguration).release();
 }
 
 int Nedrysoft::Builder::totalFiles() {
@@ -491,7 +1286,7 @@ void Nedrysoft::Builder::clear() {
     setProperty("iconsvisible",true);
     setProperty("gridvisible", false);
     setProperty("detectfeatures", true);
-    setProperty("featuresize", 10000);
+    setProperty("featuresize", Nedrysoft::FeatureDetector::DefaultMinimumArea);
 
     setProperty("background", "");
     setProperty("icon", "");
@@ -516,6 +1311,36 @@ void Nedrysoft::Builder::setProperty(const char *name, const QVariant &value) {
     m_isModified = true;
 
     QObject::setProperty(name, value);
+
+    updateSnapshot();
+}
+
+void Nedrysoft::Builder::updateSnapshot() {
+    Snapshot snapshot;
+
+    snapshot.iconSize = m_configuration.m_iconsize;
+    snapshot.textSize = m_configuration.m_textSize;
+    snapshot.gridSize = m_configuration.m_gridSize;
+    snapshot.snapToGrid = m_configuration.m_snapToGrid;
+    snapshot.snapToFeatures = m_configuration.m_snapToFeatures;
+    snapshot.gridVisible = m_configuration.m_gridVisible;
+    snapshot.iconsVisible = m_configuration.m_iconsVisible;
+    snapshot.detectFeatures = m_configuration.m_detectFeatures;
+    snapshot.featureSize = m_configuration.m_featureSize;
+
+    if (snapshot != m_snapshot) {
+        m_snapshot = snapshot;
+
+        Q_EMIT snapshotChanged(m_snapshot);
+    }
+}
+
+const Nedrysoft::Builder::Snapshot &Nedrysoft::Builder::snapshot() const {
+    return m_snapshot;
+}
+
+Nedrysoft::BuildEventQueue &Nedrysoft::Builder::eventQueue() {
+    return m_eventQueue;
 }
 
 QString Nedrysoft::Builder::filename() {
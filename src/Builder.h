@@ -22,16 +22,31 @@
 #ifndef NEDRYSOFT_BUILDER_H
 #define NEDRYSOFT_BUILDER_H
 
+#include "BuildConfiguration.h"
+#include "BuildEvent.h"
+#include "BuildEventQueue.h"
+#include "BuildHandle.h"
+#include "IImageBackend.h"
+#include "PayloadScanner.h"
+#include "PreflightCheck.h"
 #include "tomlplusplus/toml.hpp"
+#include <QByteArray>
 #include <QList>
 #include <QMetaProperty>
+#include <QSharedPointer>
 #include <QSize>
 #include <QString>
+#include <QStringList>
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <mutex>
 
 #include <Python.h>
 
 namespace Nedrysoft {
+    class Python;
+
     /**
      * @brief       The Builder class is capable of loading and saving configurations, it also provides the function
      *              to create the DMG based on the current configuration.
@@ -80,6 +95,44 @@ namespace Nedrysoft {
                 Right = 1                                       /**< Text is located to the right of the icon. */
             };
 
+            /**
+             * @brief       Holds a typed copy of the configuration values that are used by the user interface.
+             *
+             * @details     The snapshot is refreshed whenever a property is changed and is pushed to consumers by the
+             *              snapshotChanged signal, interactive code such as icon dragging reads these fields directly
+             *              rather than looking the properties up by name.
+             */
+            struct Snapshot {
+                int iconSize = 64;                              //! the size of the icons to be shown
+                int textSize = 12;                              //! size of the icon text in points
+                QSize gridSize;                                 //! the grid spacing
+                bool snapToGrid = false;                        //! whether to snap points to grid
+                bool snapToFeatures = false;                    //! whether to snap to features
+                bool gridVisible = false;                       //! whether the grid is visible
+                bool iconsVisible = true;                       //! whether icons are displayed on the preview
+                bool detectFeatures = true;                     //! whether we auto-detect features
+                int featureSize = 10000;                        //! minimum size in px^2 for feature detection
+
+                bool operator==(const Snapshot& other) const {
+                    return (iconSize == other.iconSize && textSize == other.textSize && gridSize == other.gridSize &&
+                            snapToGrid == other.snapToGrid && snapToFeatures == other.snapToFeatures &&
+                            gridVisible == other.gridVisible && iconsVisible == other.iconsVisible &&
+                            detectFeatures == other.detectFeatures && featureSize == other.featureSize);
+                }
+
+                bool operator!=(const Snapshot& other) const {
+                    return !(*this == other);
+                }
+            };
+
+            /**
+             * @brief       Holds everything that determines the content of the DMG that a build produces.
+             */
+            struct Manifest {
+                QByteArray configuration;                       //! a canonical description of the settings passed to dmgbuild
+                QStringList inputs;                             //! the absolute paths of the files that are copied into the DMG
+            };
+
         private:
             /**
              * @brief       Holds the configuration, this information is interchanged between this structure and a TOML format
@@ -112,14 +165,78 @@ namespace Nedrysoft {
              */
             explicit Builder();
 
+            /**
+             * @brief       Destroys the Builder.
+             */
+            ~Builder();
+
             /**
              * @brief       Uses the dmgbuild python module + configuration file to being a DMG.
              *
+             * @details     The build runs in the background, the returned handle is used to cancel the build, to wait
+             *              for it and to retrieve the result along with the traceback of a failed build.
+             *
              * @param[in]   outputFilename the output name of the file to create (or empty to use the value in the configuration).
+             * @param[in]   timeout the time in milliseconds after which the build is cancelled, 0 for no limit.
+             *
+             * @returns     the handle of the build; or a null handle if the build could not be started (including
+             *              when a build is already running or the pre-flight check found an error).
+             */
+            QSharedPointer<BuildHandle> createDMG(QString outputFilename=QString(), int timeout=0);
+
+            /**
+             * @brief       Checks that the configuration can be built without starting a build.
+             *
+             * @note        createDMG runs the same check, a build is not started if the check finds an error.
+             *
+             * @param[in]   outputFilename the output name of the file to create.
+             *
+             * @returns     the result of the check.
+             */
+            PreflightCheck::Result preflight(const QString &outputFilename);
+
+            /**
+             * @brief       Returns the result of the check made by the most recent call to createDMG.
+             *
+             * @returns     the result of the check.
+             */
+            PreflightCheck::Result preflightResult() const;
+
+            /**
+             * @brief       Returns a copy of the configuration with the paths resolved.
+             *
+             * @note        The window size is not set, it is only known once the background has been loaded.
+             *
+             * @param[in]   outputFilename the normalised output name of the file to create.
+             *
+             * @returns     the configuration.
+             */
+            std::shared_ptr<BuildConfiguration> configurationSnapshot(const QString &outputFilename);
+
+            /**
+             * @brief       Returns whether a build is in progress.
              *
-             * @returns     true on success; otherwise false.
+             * @returns     true if building; otherwise false.
              */
-            bool createDMG(QString outputFilename=QString());
+            bool isBuilding() const;
+
+            /**
+             * @brief       Cancels the build in progress.
+             *
+             * @note        The buildFinished signal is emitted once the build has stopped, the result is
+             *              Python::ScriptCancelled unless the build had already finished.
+             */
+            void cancel();
+
+            /**
+             * @brief       Sets whether builds are profiled.
+             *
+             * @details     A profiled build records the time spent in each function of the build script along with
+             *              the python memory it used, the profile is retrieved from the BuildHandle.
+             *
+             * @param[in]   isProfiling true if builds should be profiled; otherwise false.
+             */
+            void setProfiling(bool isProfiling);
 
             /**
              * @brief       Loads a configuration from a file.
@@ -153,6 +270,44 @@ namespace Nedrysoft {
              */
             int totalSymlinks();
 
+            /**
+             * @brief       Returns the files that are copied into the image.
+             *
+             * @details     The list contains the payload files and folders along with the background and volume
+             *              icon, it is used to calculate the size of the image.
+             *
+             * @returns     the normalised filenames.
+             */
+            QStringList imageContents();
+
+            /**
+             * @brief       Returns the size of image that is needed for the configuration.
+             *
+             * @note        The files are scanned by a PayloadScanner, this can be called from any thread with the
+             *              list returned by imageContents.
+             *
+             * @param[in]   contents the files that are copied into the image.
+             * @param[in]   symlinks the number of symlinks that are created in the image.
+             * @param[out]  totals if not null, receives the totals of the scan.
+             *
+             * @returns     the image size in bytes.
+             */
+            static qint64 imageSize(const QStringList &contents, int symlinks, PayloadScanner::Totals *totals = nullptr);
+
+            static constexpr auto ImageBackendVariable = "DMGEE_IMAGE_BACKEND";  //! the environment variable that selects the image backend of a builder
+
+            /**
+             * @brief       Creates an image backend.
+             *
+             * @note        The backend used by a builder is selected with the ImageBackendVariable environment
+             *              variable, so build workers use the same backend as the process that started them.
+             *
+             * @param[in]   name the name of the backend, an empty name selects the default for the platform.
+             *
+             * @returns     the new backend, the caller takes ownership; or nullptr if the name is not known.
+             */
+            static IImageBackend *createImageBackend(const QString &name);
+
             /**
              * @brief       Clears the current builder config to default.
              */
@@ -186,24 +341,144 @@ namespace Nedrysoft {
               */
              void setModified(bool isModified);
 
+             /**
+              * @brief      Returns the typed snapshot of the user interface configuration values.
+              *
+              * @returns    the current snapshot.
+              */
+             const Snapshot &snapshot() const;
+
+             /**
+              * @brief      Returns the queue that progress events from the build are delivered through.
+              *
+              * @returns    the event queue.
+              */
+             BuildEventQueue &eventQueue();
+
+             /**
+              * @brief      Returns the manifest of the build for the current configuration.
+              *
+              * @note       The configuration part only contains values that reach dmgbuild, so editor settings such
+              *             as the grid do not change it.  File contents are not read, the inputs are hashed by the
+              *             caller.
+              *
+              * @returns    the manifest.
+              */
+             Manifest manifest();
+
+            /**
+             * @brief       Reuturns the normalized filename.
+             *
+             * @note        The filename is checked for tildes and if one exists then the filename is modified to
+             *              have the full path to the user.  If the tile is relative, then it is concatenated with
+             *              the path to the configuration file.  If none of the previous statements are true then
+             *              the orignal filename is returned.
+             *
+             * @param[in]   filename the name of the file to normalise.
+             *
+             * @returns     the normalised filename.
+             */
+            QString normalisedFilename(QString filename);
+
         private:
             /**
-             * @brief       Python function which allows transfer of a string to c
+             * @brief       Python function which receives a progress dictionary from dmgbuild.
+             *
+             * @details     The dictionary is decoded directly into a BuildEvent, the keys and the type/operation names
+             *              are looked up using interned python strings so no string conversion is needed for them.
              *
              * @param[in]   self the python object
-             * @param[in]   updateData string containing the data being transferred
+             * @param[in]   updateData the dictionary passed to the dmgbuild callback
              *
              * @returns     PyTrue if handled; other PyFalse
              */
             static PyObject *update(PyObject *self, PyObject *updateData);
 
+            /**
+             * @brief       Python function which emits a typed build event.
+             *
+             * @details     Called from python as dmgee.event(type, operation=0, path=None, bytes=0, count=0) using the
+             *              EVENT_ and OPERATION_ constants exported by the dmgee module.
+             *
+             * @param[in]   self the python object
+             * @param[in]   args the positional arguments.
+             * @param[in]   kwargs the keyword arguments.
+             *
+             * @returns     None on success; otherwise nullptr with a python exception set.
+             */
+            static PyObject *event(PyObject *self, PyObject *args, PyObject *kwargs);
+
+            /**
+             * @brief       Python function which copies the payload into the mounted image.
+             *
+             * @details     Called from python as dmgee.stage(mount_point) by the dmgbuild create hook, the files
+             *              and folders are copied by a PayloadStager with the GIL released.  The FilesAdd event
+             *              holds the expected payload size, a FileAdd event is emitted for each entry and the bytes
+             *              copied are reported by OperationProgress events.  A PayloadStaged event holds the totals.
+             *
+             * @param[in]   self the python object
+             * @param[in]   args the positional arguments.
+             *
+             * @returns     None on success; otherwise nullptr with an OSError set.
+             */
+            static PyObject *stage(PyObject *self, PyObject *args);
+
+            /**
+             * @brief       Python function which performs an hdiutil command with the image backend.
+             *
+             * @details     Called from python as dmgee.image(command, arguments, plist) in place of dmgbuild's hdiutil
+             *              function, the create, attach, detach, resize and convert commands are mapped onto the
+             *              IImageBackend of the builder.  A DmgConvert event is emitted before the image is converted.
+             *
+             * @param[in]   self the python object
+             * @param[in]   args the positional arguments.
+             *
+             * @returns     a tuple of the exit code and the output; otherwise nullptr with an OSError set.
+             */
+            static PyObject *image(PyObject *self, PyObject *args);
+
+            /**
+             * @brief       Python function which returns the configuration that the build was started with.
+             *
+             * @details     Called from python as dmgee.configuration(), the returned dmgee.Configuration reads its
+             *              attributes, files and symlinks from the C++ copy of the configuration on demand.
+             *
+             * @param[in]   self the python object
+             * @param[in]   args unused.
+             *
+             * @returns     the dmgee.Configuration; or None if no build has been started.
+             */
+            static PyObject *configuration(PyObject *self, PyObject *args);
+
+            /**
+             * @brief       Python function which runs a tool and streams its output into the build log.
+             *
+             * @details     Called from python as dmgee.run(arguments) in place of subprocess.call, each line that the
+             *              tool writes is sent as a ToolOutput event while it runs.  The tool is killed if the build
+             *              is cancelled.
+             *
+             * @param[in]   self the python object
+             * @param[in]   args the positional arguments, a list of the tool followed by its arguments.
+             *
+             * @returns     the exit code of the tool; otherwise nullptr with an OSError set if it could not be started.
+             */
+            static PyObject *run(PyObject *self, PyObject *args);
+
         public:
             /**
-             * @brief       This signal is emitted when the python script progress is updated.
+             * @brief       This signal is emitted when progress events have been added to an empty event queue.
+             *
+             * @note        The signal is emitted from the build thread, it is not emitted again until the queue has
+             *              been drained.
+             */
+            Q_SIGNAL void eventsPending();
+
+            /**
+             * @brief       This signal is emitted when the build script has finished.
              *
-             * @param[in]   progress the json progress update as a QString
+             * @param[in]   result the Python::ErrorCode result of the script.
              */
-            Q_SIGNAL void progressUpdate(QString progress);
+            Q_SIGNAL void buildFinished(int result);
 
         private:
             /**
@@ -235,18 +510,45 @@ namespace Nedrysoft {
             QList<File *> files();
 
             /**
-             * @brief       Reuturns the normalized filename.
+             * @brief       Refreshes the snapshot from the configuration and emits snapshotChanged if it changed.
+             */
+            void updateSnapshot();
+
+            /**
+             * @brief       Starts reporting the progress of an operation that processes a known number of bytes.
              *
-             * @note        The filename is checked for tildes and if one exists then the filename is modified to
-             *              have the full path to the user.  If the tile is relative, then it is concatenated with
-             *              the path to the configuration file.  If none of the previous statements are true then
-             *              the orignal filename is returned.
+             * @details     An OperationStart event is pushed with the expected number of bytes and the bytes
+             *              reported by the image backend are then sent as OperationProgress events for the operation.
              *
-             * @param[in]   filename the name of the file to normalise.
+             * @note        Must be called from the build thread while no backend operation is in progress.
              *
-             * @returns     the normalised filename.
+             * @param[in]   operation the operation.
+             * @param[in]   bytes the number of bytes that the operation is expected to process.
              */
-            QString normalisedFilename(QString filename);
+            void startProgress(BuildEvent::Operation operation, qint64 bytes);
+
+            /**
+             * @brief       Adds bytes processed by the image backend to the current operation.
+             *
+             * @details     Progress events are limited to one per progressEventInterval, a thread that finds another
+             *              thread pushing an event does not wait as the next call will include its bytes.
+             *
+             * @note        Called from the threads of the image backend.
+             *
+             * @param[in]   bytes the number of bytes processed since the previous call.
+             */
+            void addProgress(qint64 bytes);
+
+            /**
+             * @brief       Sends a line written by a tool as a ToolOutput event.
+             *
+             * @note        Called from the build thread while a tool is running.
+             *
+             * @param[in]   program the path of the tool.
+             * @param[in]   channel the stream that the line was written to.
+             * @param[in]   line the line.
+             */
+            void addToolOutput(const QString &program, BuildEvent::Channel channel, const QString &line);
 
         public:
             void setProperty(const char *name, const QVariant &value);
@@ -263,6 +565,13 @@ namespace Nedrysoft {
             Q_SIGNAL void symlinksChanged(QList<Nedrysoft::Builder::Symlink *> symlinks);
             Q_SIGNAL void formatChanged(QString format);
 
+            /**
+             * @brief       This signal is emitted when a value in the snapshot is changed.
+             *
+             * @param[in]   snapshot the updated snapshot.
+             */
+            Q_SIGNAL void snapshotChanged(const Nedrysoft::Builder::Snapshot &snapshot);
+
         public:
             Q_PROPERTY(QString background MEMBER (m_configuration.m_background));
             Q_PROPERTY(QString icon MEMBER (m_configuration.m_icon));
@@ -287,6 +596,19 @@ namespace Nedrysoft {
             QString m_filename;                                 //! the filename of the configuration that was loaded.
             QString m_outputFilename;                           //! the filename of the output file.
             bool m_isModified;                                  //! whether the configuration has changed.
+            Snapshot m_snapshot;                                //! typed copy of the user interface values
+            Python *m_python;                                   //! the python instance used to run builds
+            IImageBackend *m_imageBackend;                      //! performs the disk image operations of a build
+            QSharedPointer<BuildHandle> m_build;                //! the handle of the most recent build
+            BuildEventQueue m_eventQueue;                       //! progress events from the build thread
+            QStringList m_payload;                              //! the files and folders staged by the current build
+            std::shared_ptr<const BuildConfiguration> m_buildConfiguration;   //! the configuration of the current build
+            PreflightCheck::Result m_preflightResult;           //! the result of the check made by the most recent build
+            std::mutex m_progressMutex;                         //! serialises events from the backend threads
+            std::atomic<qint64> m_progressBytes;                //! bytes processed by the current operation
+            qint64 m_progressTimestamp;                         //! the time of the last progress event (m_progressMutex)
+            BuildEvent::Operation m_progressOperation;          //! the operation that progress is reported for
+            std::atomic<bool> m_isBuildCancelled;               //! set when the current build has been cancelled, read by the build thread
 
             static PyMethodDef m_moduleMethods[];               //! module method table for the dmgee module
     };
@@ -295,5 +617,6 @@ namespace Nedrysoft {
 Q_DECLARE_METATYPE(Nedrysoft::Builder::File *);
 Q_DECLARE_METATYPE(Nedrysoft::Builder::Symlink *);
 Q_DECLARE_METATYPE(Nedrysoft::Builder::TextPosition);
+Q_DECLARE_METATYPE(Nedrysoft::Builder::Snapshot);
 
 #endif //NEDRYSOFT_BUILDER_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DirectoryImageBackend.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+constexpr auto volumeFolderSuffix = ".volume";
+
+Nedrysoft::DirectoryImageBackend::DirectoryImageBackend() = default;
+
+QString Nedrysoft::DirectoryImageBackend::name() const {
+    return Name;
+}
+
+QString Nedrysoft::DirectoryImageBackend::volumeFolder(const QString &filename) {
+    return filename+volumeFolderSuffix;
+}
+
+static bool removeEntry(const QString &filename) {
+    QFileInfo fileInfo(filename);
+
+    if ((fileInfo.isDir()) && (!fileInfo.isSymLink())) {
+        return QDir(filename).removeRecursively();
+    }
+
+    return (!fileInfo.exists()) && (!fileInfo.isSymLink()) ? true : QFile::remove(filename);
+}
+
+bool Nedrysoft::DirectoryImageBackend::create(const QString &filename, const QString &volumeName, qint64 size, QString &error) {
+    Q_UNUSED(volumeName);
+
+    auto folder = volumeFolder(filename);
+
+    if ((!removeEntry(folder)) || (!QDir().mkpath(folder))) {
+        error = QString("unable to create the volume folder %1").arg(folder);
+
+        return false;
+    }
+
+    QMutexLocker capacityLocker(&m_capacityMutex);
+
+    m_capacities[folder] = size;
+
+    return true;
+}
+
+bool Nedrysoft::DirectoryImageBackend::attach(const QString &filename, QString &device, QString &mountPoint, QString &error) {
+    auto folder = volumeFolder(filename);
+
+    if (!QFileInfo(folder).isDir()) {
+        error = QString("%1 has not been created").arg(filename);
+
+        return false;
+    }
+
+    device = folder;
+    mountPoint = folder;
+
+    return true;
+}
+
+bool Nedrysoft::DirectoryImageBackend::populate(const QString &mountPoint, const QString &source, PayloadStager::Statistics &statistics, QString &error) {
+    if (!m_stager.stage(source, mountPoint, statistics, &error)) {
+        return false;
+    }
+
+    QMutexLocker capacityLocker(&m_capacityMutex);
+
+    // a real volume would have run out of space, so the build fails in the same way
+
+    if ((m_capacities.contains(mountPoint)) && (statistics.bytes>m_capacities[mountPoint])) {
+        error = QString("the payload (%1 bytes) does not fit in the image (%2 bytes)").arg(statistics.bytes).arg(m_capacities[mountPoint]);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Nedrysoft::DirectoryImageBackend::detach(const QString &device, bool force, QString &error) {
+    Q_UNUSED(force);
+
+    if (!QFileInfo(device).isDir()) {
+        error = QString("%1 is not attached").arg(device);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Nedrysoft::DirectoryImageBackend::shrink(const QString &filename, QString &error) {
+    auto folder = volumeFolder(filename);
+
+    if (!QFileInfo(folder).isDir()) {
+        error = QString("%1 has not been created").arg(filename);
+
+        return false;
+    }
+
+    // a folder only takes the space of its contents, so there is nothing to shrink
+
+    return true;
+}
+
+bool Nedrysoft::DirectoryImageBackend::convert(const QString &filename, const QString &format, const QString &outputFilename, int compressionLevel, QString &error) {
+    Q_UNUSED(format);
+    Q_UNUSED(compressionLevel);
+
+    auto folder = volumeFolder(filename);
+
+    if (!removeEntry(outputFilename)) {
+        error = QString("unable to replace %1").arg(outputFilename);
+
+        return false;
+    }
+
+    // the temporary image is created next to the output, so the volume can usually be moved rather than copied
+
+    if (!QDir().rename(folder, outputFilename)) {
+        PayloadStager::Statistics statistics;
+
+        if (!QDir().mkpath(outputFilename)) {
+            error = QString("unable to create %1").arg(outputFilename);
+
+            return false;
+        }
+
+        for (auto const &entry : QDir(folder).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot)) {
+            if (!m_stager.stage(entry.absoluteFilePath(), outputFilename, statistics, &error)) {
+                return false;
+            }
+        }
+
+        QDir(folder).removeRecursively();
+    }
+
+    QMutexLocker capacityLocker(&m_capacityMutex);
+
+    m_capacities.remove(folder);
+
+    return true;
+}
+
+void Nedrysoft::DirectoryImageBackend::setCancelled(bool cancelled) {
+    m_stager.setCancelled(cancelled);
+}
+
+void Nedrysoft::DirectoryImageBackend::setProgressFunction(PayloadStager::ProgressFunction progressFunction) {
+    m_stager.setProgressFunction(progressFunction);
+}
+
+void Nedrysoft::DirectoryImageBackend::setOutputFunction(OutputFunction outputFunction) {
+    // the backend does not run any tools
+
+    Q_UNUSED(outputFunction);
+}
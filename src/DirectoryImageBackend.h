@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_DIRECTORYIMAGEBACKEND_H
+#define NEDRYSOFT_DIRECTORYIMAGEBACKEND_H
+
+#include "IImageBackend.h"
+
+#include <QMap>
+#include <QMutex>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The DirectoryImageBackend class builds a folder in place of a disk image.
+     *
+     * @details     The volume of a writable image is a folder alongside the image file, attaching the image returns
+     *              the folder as the mount point and converting the image moves the folder to the output filename.
+     *              The backend does not need any macOS tools, so the build pipeline can be run, benchmarked and
+     *              tested on other platforms.  The size given when the image is created is enforced so that the
+     *              image size calculation is tested as well.
+     */
+    class DirectoryImageBackend :
+            public IImageBackend {
+
+        public:
+            static constexpr auto Name = "directory";           //! the name used to select the backend
+
+        public:
+            /**
+             * @brief       Constructs a new DirectoryImageBackend instance.
+             */
+            DirectoryImageBackend();
+
+            /**
+             * @sa          IImageBackend
+             */
+            QString name() const override;
+            bool create(const QString &filename, const QString &volumeName, qint64 size, QString &error) override;
+            bool attach(const QString &filename, QString &device, QString &mountPoint, QString &error) override;
+            bool populate(const QString &mountPoint, const QString &source, PayloadStager::Statistics &statistics, QString &error) override;
+            bool detach(const QString &device, bool force, QString &error) override;
+            bool shrink(const QString &filename, QString &error) override;
+            bool convert(const QString &filename, const QString &format, const QString &outputFilename, int compressionLevel, QString &error) override;
+            void setCancelled(bool cancelled) override;
+            void setProgressFunction(PayloadStager::ProgressFunction progressFunction) override;
+            void setOutputFunction(OutputFunction outputFunction) override;
+
+        private:
+            /**
+             * @brief       Returns the folder that holds the volume of an image.
+             *
+             * @param[in]   filename the filename of the image.
+             *
+             * @returns     the folder.
+             */
+            static QString volumeFolder(const QString &filename);
+
+        private:
+            PayloadStager m_stager;                             //! copies the payload into the volume
+            QMutex m_capacityMutex;                             //! protects m_capacities
+            QMap<QString, qint64> m_capacities;                 //! the size of each volume folder
+    };
+}
+
+#endif //NEDRYSOFT_DIRECTORYIMAGEBACKEND_H
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FeatureCache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+constexpr quint32 featureCacheMagic = 0x444d4643;                   //! "DMFC"
+constexpr quint32 featureCacheVersion = 2;
+constexpr auto featureCacheFolder = "features";
+constexpr auto featureCacheIndexFolder = "index";
+constexpr auto featureCacheExtension = ".features";
+
+Nedrysoft::FeatureCache::FeatureCache() :
+        m_cacheFolder(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(featureCacheFolder)) {
+
+}
+
+QString Nedrysoft::FeatureCache::key(const QString &filename, const QString &parameters) {
+    QFile imageFile(filename);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    if (!imageFile.open(QFile::ReadOnly)) {
+        return QString();
+    }
+
+    if (!hash.addData(&imageFile)) {
+        return QString();
+    }
+
+    hash.addData(parameters.toUtf8());
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString Nedrysoft::FeatureCache::entryFilename(const QString &key) const {
+    return QDir(m_cacheFolder).filePath(key+featureCacheExtension);
+}
+
+QString Nedrysoft::FeatureCache::indexFilename(const QString &filename) const {
+    auto filenameHash = QCryptographicHash::hash(filename.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+    return QDir(m_cacheFolder).filePath(QString("%1/%2").arg(featureCacheIndexFolder).arg(QString::fromLatin1(filenameHash)));
+}
+
+bool Nedrysoft::FeatureCache::load(const QString &key, FeatureDetector::Result &result) const {
+    QFile entryFile(entryFilename(key));
+    quint32 magic, version;
+    quint32 featureCount;
+
+    if (!entryFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream entryStream(&entryFile);
+
+    entryStream >> magic >> version;
+
+    if ((magic!=featureCacheMagic) || (version!=featureCacheVersion)) {
+        return false;
+    }
+
+    result = FeatureDetector::Result();
+
+    entryStream >> result.tiles.imageSize >> result.tiles.tileSize >> result.tiles.hashes;
+    entryStream >> featureCount;
+
+    for (quint32 featureIndex = 0; (featureIndex<featureCount) && (entryStream.status()==QDataStream::Ok); featureIndex++) {
+        FeatureDetector::Feature feature;
+
+        entryStream >> feature.centroid >> feature.area >> feature.bounds >> feature.outline;
+
+        result.features.append(feature);
+    }
+
+    return entryStream.status()==QDataStream::Ok;
+}
+
+bool Nedrysoft::FeatureCache::store(const QString &key, const FeatureDetector::Result &result) const {
+    if (!QDir().mkpath(m_cacheFolder)) {
+        return false;
+    }
+
+    // write to a temporary file and rename so that a partially written entry is never seen
+
+    QSaveFile entryFile(entryFilename(key));
+
+    if (!entryFile.open(QFile::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream entryStream(&entryFile);
+
+    entryStream << featureCacheMagic << featureCacheVersion;
+    entryStream << result.tiles.imageSize << result.tiles.tileSize << result.tiles.hashes;
+    entryStream << static_cast<quint32>(result.features.count());
+
+    for (auto const &feature : result.features) {
+        entryStream << feature.centroid << feature.area << feature.bounds << feature.outline;
+    }
+
+    return entryFile.commit();
+}
+
+QString Nedrysoft::FeatureCache::previousKey(const QString &filename) const {
+    QFile indexFile(indexFilename(filename));
+
+    if (!indexFile.open(QFile::ReadOnly)) {
+        return QString();
+    }
+
+    auto key = QString::fromLatin1(indexFile.readAll()).trimmed();
+
+    return key.isEmpty() ? QString() : key;
+}
+
+void Nedrysoft::FeatureCache::setPreviousKey(const QString &filename, const QString &key) const {
+    auto indexFileInfo = QFileInfo(indexFilename(filename));
+
+    if (!QDir().mkpath(indexFileInfo.absolutePath())) {
+        return;
+    }
+
+    QSaveFile indexFile(indexFileInfo.absoluteFilePath());
+
+    if (indexFile.open(QFile::WriteOnly)) {
+        indexFile.write(key.toLatin1());
+        indexFile.commit();
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_FEATURECACHE_H
+#define NEDRYSOFT_FEATURECACHE_H
+
+#include "FeatureDetector.h"
+
+#include <QString>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The FeatureCache class stores the results of background feature detection on disk.
+     *
+     * @details     Entries are keyed by a hash of the background image content combined with the parameters
+     *              used by the detector, so a background that has not changed does not need to be analysed again
+     *              when a configuration is re-opened.  Every detected feature is stored along with its area so that
+     *              the minimum feature size can be changed without invalidating the cache.
+     *
+     *              The cache also records the most recent entry for each image file, when the file changes the
+     *              previous entry provides the tile hashes and features that are needed for incremental detection.
+     */
+    class FeatureCache {
+        public:
+            /**
+             * @brief       Constructs a new FeatureCache instance which uses the users cache folder.
+             */
+            explicit FeatureCache();
+
+            /**
+             * @brief       Returns the cache key for the given image file and detector parameters.
+             *
+             * @param[in]   filename the image file to generate the key for.
+             * @param[in]   parameters a string describing the detector parameters.
+             *
+             * @returns     the key as a hex string; or a null string if the file could not be read.
+             */
+            static QString key(const QString &filename, const QString &parameters);
+
+            /**
+             * @brief       Loads the detector result stored under the given key.
+             *
+             * @param[in]   key the cache key.
+             * @param[out]  result the detector result that was loaded.
+             *
+             * @returns     true if the entry exists and was loaded; otherwise false.
+             */
+            bool load(const QString &key, FeatureDetector::Result &result) const;
+
+            /**
+             * @brief       Stores the detector result under the given key.
+             *
+             * @param[in]   key the cache key.
+             * @param[in]   result the detector result to be stored.
+             *
+             * @returns     true if the entry was written; otherwise false.
+             */
+            bool store(const QString &key, const FeatureDetector::Result &result) const;
+
+            /**
+             * @brief       Returns the key of the most recent entry that was stored for an image file.
+             *
+             * @param[in]   filename the image file.
+             *
+             * @returns     the key if known; otherwise a null string.
+             */
+            QString previousKey(const QString &filename) const;
+
+            /**
+             * @brief       Records the key of the most recent entry for an image file.
+             *
+             * @param[in]   filename the image file.
+             * @param[in]   key the cache key.
+             */
+            void setPreviousKey(const QString &filename, const QString &key) const;
+
+        private:
+            /**
+             * @brief       Returns the filename of the cache entry for the key.
+             *
+             * @param[in]   key the cache key.
+             *
+             * @returns     the full path to the cache entry.
+             */
+            QString entryFilename(const QString &key) const;
+
+            /**
+             * @brief       Returns the filename of the index file that holds the most recent key for an image file.
+             *
+             * @param[in]   filename the image file.
+             *
+             * @returns     the full path to the index file.
+             */
+            QString indexFilename(const QString &filename) const;
+
+        private:
+            QString m_cacheFolder;                              //! the folder that cache entries are stored in
+    };
+}
+
+#endif //NEDRYSOFT_FEATURECACHE_H
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FeatureDetector.h"
+
+#include <QLineF>
+#include <cstring>
+
+constexpr quint64 tileHashOffset = 0xcbf29ce484222325ULL;
+constexpr quint64 tileHashPrime = 0x100000001b3ULL;
+constexpr auto maximumDirtyTileRatio = 0.5;             //! above this ratio of changed tiles the whole image is processed
+
+static quint64 hashBytes(quint64 hash, const uchar *data, size_t length) {
+    while (length >= sizeof(quint64)) {
+        quint64 word;
+
+        memcpy(&word, data, sizeof(word));
+
+        hash = (hash ^ word) * tileHashPrime;
+        hash ^= hash >> 32;
+
+        data += sizeof(quint64);
+        length -= sizeof(quint64);
+    }
+
+    while (length--) {
+        hash = (hash ^ *data++) * tileHashPrime;
+    }
+
+    return hash;
+}
+
+static QRect alignedToTiles(const QRect &rect, int tileSize) {
+    auto left = (rect.left() / tileSize) * tileSize;
+    auto top = (rect.top() / tileSize) * tileSize;
+    auto right = ((rect.right() / tileSize) + 1) * tileSize;
+    auto bottom = ((rect.bottom() / tileSize) + 1) * tileSize;
+
+    return QRect(left, top, right-left, bottom-top);
+}
+
+Nedrysoft::FeatureDetector::Tiles Nedrysoft::FeatureDetector::tiles(const cv::Mat &image, int tileSize) {
+    Tiles tiles;
+    auto columns = (image.cols + tileSize - 1) / tileSize;
+    auto rows = (image.rows + tileSize - 1) / tileSize;
+    auto bytesPerPixel = image.elemSize();
+
+    tiles.imageSize = QSize(image.cols, image.rows);
+    tiles.tileSize = tileSize;
+    tiles.hashes.fill(tileHashOffset, columns * rows);
+
+    // walk the image a row at a time so that memory is accessed sequentially
+
+    for (auto y = 0; y < image.rows; y++) {
+        auto row = image.ptr<uchar>(y);
+        auto tileRow = (y / tileSize) * columns;
+
+        for (auto column = 0; column < columns; column++) {
+            auto x = column * tileSize;
+            auto width = std::min(tileSize, image.cols - x);
+
+            tiles.hashes[tileRow + column] = hashBytes(tiles.hashes[tileRow + column], row + (x * bytesPerPixel), width * bytesPerPixel);
+        }
+    }
+
+    return tiles;
+}
+
+static void addElapsed(QElapsedTimer &timer, qint64 *stage) {
+    if (stage) {
+        *stage += timer.nsecsElapsed();
+    }
+
+    timer.restart();
+}
+
+Nedrysoft::FeatureDetector::Result Nedrysoft::FeatureDetector::detect(const cv::Mat &image, int tileSize, Timings *timings) {
+    QElapsedTimer timer;
+    Result result;
+
+    timer.start();
+
+    result.tiles = tiles(image, tileSize);
+
+    addElapsed(timer, timings ? &timings->tiles : nullptr);
+
+    result.features = detectRegion(image, QRect(0, 0, image.cols, image.rows), timings);
+
+    return result;
+}
+
+Nedrysoft::FeatureDetector::Result Nedrysoft::FeatureDetector::update(const cv::Mat &image, const Result &previous, QList<QRect> *regions, Timings *timings) {
+    auto imageRect = QRect(0, 0, image.cols, image.rows);
+    auto tileSize = previous.tiles.tileSize > 0 ? previous.tiles.tileSize : DefaultTileSize;
+    auto columns = (image.cols + tileSize - 1) / tileSize;
+    QList<QRect> dirtyRegions;
+    QElapsedTimer timer;
+    Result result;
+
+    timer.start();
+
+    result.tiles = tiles(image, tileSize);
+
+    addElapsed(timer, timings ? &timings->tiles : nullptr);
+
+    if ((previous.tiles.imageSize != result.tiles.imageSize) || (previous.tiles.hashes.size() != result.tiles.hashes.size())) {
+        result.features = detectRegion(image, imageRect, timings);
+
+        if (regions) {
+            *regions = QList<QRect>() << imageRect;
+        }
+
+        return result;
+    }
+
+    // each changed tile becomes a region that includes a border of one tile, the border means that the edges of
+    // every region are made up of unchanged pixels.
+
+    for (auto tileIndex = 0; tileIndex < result.tiles.hashes.size(); tileIndex++) {
+        if (result.tiles.hashes[tileIndex] != previous.tiles.hashes[tileIndex]) {
+            auto tileRect = QRect((tileIndex % columns) * tileSize, (tileIndex / columns) * tileSize, tileSize, tileSize);
+
+            dirtyRegions.append(tileRect.adjusted(-tileSize, -tileSize, tileSize, tileSize) & imageRect);
+        }
+    }
+
+    if (dirtyRegions.isEmpty()) {
+        result.features = previous.features;
+
+        if (regions) {
+            regions->clear();
+        }
+
+        return result;
+    }
+
+    if (dirtyRegions.count() > static_cast<int>(result.tiles.hashes.size() * maximumDirtyTileRatio)) {
+        result.features = detectRegion(image, imageRect, timings);
+
+        if (regions) {
+            *regions = QList<QRect>() << imageRect;
+        }
+
+        return result;
+    }
+
+    // merge overlapping regions and grow them to include any previous feature that passes through them, the
+    // previous features that are absorbed are re-detected, a feature that encloses a region without passing
+    // through it is unaffected by the change and is kept.
+
+    QVector<bool> absorbed(previous.features.count(), false);
+    bool regionsChanged;
+
+    do {
+        regionsChanged = false;
+
+        for (auto first = 0; first < dirtyRegions.count(); first++) {
+            auto second = first + 1;
+
+            while (second < dirtyRegions.count()) {
+                if (dirtyRegions[first].intersects(dirtyRegions[second])) {
+                    dirtyRegions[first] |= dirtyRegions[second];
+                    dirtyRegions.removeAt(second);
+
+                    second = first + 1;
+                    regionsChanged = true;
+                } else {
+                    second++;
+                }
+            }
+        }
+
+        for (auto &region : dirtyRegions) {
+            for (auto featureIndex = 0; featureIndex < previous.features.count(); featureIndex++) {
+                if (absorbed[featureIndex]) {
+                    continue;
+                }
+
+                auto const &feature = previous.features[featureIndex];
+
+                if (outlineCrosses(feature, region)) {
+                    auto grownRegion = region | alignedToTiles(feature.bounds, tileSize).adjusted(-tileSize, -tileSize, tileSize, tileSize);
+
+                    grownRegion &= imageRect;
+
+                    absorbed[featureIndex] = true;
+
+                    if (grownRegion != region) {
+                        region = grownRegion;
+                        regionsChanged = true;
+                    }
+                }
+            }
+        }
+    } while (regionsChanged);
+
+    addElapsed(timer, timings ? &timings->regions : nullptr);
+
+    for (auto featureIndex = 0; featureIndex < previous.features.count(); featureIndex++) {
+        if (!absorbed[featureIndex]) {
+            result.features.append(previous.features[featureIndex]);
+        }
+    }
+
+    for (auto const &region : dirtyRegions) {
+        result.features.append(detectRegion(image, region, timings));
+    }
+
+    if (regions) {
+        *regions = dirtyRegions;
+    }
+
+    return result;
+}
+
+QList<Nedrysoft::FeatureDetector::Feature> Nedrysoft::FeatureDetector::detectRegion(const cv::Mat &image, const QRect &region, Timings *timings) {
+    std::vector<std::vector<cv::Point> > contours;
+    std::vector<cv::Vec4i> hierarchy;
+    QList<Feature> features;
+    QElapsedTimer timer;
+    cv::Mat regionImage;
+
+    timer.start();
+
+    // convert the image to grey scale for contour detection
+
+    cv::cvtColor(image(cv::Rect(region.x(), region.y(), region.width(), region.height())), regionImage, cv::COLOR_BGR2GRAY);
+
+    addElapsed(timer, timings ? &timings->grayscale : nullptr);
+
+    // apply thresholding, this reduces the image to 2 levels which means that the second stage gives the same
+    // result for a region as it does for the whole image.
+
+    cv::threshold(regionImage, regionImage, 1, 32, cv::THRESH_TRUNC);
+
+    // apply second stage thresholding (to black and white)
+
+    cv::threshold(regionImage, regionImage, 230, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+    addElapsed(timer, timings ? &timings->threshold : nullptr);
+
+    // find contours in image, the offset puts the contours into image coordinates
+
+    cv::findContours(regionImage, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE, cv::Point(region.x(), region.y()));
+
+    addElapsed(timer, timings ? &timings->contours : nullptr);
+
+    auto imageRect = QRect(0, 0, image.cols, image.rows);
+
+    // find centre of discovered objects in image
+
+    for (auto &contour : contours) {
+        float sumX = 0, sumY = 0;
+        float size = contour.size();
+        auto contourRect = cv::boundingRect(contour);
+        auto bounds = QRect(contourRect.x, contourRect.y, contourRect.width, contourRect.height);
+        QPointF centroid;
+        QPolygon outline;
+
+        if (((bounds.left() <= region.left()) && (region.left() != imageRect.left())) ||
+            ((bounds.top() <= region.top()) && (region.top() != imageRect.top())) ||
+            ((bounds.right() >= region.right()) && (region.right() != imageRect.right())) ||
+            ((bounds.bottom() >= region.bottom()) && (region.bottom() != imageRect.bottom()))) {
+
+            continue;
+        }
+
+        if (size > 0) {
+            for (auto &point : contour) {
+                sumX += point.x;
+                sumY += point.y;
+
+                outline.append(QPoint(point.x, point.y));
+            }
+
+            centroid = QPointF(sumX / size, sumY / size);
+        }
+
+        features.append(Feature{centroid, cv::contourArea(contour), bounds, outline});
+    }
+
+    addElapsed(timer, timings ? &timings->features : nullptr);
+
+    return features;
+}
+
+bool Nedrysoft::FeatureDetector::outlineCrosses(const Feature &feature, const QRect &rect) {
+    if (!feature.bounds.intersects(rect)) {
+        return false;
+    }
+
+    for (auto const &point : feature.outline) {
+        if (rect.contains(point)) {
+            return true;
+        }
+    }
+
+    // no vertex is inside the rectangle, but an edge of the outline may still pass through it
+
+    auto rectF = QRectF(rect);
+    QLineF rectEdges[] = {
+        QLineF(rectF.topLeft(), rectF.topRight()),
+        QLineF(rectF.topRight(), rectF.bottomRight()),
+        QLineF(rectF.bottomRight(), rectF.bottomLeft()),
+        QLineF(rectF.bottomLeft(), rectF.topLeft())
+    };
+
+    for (auto pointIndex = 0; pointIndex < feature.outline.count(); pointIndex++) {
+        auto edge = QLineF(feature.outline[pointIndex], feature.outline[(pointIndex + 1) % feature.outline.count()]);
+
+        for (auto const &rectEdge : rectEdges) {
+            if (edge.intersects(rectEdge, nullptr) == QLineF::BoundedIntersection) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_FEATUREDETECTOR_H
+#define NEDRYSOFT_FEATUREDETECTOR_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPointF>
+#include <QPolygon>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <opencv2/opencv.hpp>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The FeatureDetector class locates points of interest in a background image.
+     *
+     * @details     The image is converted to black and white and the contours of the shapes in the image are used
+     *              to find the centre of each shape.  The image is also divided into tiles which are hashed, when an
+     *              image is modified the tile hashes are compared against a previous result and only the regions of
+     *              the image that have changed are processed again.
+     */
+    class FeatureDetector {
+        public:
+            /**
+             * @brief       Holds a single detected feature.
+             */
+            struct Feature {
+                QPointF centroid;                               //! the centre of the feature in image coordinates
+                double area;                                    //! the area of the feature in px^2
+                QRect bounds;                                   //! the bounding rectangle of the contour
+                QPolygon outline;                               //! the vertices of the contour
+            };
+
+            /**
+             * @brief       Holds the content hashes of the tiles that make up an image.
+             */
+            struct Tiles {
+                QSize imageSize;                                //! the size of the image that was hashed
+                int tileSize;                                   //! the width and height of a tile in pixels
+                QVector<quint64> hashes;                        //! the hash of each tile, in row order
+            };
+
+            /**
+             * @brief       Holds the result of running the detector on an image.
+             */
+            struct Result {
+                Tiles tiles;                                    //! the tile hashes of the image that was processed
+                QList<Feature> features;                        //! the features that were detected
+            };
+
+            /**
+             * @brief       Holds the time spent in each stage of the detector, in nanoseconds.
+             *
+             * @note        Times are accumulated, so a single instance can be passed to several calls.
+             */
+            struct Timings {
+                qint64 tiles = 0;                               //! time spent hashing tiles
+                qint64 regions = 0;                             //! time spent finding and merging the changed regions
+                qint64 grayscale = 0;                           //! time spent converting to grey scale
+                qint64 threshold = 0;                           //! time spent thresholding
+                qint64 contours = 0;                            //! time spent finding contours
+                qint64 features = 0;                            //! time spent calculating centroids and outlines
+            };
+
+        public:
+            static constexpr auto DefaultTileSize = 64;         //! the default tile size in pixels
+            static constexpr auto DefaultMinimumArea = 10000;   //! the default feature size, smaller features are not used as centroids
+            static constexpr auto Parameters = "gray;trunc:1:32;binary:230:255:otsu;tree;simple";  //! describes the detector, must change if the detector changes
+
+        public:
+            /**
+             * @brief       Runs the detector on the complete image.
+             *
+             * @param[in]   image the image to process (3 channel).
+             * @param[in]   tileSize the size of the tiles used to hash the image.
+             * @param[out]  timings if not null, the time spent in each stage is added to this.
+             *
+             * @returns     the result containing the detected features and the tile hashes.
+             */
+            static Result detect(const cv::Mat &image, int tileSize = DefaultTileSize, Timings *timings = nullptr);
+
+            /**
+             * @brief       Runs the detector on the parts of the image that differ from a previous result.
+             *
+             * @details     Tiles whose hash has changed are grouped into regions and expanded by a border of one
+             *              tile, any previous feature whose outline crosses a region causes the region to grow to
+             *              include it.  The regions are then processed and the new features are merged with the
+             *              previous features from the unchanged part of the image.
+             *
+             * @param[in]   image the image to process (3 channel).
+             * @param[in]   previous the result from the previous version of the image.
+             * @param[out]  regions if not null, receives the list of regions that were processed.
+             * @param[out]  timings if not null, the time spent in each stage is added to this.
+             *
+             * @returns     the result containing the detected features and the tile hashes.
+             */
+            static Result update(const cv::Mat &image, const Result &previous, QList<QRect> *regions = nullptr, Timings *timings = nullptr);
+
+            /**
+             * @brief       Calculates the tile hashes for an image.
+             *
+             * @param[in]   image the image to hash.
+             * @param[in]   tileSize the width and height of each tile.
+             *
+             * @returns     the tile hashes.
+             */
+            static Tiles tiles(const cv::Mat &image, int tileSize);
+
+        private:
+            /**
+             * @brief       Runs the detector on a region of the image.
+             *
+             * @note        Contours that touch an edge of the region that is not also an edge of the image are
+             *              discarded, these are the result of cropping a shape that continues outside of the region.
+             *
+             * @param[in]   image the image to process.
+             * @param[in]   region the region of the image to process.
+             * @param[out]  timings if not null, the time spent in each stage is added to this.
+             *
+             * @returns     the features found within the region, in image coordinates.
+             */
+            static QList<Feature> detectRegion(const cv::Mat &image, const QRect &region, Timings *timings);
+
+            /**
+             * @brief       Returns whether the outline of a feature passes through a rectangle.
+             *
+             * @param[in]   feature the feature to test.
+             * @param[in]   rect the rectangle to test.
+             *
+             * @returns     true if any part of the outline is inside the rectangle; otherwise false.
+             */
+            static bool outlineCrosses(const Feature &feature, const QRect &rect);
+    };
+}
+
+#endif //NEDRYSOFT_FEATUREDETECTOR_H
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HdiutilImageBackend.h"
+
+#include <QFileInfo>
+#include <QMap>
+#include <QXmlStreamReader>
+#include <cstring>
+
+constexpr auto hdiutilPath = "/usr/bin/hdiutil";
+constexpr auto percentPrefix = "PERCENT:";                        //! starts a progress line written with -puppetstrings
+constexpr auto fileSystemArguments = "-c c=64,a=16,e=16";            //! the HFS+ catalog, attribute and extents sizes used by dmgbuild
+
+static const QMap<QString, QString> compressionKeys = {
+    {"UDZO", "zlib"},
+    {"UDBZ", "bzip2"},
+    {"ULFO", "lzfse"}
+};
+
+Nedrysoft::HdiutilImageBackend::HdiutilImageBackend() :
+        m_cancelled(false) {
+
+}
+
+QString Nedrysoft::HdiutilImageBackend::name() const {
+    return Name;
+}
+
+bool Nedrysoft::HdiutilImageBackend::run(const QStringList &arguments, QByteArray &output, QString &error, bool isCancellable, ToolProcess::LineFunction lineFunction) {
+    if ((isCancellable) && (m_cancelled)) {
+        error = QString("hdiutil %1 was cancelled").arg(arguments.first());
+
+        return false;
+    }
+
+    if (!lineFunction) {
+        lineFunction = [this](BuildEvent::Channel channel, const QString &line) {
+            writeOutput(channel, line);
+        };
+    }
+
+    auto tool = ToolProcess(lineFunction, [this, isCancellable]() {
+        return isCancellable && m_cancelled;
+    });
+
+    auto result = tool.run(hdiutilPath, arguments);
+
+    if (!result.isStarted) {
+        error = result.errorString;
+
+        return false;
+    }
+
+    if (result.isCancelled) {
+        error = QString("hdiutil %1 was cancelled").arg(arguments.first());
+
+        return false;
+    }
+
+    output = result.standardOutput;
+
+    if (!result.isSuccess()) {
+        error = QString::fromUtf8(result.standardError).trimmed();
+
+        if (error.isEmpty()) {
+            error = QString("hdiutil %1 failed (%2)").arg(arguments.first()).arg(result.exitCode);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void Nedrysoft::HdiutilImageBackend::writeOutput(BuildEvent::Channel channel, const QString &line) const {
+    if ((m_outputFunction) && (!line.trimmed().isEmpty())) {
+        m_outputFunction(hdiutilPath, channel, line);
+    }
+}
+
+bool Nedrysoft::HdiutilImageBackend::create(const QString &filename, const QString &volumeName, qint64 size, QString &error) {
+    QByteArray output;
+
+    return run(QStringList() << "create" << "-ov" << "-volname" << volumeName << "-fs" << "HFS+" << "-fsargs" << fileSystemArguments << "-size" << QString("%1k").arg(size/1024) << filename, output, error);
+}
+
+bool Nedrysoft::HdiutilImageBackend::attach(const QString &filename, QString &device, QString &mountPoint, QString &error) {
+    QByteArray output;
+
+    // standard output is the plist that describes the attached image, so only standard error is passed on
+
+    auto lineFunction = [this](BuildEvent::Channel channel, const QString &line) {
+        if (channel==BuildEvent::StandardError) {
+            writeOutput(channel, line);
+        }
+    };
+
+    if (!run(QStringList() << "attach" << "-nobrowse" << "-owners" << "off" << "-plist" << filename, output, error, true, lineFunction)) {
+        return false;
+    }
+
+    // the plist holds a dictionary for each entity of the image, the one with a mount point is the volume
+
+    QXmlStreamReader plistReader(output);
+    QString key, entityDevice, entityMountPoint;
+
+    while (!plistReader.atEnd()) {
+        plistReader.readNext();
+
+        if (plistReader.isStartElement()) {
+            if (plistReader.name()==QLatin1String("dict")) {
+                entityDevice.clear();
+                entityMountPoint.clear();
+            } else if (plistReader.name()==QLatin1String("key")) {
+                key = plistReader.readElementText();
+            } else if (plistReader.name()==QLatin1String("string")) {
+                auto value = plistReader.readElementText();
+
+                if (key==QLatin1String("dev-entry")) {
+                    entityDevice = value;
+                } else if (key==QLatin1String("mount-point")) {
+                    entityMountPoint = value;
+                }
+            }
+        } else if ((plistReader.isEndElement()) && (plistReader.name()==QLatin1String("dict"))) {
+            if (!entityMountPoint.isEmpty()) {
+                device = entityDevice;
+                mountPoint = entityMountPoint;
+            }
+        }
+    }
+
+    if (mountPoint.isEmpty()) {
+        error = QString("hdiutil attach did not mount a volume");
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Nedrysoft::HdiutilImageBackend::populate(const QString &mountPoint, const QString &source, PayloadStager::Statistics &statistics, QString &error) {
+    return m_stager.stage(source, mountPoint, statistics, &error);
+}
+
+bool Nedrysoft::HdiutilImageBackend::detach(const QString &device, bool force, QString &error) {
+    QByteArray output;
+    QStringList arguments;
+
+    arguments << "detach";
+
+    if (force) {
+        arguments << "-force";
+    }
+
+    return run(arguments << device, output, error, false);
+}
+
+bool Nedrysoft::HdiutilImageBackend::shrink(const QString &filename, QString &error) {
+    QByteArray output;
+
+    return run(QStringList() << "resize" << "-quiet" << "-sectors" << "min" << filename, output, error);
+}
+
+bool Nedrysoft::HdiutilImageBackend::convert(const QString &filename, const QString &format, const QString &outputFilename, int compressionLevel, QString &error) {
+    QByteArray output;
+    QStringList arguments;
+
+    auto inputSize = QFileInfo(filename).size();
+    qint64 convertedBytes = 0;
+
+    arguments << "convert" << filename << "-format" << format << "-ov" << "-o" << outputFilename << "-puppetstrings";
+
+    if ((compressionLevel>0) && (compressionKeys.contains(format))) {
+        arguments << "-imagekey" << QString("%1-level=%2").arg(compressionKeys[format]).arg(compressionLevel);
+    }
+
+    // the percentage is converted to bytes of the input image, a negative percentage means that hdiutil cannot
+    // tell how long the current step will take.
+
+    auto lineFunction = [this, inputSize, &convertedBytes](BuildEvent::Channel channel, const QString &line) {
+        if ((channel!=BuildEvent::StandardOutput) || (!line.startsWith(percentPrefix))) {
+            writeOutput(channel, line);
+
+            return;
+        }
+
+        auto percent = line.mid(static_cast<int>(strlen(percentPrefix))).toDouble();
+        auto bytes = static_cast<qint64>(static_cast<double>(inputSize)*qMin(percent, 100.0)/100.0);
+
+        if ((m_progressFunction) && (bytes>convertedBytes)) {
+            m_progressFunction(bytes-convertedBytes);
+
+            convertedBytes = bytes;
+        }
+    };
+
+    return run(arguments, output, error, true, lineFunction);
+}
+
+void Nedrysoft::HdiutilImageBackend::setCancelled(bool cancelled) {
+    m_cancelled = cancelled;
+
+    m_stager.setCancelled(cancelled);
+}
+
+void Nedrysoft::HdiutilImageBackend::setProgressFunction(PayloadStager::ProgressFunction progressFunction) {
+    m_progressFunction = progressFunction;
+
+    m_stager.setProgressFunction(progressFunction);
+}
+
+void Nedrysoft::HdiutilImageBackend::setOutputFunction(OutputFunction outputFunction) {
+    m_outputFunction = outputFunction;
+}
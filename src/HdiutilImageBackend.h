@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_HDIUTILIMAGEBACKEND_H
+#define NEDRYSOFT_HDIUTILIMAGEBACKEND_H
+
+#include "IImageBackend.h"
+#include "ToolProcess.h"
+
+#include <QStringList>
+#include <atomic>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The HdiutilImageBackend class builds disk images with the macOS hdiutil tool.
+     *
+     * @details     Each operation runs hdiutil with the arguments that dmgbuild uses, the payload is copied into
+     *              the mounted volume by a PayloadStager.  The output of hdiutil is streamed while it runs and the
+     *              image is converted with -puppetstrings so that the progress of the compression is reported.
+     */
+    class HdiutilImageBackend :
+            public IImageBackend {
+
+        public:
+            static constexpr auto Name = "hdiutil";             //! the name used to select the backend
+
+        public:
+            /**
+             * @brief       Constructs a new HdiutilImageBackend instance.
+             */
+            HdiutilImageBackend();
+
+            /**
+             * @sa          IImageBackend
+             */
+            QString name() const override;
+            bool create(const QString &filename, const QString &volumeName, qint64 size, QString &error) override;
+            bool attach(const QString &filename, QString &device, QString &mountPoint, QString &error) override;
+            bool populate(const QString &mountPoint, const QString &source, PayloadStager::Statistics &statistics, QString &error) override;
+            bool detach(const QString &device, bool force, QString &error) override;
+            bool shrink(const QString &filename, QString &error) override;
+            bool convert(const QString &filename, const QString &format, const QString &outputFilename, int compressionLevel, QString &error) override;
+            void setCancelled(bool cancelled) override;
+            void setProgressFunction(PayloadStager::ProgressFunction progressFunction) override;
+            void setOutputFunction(OutputFunction outputFunction) override;
+
+        private:
+            /**
+             * @brief       Runs hdiutil and waits for it to finish.
+             *
+             * @details     hdiutil is killed if the backend is cancelled while it is running, unless the operation
+             *              is one that must complete for the image to be released.  Each line of output is passed
+             *              to the line function as it is written.
+             *
+             * @param[in]   arguments the arguments, the first being the hdiutil verb.
+             * @param[out]  output receives the standard output.
+             * @param[out]  error receives the standard error if hdiutil fails.
+             * @param[in]   isCancellable true if the operation can be cancelled; otherwise false.
+             * @param[in]   lineFunction the function called with each line; or nullptr to pass every line to the
+             *              output function.
+             *
+             * @returns     true if hdiutil exited with a zero exit code; otherwise false.
+             */
+            bool run(const QStringList &arguments, QByteArray &output, QString &error, bool isCancellable = true, ToolProcess::LineFunction lineFunction = nullptr);
+
+            /**
+             * @brief       Passes a line of hdiutil output to the output function, if one is set.
+             *
+             * @param[in]   channel the stream that the line was written to.
+             * @param[in]   line the line.
+             */
+            void writeOutput(BuildEvent::Channel channel, const QString &line) const;
+
+        private:
+            PayloadStager m_stager;                             //! copies the payload into the volume
+            std::atomic<bool> m_cancelled;                      //! set when the build has been cancelled
+            PayloadStager::ProgressFunction m_progressFunction; //! called as the image is converted
+            OutputFunction m_outputFunction;                    //! called with each line of hdiutil output
+    };
+}
+
+#endif //NEDRYSOFT_HDIUTILIMAGEBACKEND_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_IIMAGEBACKEND_H
+#define NEDRYSOFT_IIMAGEBACKEND_H
+
+#include "BuildEvent.h"
+#include "PayloadStager.h"
+
+#include <QString>
+#include <functional>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The Interface definition for a disk image backend.
+     *
+     * @details     Describes the operations that a build performs on a disk image.  dmgbuild drives the backend
+     *              through the dmgee module in place of running hdiutil, so a backend that does not need macOS tools
+     *              allows the whole build pipeline to be run anywhere.
+     */
+    class IImageBackend {
+        public:
+            /**
+             * @brief       Function called with each line that a tool run by the backend writes.
+             *
+             * @param[in]   program the path of the tool.
+             * @param[in]   channel the stream that the line was written to.
+             * @param[in]   line the line, without the line ending.
+             */
+            using OutputFunction = std::function<void(const QString &program, BuildEvent::Channel channel, const QString &line)>;
+
+        public:
+            /**
+             * @brief       Destroys the backend.
+             */
+            virtual ~IImageBackend() = default;
+
+            /**
+             * @brief       Returns the name of the backend.
+             *
+             * @returns     the name used to select the backend.
+             */
+            virtual QString name() const = 0;
+
+            /**
+             * @brief       Creates a new writable image.
+             *
+             * @param[in]   filename the filename of the image, an existing image is replaced.
+             * @param[in]   volumeName the name of the volume.
+             * @param[in]   size the size of the volume in bytes.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the image was created; otherwise false.
+             */
+            virtual bool create(const QString &filename, const QString &volumeName, qint64 size, QString &error) = 0;
+
+            /**
+             * @brief       Attaches a writable image so that its contents can be modified.
+             *
+             * @param[in]   filename the filename of the image.
+             * @param[out]  device receives the device that the image is attached to.
+             * @param[out]  mountPoint receives the folder that the volume is mounted on.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the image was attached; otherwise false.
+             */
+            virtual bool attach(const QString &filename, QString &device, QString &mountPoint, QString &error) = 0;
+
+            /**
+             * @brief       Copies a payload entry into an attached image.
+             *
+             * @param[in]   mountPoint the folder that the volume is mounted on.
+             * @param[in]   source the file, folder or symlink to copy.
+             * @param[out]  statistics the totals are added to this.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the entry was copied; otherwise false.
+             */
+            virtual bool populate(const QString &mountPoint, const QString &source, PayloadStager::Statistics &statistics, QString &error) = 0;
+
+            /**
+             * @brief       Detaches an attached image.
+             *
+             * @param[in]   device the device returned by attach.
+             * @param[in]   force true if the image should be detached even if files are open.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the image was detached; otherwise false.
+             */
+            virtual bool detach(const QString &device, bool force, QString &error) = 0;
+
+            /**
+             * @brief       Shrinks a detached writable image to the smallest size that holds its contents.
+             *
+             * @param[in]   filename the filename of the image.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the image was shrunk; otherwise false.
+             */
+            virtual bool shrink(const QString &filename, QString &error) = 0;
+
+            /**
+             * @brief       Converts a detached writable image to the final image.
+             *
+             * @param[in]   filename the filename of the writable image.
+             * @param[in]   format the format of the final image (UDZO, UDBZ etc).
+             * @param[in]   outputFilename the filename of the final image, an existing file is replaced.
+             * @param[in]   compressionLevel the compression level or 0 for the default.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true if the image was converted; otherwise false.
+             */
+            virtual bool convert(const QString &filename, const QString &format, const QString &outputFilename, int compressionLevel, QString &error) = 0;
+
+            /**
+             * @brief       Sets whether the build using the backend has been cancelled.
+             *
+             * @details     A cancelled backend stops the operation in progress as soon as possible and fails any
+             *              operation that would change the image until it is reset by passing false.  Detaching is
+             *              still allowed so that a cancelled build can release the image.
+             *
+             * @note        May be called from any thread.
+             *
+             * @param[in]   cancelled true to cancel; false to allow operations.
+             */
+            virtual void setCancelled(bool cancelled) = 0;
+
+            /**
+             * @brief       Sets the function that is called as data is processed.
+             *
+             * @details     The function receives the number of bytes processed since the previous call, it is called
+             *              while a payload entry is copied by populate and while an image is converted if the backend
+             *              is able to measure the progress of the conversion.
+             *
+             * @note        The function may be called from any thread and must not be changed while an operation is
+             *              in progress.
+             *
+             * @param[in]   progressFunction the function; or nullptr to stop reporting progress.
+             */
+            virtual void setProgressFunction(PayloadStager::ProgressFunction progressFunction) = 0;
+
+            /**
+             * @brief       Sets the function that is called with the output of the tools that the backend runs.
+             *
+             * @details     Lines are passed on while the tool is running, output that the backend parses (such as a
+             *              plist or progress reports) is not passed on.
+             *
+             * @note        The function is called from the thread performing the operation and must not be changed
+             *              while an operation is in progress.
+             *
+             * @param[in]   outputFunction the function; or nullptr to discard the output.
+             */
+            virtual void setOutputFunction(OutputFunction outputFunction) = 0;
+    };
+}
+
+#endif // NEDRYSOFT_IIMAGEBACKEND_H
@@ -19,6 +19,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+//! @note Python must be included first!
+
+#include "Python.h"
+
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 
@@ -35,7 +39,6 @@
 #include <QDesktopServices>
 #include <QElapsedTimer>
 #include <QFileInfo>
-#include <QJsonDocument>
 #include <QList>
 #include <QMenu>
 #include <QMessageBox>
@@ -49,12 +52,16 @@
 #include <QSettings>
 #include <QStyleFactory>
 #include <QTemporaryDir>
+#include <QThread>
 #include <QTimer>
 #include <QWebEngineProfile>
 #include <QWebEngineSettings>
 #include <QWindow>
+#include <memory>
 #include <utility>
 
+constexpr auto progressBarMaximum = 1000;                       //! the progress bar shows tenths of a percent
+
 // convenience macros for ansi escape sequences
 
 #define fore Nedrysoft::AnsiEscape::fore
@@ -67,6 +74,7 @@
 using namespace std::chrono_literals;
 
 constexpr auto splashScreenDuration = 100ms;//3s;
+constexpr auto buildEventInterval = 16ms;                   //! build events are delivered to the GUI once per frame
 constexpr auto repositoryUrl = "https://github.com/fizzyade/dmgee";
 constexpr auto menuIconSize = 32;
 constexpr auto spinnerSize = 16;
@@ -80,6 +88,12 @@ Nedrysoft::MainWindow::MainWindow() :
         ui(new Ui::MainWindow),
         m_backgroundImage(),
         m_builder(new Builder),
+        m_workerPool(new BuildWorkerPool),
+        m_buildJobId(-1),
+        m_nextBuildJobId(0),
+        m_isProfiling(false),
+        m_sizeScanRunning(false),
+        m_sizeScanPending(false),
         m_settingsDialog(nullptr),
         m_openRecentMenu(nullptr) {
 
@@ -126,6 +140,7 @@ Nedrysoft::MainWindow::~MainWindow() {
     delete m_stateLabel;
     delete m_progressSpinner;
     delete m_loadingMovie;
+    delete m_workerPool;
 }
 
 Nedrysoft::MainWindow *Nedrysoft::MainWindow::getInstance() {
@@ -178,48 +193,42 @@ void Nedrysoft::MainWindow::closeEvent(QCloseEvent *closeEvent) {
 
 void Nedrysoft::MainWindow::processBackground() {
     if (m_backgroundImage.isValid()) {
-        std::vector<std::vector<cv::Point> > contours;
-        std::vector<cv::Vec4i> hierarchy;
-        cv::Mat image = m_backgroundImage.mat();
-
-        // convert the image to grey scale for contour detection
-
-        cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
-
-        m_centroids.clear();
+        // the detected features are only dependant on the image content, so they are only re-calculated when the
+        // background changes, the minimum feature size is applied as a filter on the cached results.
 
-        // apply thresholding
+        if ((m_featuresKey.isNull()) || (m_featuresKey!=m_backgroundKey)) {
+            if ((m_backgroundKey.isNull()) || (!m_featureCache.load(m_backgroundKey, m_features))) {
+                FeatureDetector::Result previousFeatures;
+                auto previousKey = m_featureCache.previousKey(m_backgroundFilename);
 
-        cv::threshold(image, image, 1, 32, cv::THRESH_TRUNC);
+                // if the background has been modified since it was last processed then only the tiles that
+                // changed need to be processed.
 
-        // apply second stage thresholding (to black and white)
-
-        cv::threshold(image, image, 230, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
-
-        // find contours in image
-
-        cv::findContours(image, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-
-        // find centre of discovered objects in image
-
-        for (auto &contour : contours) {
-            float sumX = 0, sumY = 0;
-            float size = contour.size();
-            QPointF centroid;
+                if ((!previousKey.isNull()) && (m_featureCache.load(previousKey, previousFeatures))) {
+                    m_features = FeatureDetector::update(m_backgroundImage.mat(), previousFeatures);
+                } else {
+                    m_features = FeatureDetector::detect(m_backgroundImage.mat());
+                }
 
-            if (size > 0) {
-                for (auto &point : contour) {
-                    sumX += point.x;
-                    sumY += point.y;
+                if (!m_backgroundKey.isNull()) {
+                    m_featureCache.store(m_backgroundKey, m_features);
                 }
+            }
 
-                centroid = QPointF(sumX / size, sumY / size);
+            if (!m_backgroundKey.isNull()) {
+                m_featureCache.setPreviousKey(m_backgroundFilename, m_backgroundKey);
             }
 
-            auto area = cv::contourArea(contour);
+            m_featuresKey = m_backgroundKey;
+        }
+
+        auto featureSize = m_builder->snapshot().featureSize;
 
-            if (area > configValue("featuresize", 10000).toInt()) {
-                m_centroids.append(centroid);
+        m_centroids.clear();
+
+        for (auto const &feature : m_features.features) {
+            if (feature.area > featureSize) {
+                m_centroids.append(feature.centroid);
             }
         }
 
@@ -297,7 +306,7 @@ void Nedrysoft::MainWindow::updateGUI() {
     ui->fontSizeLineEdit->setText(QString("%1").arg(configValue("textsize", 12).toInt()));
 
     ui->featureAutoDetectCheckbox->setCheckState(configValue("detectfeatures", true).toBool() ? Qt::Checked : Qt::Unchecked);
-    ui->minFeatureSlider->setValue(configValue("featuresize", 10000).toInt());
+    ui->minFeatureSlider->setValue(configValue("featuresize", Nedrysoft::FeatureDetector::DefaultMinimumArea).toInt());
 
     ui->volumeNameLineEdit->setText(configValue("volumename", "My DMG").toString());
 
@@ -317,6 +326,8 @@ void Nedrysoft::MainWindow::updateGUI() {
 
     updatePixmap();
 
+    updateSizeEstimate();
+
     return;
 }
 
@@ -324,7 +335,9 @@ void Nedrysoft::MainWindow::updatePixmap() {
     QFileInfo fileInfo(configValue("background", "").value<QString>());
 
     if (!fileInfo.absoluteFilePath().isEmpty()) {
-        m_backgroundImage = Nedrysoft::Image(fileInfo.absoluteFilePath(), true);
+        m_backgroundFilename = fileInfo.absoluteFilePath();
+        m_backgroundImage = Nedrysoft::Image(m_backgroundFilename, true);
+        m_backgroundKey = Nedrysoft::FeatureCache::key(m_backgroundFilename, Nedrysoft::FeatureDetector::Parameters);
 
         if (m_backgroundImage.isValid()) {
             m_backgroundPixmap = QPixmap::fromImage(m_backgroundImage.image());
@@ -385,25 +398,97 @@ QString Nedrysoft::MainWindow::timespan(int milliseconds, QString &hours, QStrin
     return outputString;
 }
 
-void Nedrysoft::MainWindow::onProgressUpdate(QString updateData) {
-    auto updateMap = QJsonDocument::fromJson(updateData.toUtf8()).toVariant().toMap();
+void Nedrysoft::MainWindow::processBuildEvents() {
+    QVector<Nedrysoft::BuildEvent> events;
+
+    m_builder->eventQueue().drain(events);
+
+    handleBuildEvents(events);
+}
+
+void Nedrysoft::MainWindow::handleBuildEvents(const QVector<Nedrysoft::BuildEvent> &events) {
+    m_buildTrace.addEvents(events);
+
+    // consecutive per-file events are merged into a single update that describes the last file of the run, the
+    // progress is updated for each event so that every line shows the progress at the time it happened.
+
+    for (auto eventIndex = 0; eventIndex < events.count(); eventIndex++) {
+        auto const &event = events[eventIndex];
+        auto count = 1;
+
+        m_buildProgress.addEvent(event);
+
+        if ((event.type==Nedrysoft::BuildEvent::OperationStart) &&
+            ((event.operation==Nedrysoft::BuildEvent::FileAdd) || (event.operation==Nedrysoft::BuildEvent::SymlinkAdd))) {
+
+            while ((eventIndex+1 < events.count()) &&
+                   (events[eventIndex+1].type==event.type) &&
+                   (events[eventIndex+1].operation==event.operation)) {
+
+                eventIndex++;
+                count++;
+
+                m_buildProgress.addEvent(events[eventIndex]);
+            }
+        }
+
+        onBuildEvent(events[eventIndex], count);
+    }
+
+    updateBuildProgress();
+}
+
+void Nedrysoft::MainWindow::onBuildEvent(const Nedrysoft::BuildEvent &event, int count) {
     QString updateMessage;
-    QStringList type = updateMap["type"].toString().split("::");
 
-    if (type[0]=="build") {
-        updateMessage = handleBuildProgress(updateMap);
-    } else if (type[0]=="operation") {
-        updateMessage = handleOperationProgress(updateMap);
+    switch (event.type) {
+        case Nedrysoft::BuildEvent::BuildStarted:
+        case Nedrysoft::BuildEvent::BuildFinished: {
+            updateMessage = handleBuildProgress(event);
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::OperationStart: {
+            updateMessage = handleOperationProgress(event, count);
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::ToolOutput: {
+            // tool output is indented under the update that started the tool rather than given its own progress
+
+            ui->terminalWidget->println(handleToolOutput(event));
+            break;
+        }
+
+        default: {
+            break;
+        }
     }
 
     if (!updateMessage.isEmpty()) {
-        int progressValue = static_cast<int>((static_cast<float>(m_progressBar->value())/static_cast<float>(m_progressBar->maximum()-1))*100);
+        auto progressValue = static_cast<int>(m_buildProgress.fraction()*100);
 
         ui->terminalWidget->print(QString("[%1%] ").arg(progressValue, 3, 10));
         ui->terminalWidget->println(updateMessage);
+    }
+}
+
+void Nedrysoft::MainWindow::updateBuildProgress() {
+    if (m_progressBar->isHidden()) {
+        return;
+    }
+
+    auto fraction = m_buildProgress.fraction();
+    auto remainingTime = m_buildProgress.remainingTime();
+    auto stateText = tr("Building Image... %1%").arg(static_cast<int>(fraction*100));
 
-        m_progressBar->setValue(m_progressBar->value()+1);
+    m_progressBar->setValue(static_cast<int>(fraction*progressBarMaximum));
+
+    if (remainingTime>0) {
+        stateText += " "+tr("(about %1 remaining)").arg(Nedrysoft::BuildProgress::durationString(remainingTime));
     }
+
+    m_stateLabel->setText(stateText);
 }
 
 void Nedrysoft::MainWindow::setupStatusBar() {
@@ -438,14 +523,53 @@ void Nedrysoft::MainWindow::setupStatusBar() {
     m_progressSpinner->setVisible(false);
     m_progressBar->setVisible(false);
 
+    m_progressBar->setRange(0, progressBarMaximum);
     m_progressBar->setValue(0);
-    m_progressBar->setRange(0, 12+m_builder->totalFiles()+m_builder->totalSymlinks());
+
+    m_sizeLabel = new QLabel;
+
+    ui->statusbar->addPermanentWidget(m_sizeLabel);
 
     m_stateLabel = new QLabel(tr("Idle"));
 
     ui->statusbar->addPermanentWidget(m_stateLabel);
 }
 
+void Nedrysoft::MainWindow::updateSizeEstimate() {
+    if (m_sizeScanRunning) {
+        m_sizeScanPending = true;
+
+        return;
+    }
+
+    auto contents = m_builder->imageContents();
+    auto symlinks = m_builder->totalSymlinks();
+    auto imageSize = std::make_shared<qint64>(0);
+
+    m_sizeScanRunning = true;
+    m_sizeScanPending = false;
+
+    // the scan is run on its own thread so that a large payload does not block the editor
+
+    auto scanThread = QThread::create([=]() {
+        *imageSize = Nedrysoft::Builder::imageSize(contents, symlinks);
+    });
+
+    connect(scanThread, &QThread::finished, scanThread, &QObject::deleteLater);
+
+    connect(scanThread, &QThread::finished, this, [=]() {
+        m_sizeScanRunning = false;
+
+        m_sizeLabel->setText(tr("Estimated size: %1").arg(locale().formattedDataSize(*imageSize)));
+
+        if (m_sizeScanPending) {
+            updateSizeEstimate();
+        }
+    });
+
+    scanThread->start();
+}
+
 void Nedrysoft::MainWindow::setupComboBoxes() {
     QList<QPair<QString, QString> > diskFormats;
 
@@ -547,9 +671,119 @@ void Nedrysoft::MainWindow::onGridSnapChanged(bool checked) {
 void Nedrysoft::MainWindow::onCreateDMG() {
     ui->terminalWidget->println("");
 
-    // TODO: output file should be overridable from the command line
+    if ((m_builder->isBuilding()) || (m_buildJobId!=-1)) {
+        ui->terminalWidget->println(fore(AnsiColour::YELLOW)+tr("A build is already in progress.")+reset);
+
+        return;
+    }
+
+    auto outputFilename = m_builder->property("outputfile").toString();
+
+    // saved configurations are built in a worker process so that a failure in the build cannot take down the
+    // editor, the worker reads the configuration from disk so unsaved changes are built in this process.
 
-    m_builder->createDMG(m_builder->property("outputfile").toString());
+    if ((!m_builder->filename().isEmpty()) && (!m_builder->modified())) {
+        // the worker checks the configuration again, checking it here reports the problems without starting it
+
+        auto preflight = m_builder->preflight(outputFilename);
+
+        reportPreflight(preflight);
+
+        if (preflight.hasErrors()) {
+            reportBuildFailure(Nedrysoft::Python::ScriptInvalid, QString());
+
+            return;
+        }
+
+        m_buildJobId = m_nextBuildJobId++;
+
+        m_workerPool->start(m_buildJobId, m_builder->filename(), outputFilename, 0, m_isProfiling);
+    } else {
+        m_builder->setProfiling(m_isProfiling);
+
+        QWeakPointer<Nedrysoft::BuildHandle> build = m_builder->createDMG(outputFilename);
+
+        reportPreflight(m_builder->preflightResult());
+
+        if (!build) {
+            reportBuildFailure(Nedrysoft::Python::ScriptInvalid, QString());
+
+            return;
+        }
+
+        connect(build.data(), &Nedrysoft::BuildHandle::finished, this, [=](int result) {
+            auto handle = build.toStrongRef();
+
+            // the events pushed at the end of the script are collected now rather than waiting for a notification
+
+            m_buildEventTimer.stop();
+
+            processBuildEvents();
+
+            if ((handle) && (!handle->profile().isEmpty())) {
+                reportBuildProfile(handle->profile());
+            }
+
+            if (result!=Nedrysoft::Python::Ok) {
+                reportBuildFailure(result, handle ? handle->traceback() : QString());
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+void Nedrysoft::MainWindow::reportBuildFailure(int result, const QString &traceback) {
+    switch (result) {
+        case Nedrysoft::Python::ScriptCancelled: {
+            ui->terminalWidget->println(fore(AnsiColour::YELLOW)+tr("The build was cancelled.")+reset);
+            break;
+        }
+
+        case Nedrysoft::Python::ScriptTimedOut: {
+            ui->terminalWidget->println(fore(AnsiColour::YELLOW)+tr("The build was cancelled as it took too long.")+reset);
+            break;
+        }
+
+        default: {
+            if (!traceback.isEmpty()) {
+                for (auto const &line : traceback.trimmed().split('\n')) {
+                    ui->terminalWidget->println(fore(AnsiColour::RED)+line+reset);
+                }
+            }
+
+            ui->terminalWidget->println(fore(AnsiColour::RED)+style(AnsiStyle::BRIGHT)+tr("The build failed.")+reset);
+            break;
+        }
+    }
+
+    m_progressSpinner->setVisible(false);
+    m_progressBar->setVisible(false);
+    m_stateLabel->setText(tr("Idle"));
+}
+
+void Nedrysoft::MainWindow::reportBuildProfile(const Nedrysoft::ScriptProfile &profile) {
+    auto lines = profile.summary();
+
+    m_buildTrace.setProfile(profile);
+
+    for (auto lineIndex = 0; lineIndex<lines.count(); lineIndex++) {
+        ui->terminalWidget->println((lineIndex ? fore(Qt::lightGray) : fore(AnsiColour::CYAN))+lines[lineIndex]+reset);
+    }
+}
+
+void Nedrysoft::MainWindow::reportPreflight(const Nedrysoft::PreflightCheck::Result &result) {
+    auto lines = result.lines();
+
+    // there is a line for each problem, in the same order, followed by the summary
+
+    for (auto lineIndex = 0; lineIndex<lines.count(); lineIndex++) {
+        auto colour = fore(Qt::lightGray);
+
+        if (lineIndex<result.problems.count()) {
+            colour = (result.problems[lineIndex].severity==Nedrysoft::PreflightCheck::Problem::Error) ? fore(AnsiColour::RED) : fore(AnsiColour::YELLOW);
+        }
+
+        ui->terminalWidget->println(colour+lines[lineIndex]+reset);
+    }
 }
 
 void Nedrysoft::MainWindow::onTerminalReady() {
@@ -598,6 +832,18 @@ void Nedrysoft::MainWindow::onTerminalContextMenuTriggered() {
     auto clearTerminalAction = menu.addAction(trashIcon, tr("Clear"));
     auto copyToClipboardAction = menu.addAction(copyIcon, tr("Copy to clipboard"));
 
+    menu.addSeparator();
+
+    auto cancelBuildAction = menu.addAction(tr("Cancel build"));
+    auto saveTraceAction = menu.addAction(tr("Save build trace..."));
+    auto profileBuildsAction = menu.addAction(tr("Profile builds"));
+
+    profileBuildsAction->setCheckable(true);
+    profileBuildsAction->setChecked(m_isProfiling);
+
+    cancelBuildAction->setEnabled((m_builder->isBuilding()) || (m_buildJobId!=-1));
+    saveTraceAction->setEnabled(!m_buildTrace.isEmpty());
+
     auto selectedAction = menu.exec(QCursor::pos());
 
     if (selectedAction) {
@@ -605,6 +851,22 @@ void Nedrysoft::MainWindow::onTerminalContextMenuTriggered() {
             ui->terminalWidget->clear();
         } else if (selectedAction == copyToClipboardAction) {
             ui->terminalWidget->getTerminalBuffer();
+        } else if (selectedAction == cancelBuildAction) {
+            if (m_buildJobId!=-1) {
+                m_workerPool->cancel(m_buildJobId);
+            } else {
+                m_builder->cancel();
+            }
+        } else if (selectedAction == profileBuildsAction) {
+            m_isProfiling = profileBuildsAction->isChecked();
+        } else if (selectedAction == saveTraceAction) {
+            auto filename = QFileDialog::getSaveFileName(this, tr("Save build trace"), QString(), tr("Trace files (*.json)"));
+            auto processName = QFileInfo(m_builder->property("outputfile").toString()).fileName();
+            QString error;
+
+            if ((!filename.isEmpty()) && (!Nedrysoft::BuildTrace::save(filename, m_buildTrace.traceEvents(1, processName), &error))) {
+                QMessageBox::warning(this, tr("Save build trace"), tr("Unable to save the build trace.\n\n%1").arg(error));
+            }
         }
     }
 }
@@ -619,13 +881,21 @@ void Nedrysoft::MainWindow::copyTerminalBufferToClipboard(QString terminalBuffer
     clipboard->setText(terminalBuffer);
 }
 
-QString Nedrysoft::MainWindow::handleBuildProgress(QVariantMap buildMap) {
+QString Nedrysoft::MainWindow::handleToolOutput(const Nedrysoft::BuildEvent &event) {
+    auto textColour = (event.channel==Nedrysoft::BuildEvent::StandardError) ? fore(AnsiColour::YELLOW) : fore(Qt::darkGray);
+
+    return QString("       ")+
+           fore(Qt::gray)+QFileInfo(event.path).fileName()+": "+
+           textColour+event.text+
+           reset;
+}
+
+QString Nedrysoft::MainWindow::handleBuildProgress(const Nedrysoft::BuildEvent &event) {
     static QElapsedTimer durationTimer;
     bool showActivity = false;
-    QStringList type = buildMap["type"].toString().split("::");
     QString updateMessage;
 
-    if (type[1]=="started") {
+    if (event.type==Nedrysoft::BuildEvent::BuildStarted) {
         durationTimer.restart();
 
         updateMessage =
@@ -638,8 +908,9 @@ QString Nedrysoft::MainWindow::handleBuildProgress(QVariantMap buildMap) {
 
         m_stateLabel->setText(tr("Building Image..."));
         m_progressSpinner->setVisible(true);
+        m_progressBar->setValue(0);
         m_progressBar->setVisible(true);
-    } else if (type[1]=="finished") {
+    } else if (event.type==Nedrysoft::BuildEvent::BuildFinished) {
         QString hours, minutes, seconds;
         QString hoursMinutesSecondsString;
         QString minutesSecondsString;
@@ -688,91 +959,146 @@ QString Nedrysoft::MainWindow::handleBuildProgress(QVariantMap buildMap) {
     return updateMessage;
 }
 
-QString Nedrysoft::MainWindow::handleOperationProgress(QVariantMap operationMap) {
-    QStringList type = operationMap["type"].toString().split("::");
+QString Nedrysoft::MainWindow::handleOperationProgress(const Nedrysoft::BuildEvent &event, int count) {
     auto normalColour = fore(QColor("#A8C023"));
     QString updateMessage;
 
-    if (type[1] == "start") {
-        QStringList operation = operationMap["operation"].toString().split("::");
+    if (event.type!=Nedrysoft::BuildEvent::OperationStart) {
+        return updateMessage;
+    }
 
-        updateMessage.clear();
+    switch (event.operation) {
+        case Nedrysoft::BuildEvent::SettingsLoad: {
+            updateMessage = normalColour + tr("Loading settings...") + reset;
+            break;
+        }
 
-        if (operation[0] == "settings") {
-            if (operation[1] == "load") {
-                updateMessage = normalColour + tr("Loading settings...") + reset;
-            }
-        } else if (operation[0] == "size") {
-            if (operation[1] == "calculate") {
-                updateMessage = normalColour + tr("Calculating DMG size...") + reset;
-            }
-        } else if (operation[0] == "dmg") {
-            if (operation[1] == "create") {
-                updateMessage = normalColour + tr("Creating DMG...") + reset;
-            } else if (operation[1] == "shrink") {
-                updateMessage = normalColour + tr("Shrinking DMG...") + reset;
-            } else if (operation[1] == "addlicense") {
-                updateMessage = normalColour + tr("Adding license...") + reset;
-            }
-        } else if (operation[0] == "background") {
-            if (operation[1] == "create") {
-                updateMessage = normalColour + tr("Creating Background Image...") + reset;
-            }
-        } else if (operation[0] == "files") {
-            if (operation[1] == "add") {
-                updateMessage = normalColour + tr("Adding files to DMG...") + reset;
-            }
-        } else if (operation[0] == "file") {
-            if (operation[1] == "add") {
-                QFileInfo fileInfo(operationMap["file"].toString());
-
-                QString filename =
-                        fore(AnsiColour::WHITE) +
-                        "\"" +
-                        fore(0xb0, 0x85, 0xbe) +
-                        underline(true) +
-                        hyperlink(QUrl::fromLocalFile(fileInfo.filePath()).toString(), fileInfo.fileName()) +
-                        underline(false) +
-                        fore(AnsiColour::WHITE) +
-                        "\"" +
-                        normalColour;
+        case Nedrysoft::BuildEvent::SizeCalculate: {
+            updateMessage = normalColour + tr("Calculating DMG size...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DmgCreate: {
+            updateMessage = normalColour + tr("Creating DMG...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DmgShrink: {
+            updateMessage = normalColour + tr("Shrinking DMG...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DmgAddLicense: {
+            updateMessage = normalColour + tr("Adding license...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::BackgroundCreate: {
+            updateMessage = normalColour + tr("Creating Background Image...") + reset;
+            break;
+        }
 
+        case Nedrysoft::BuildEvent::FilesAdd: {
+            updateMessage = normalColour + tr("Adding files to DMG...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::FileAdd: {
+            QFileInfo fileInfo(event.path);
+
+            QString filename =
+                    fore(AnsiColour::WHITE) +
+                    "\"" +
+                    fore(0xb0, 0x85, 0xbe) +
+                    underline(true) +
+                    hyperlink(QUrl::fromLocalFile(fileInfo.filePath()).toString(), fileInfo.fileName()) +
+                    underline(false) +
+                    fore(AnsiColour::WHITE) +
+                    "\"" +
+                    normalColour;
+
+            if (count>1) {
+                updateMessage =
+                        normalColour + QString(tr("Adding %1 files, last file %2...")).arg(count).arg(filename) +
+                        normalColour +
+                        reset;
+            } else {
                 updateMessage =
                         normalColour + QString(tr("Adding file %1...")).arg(filename) +
                         normalColour +
                         reset;
             }
-        } else if (operation[0] == "symlinks") {
-            if (operation[1] == "add") {
-                updateMessage = normalColour + tr("Creating symlinks in DMG...") + reset;
-            }
-        } else if (operation[0] == "symlink") {
-            if (operation[1] == "add") {
-                QString filename =
-                        fore(AnsiColour::WHITE) +
-                        "\"" +
-                        fore(0xb0, 0x85, 0xbe) +
-                        underline(true) +
-                        hyperlink(QUrl::fromLocalFile(operationMap["target"].toString()).toString(), operationMap["target"].toString()) +
-                        underline(false) +
-                        fore(AnsiColour::WHITE) +
-                        "\"" +
-                        normalColour;
 
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::SymlinksAdd: {
+            updateMessage = normalColour + tr("Creating symlinks in DMG...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::SymlinkAdd: {
+            QString filename =
+                    fore(AnsiColour::WHITE) +
+                    "\"" +
+                    fore(0xb0, 0x85, 0xbe) +
+                    underline(true) +
+                    hyperlink(QUrl::fromLocalFile(event.path).toString(), event.path) +
+                    underline(false) +
+                    fore(AnsiColour::WHITE) +
+                    "\"" +
+                    normalColour;
+
+            if (count>1) {
+                updateMessage =
+                        normalColour +
+                        QString(tr("Adding %1 symlinks, last symlink %2...")).arg(count).arg(filename) +
+                        normalColour +
+                        reset;
+            } else {
                 updateMessage =
                         normalColour +
                         QString(tr("Adding symlink %1...")).arg(filename) +
                         normalColour +
                         reset;
             }
-        } else if (operation[0] == "extensions") {
-            if (operation[1] == "hide") {
-                updateMessage = normalColour + tr("Hiding files...") + reset;
-            }
-        } else if (operation[0] == "dsstore") {
-            if (operation[1] == "create") {
-                updateMessage = normalColour + tr("Creating DS_Store...") + reset;
-            }
+
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::ExtensionsHide: {
+            updateMessage = normalColour + tr("Hiding files...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DsStoreCreate: {
+            updateMessage = normalColour + tr("Creating DS_Store...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DsStoreCached: {
+            updateMessage = normalColour + tr("Reusing cached DS_Store...") + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::DmgConvert: {
+            updateMessage = normalColour + tr("Compressing DMG (%1)...").arg(locale().formattedDataSize(event.bytes)) + reset;
+            break;
+        }
+
+        case Nedrysoft::BuildEvent::PayloadStaged: {
+            auto throughput = event.duration>0 ? static_cast<qint64>(static_cast<double>(event.bytes)*1e9/static_cast<double>(event.duration)) : event.bytes;
+
+            updateMessage =
+                    normalColour +
+                    QString(tr("Staged %1 files (%2) at %3/s")).arg(event.count).arg(locale().formattedDataSize(event.bytes)).arg(locale().formattedDataSize(throughput)) +
+                    reset;
+
+            break;
+        }
+
+        default: {
+            break;
         }
     }
 
@@ -982,7 +1308,47 @@ void Nedrysoft::MainWindow::setupValidators() {
 }
 
 void Nedrysoft::MainWindow::setupSignals() {
-    connect(m_builder, &Nedrysoft::Builder::progressUpdate, this, &MainWindow::onProgressUpdate, Qt::QueuedConnection);
+    // build events are collected from the queue once per frame rather than being delivered individually
+
+    m_buildEventTimer.setSingleShot(true);
+    m_buildEventTimer.setInterval(buildEventInterval);
+
+    connect(&m_buildEventTimer, &QTimer::timeout, this, &MainWindow::processBuildEvents);
+
+    connect(m_builder, &Nedrysoft::Builder::filesChanged, this, &MainWindow::updateSizeEstimate);
+    connect(m_builder, &Nedrysoft::Builder::symlinksChanged, this, &MainWindow::updateSizeEstimate);
+
+    connect(m_builder, &Nedrysoft::Builder::eventsPending, this, [=]() {
+        if (!m_buildEventTimer.isActive()) {
+            m_buildEventTimer.start();
+        }
+    }, Qt::QueuedConnection);
+
+    // worker processes already send their events in batches of one frame
+
+    connect(m_workerPool, &Nedrysoft::BuildWorkerPool::jobEvents, this, [=](int jobId, QVector<Nedrysoft::BuildEvent> events) {
+        if (jobId==m_buildJobId) {
+            handleBuildEvents(events);
+        }
+    });
+
+    connect(m_workerPool, &Nedrysoft::BuildWorkerPool::jobProfiled, this, [=](int jobId, Nedrysoft::ScriptProfile profile) {
+        if (jobId==m_buildJobId) {
+            reportBuildProfile(profile);
+        }
+    });
+
+    connect(m_workerPool, &Nedrysoft::BuildWorkerPool::jobFinished, this, [=](int jobId, int result, QString traceback) {
+        if (jobId!=m_buildJobId) {
+            return;
+        }
+
+        m_buildJobId = -1;
+
+        if (result!=Nedrysoft::Python::Ok) {
+            reportBuildFailure(result, traceback);
+        }
+    });
 
     connect(ui->terminalWidget, &Nedrysoft::HTermWidget::terminalReady, this, &MainWindow::onTerminalReady);
     connect(ui->terminalWidget, &Nedrysoft::HTermWidget::contextMenu, this, &MainWindow::onTerminalContextMenuTriggered);
@@ -22,7 +22,12 @@
 #ifndef NEDRYSOFT_MAINWINDOW_H
 #define NEDRYSOFT_MAINWINDOW_H
 
+#include "BuildProgress.h"
+#include "BuildTrace.h"
+#include "BuildWorkerPool.h"
 #include "Builder.h"
+#include "FeatureCache.h"
+#include "FeatureDetector.h"
 #include "Image.h"
 #include "SettingsDialog.h"
 #include "SplashScreen.h"
@@ -33,6 +38,7 @@
 #include <QMainWindow>
 #include <QMovie>
 #include <QProgressBar>
+#include <QTimer>
 
 namespace Ui {
     class MainWindow;
@@ -191,31 +197,93 @@ namespace Nedrysoft {
 
             QString timespan(int milliseconds, QString &hours, QString &minutes, QString &seconds);
 
+            /**
+             * @brief       Drains the builder event queue and updates the GUI with the current progress.
+             */
+            void processBuildEvents();
+
+            /**
+             * @brief       Updates the GUI with a batch of build events.
+             *
+             * @details     Consecutive per-file events are merged into a single update.
+             *
+             * @param[in]   events the events in the order they occurred.
+             */
+            void handleBuildEvents(const QVector<Nedrysoft::BuildEvent> &events);
+
+            /**
+             * @brief       Reports a build that did not succeed in the terminal and resets the status bar.
+             *
+             * @param[in]   result the Python::ErrorCode result of the build.
+             * @param[in]   traceback the traceback of the exception that failed the build, if any.
+             */
+            void reportBuildFailure(int result, const QString &traceback);
+
+            /**
+             * @brief       Prints the summary of a build profile in the terminal and adds it to the build trace.
+             *
+             * @param[in]   profile the profile of the build script.
+             */
+            void reportBuildProfile(const Nedrysoft::ScriptProfile &profile);
+
+            /**
+             * @brief       Prints the result of the pre-flight check of a build in the terminal.
+             *
+             * @param[in]   result the result of the check.
+             */
+            void reportPreflight(const Nedrysoft::PreflightCheck::Result &result);
+
             /**
              * @brief       Updates the GUI with the current progress.
-             * @param[in]   updateData the JSON update as a string.
+             * @param[in]   event the progress event.
+             * @param[in]   count the number of consecutive events of the same kind that event represents.
              */
-            void onProgressUpdate(QString updateData);
+            void onBuildEvent(const Nedrysoft::BuildEvent &event, int count = 1);
 
             /**
-             * @brief       Handles "build::" progress updates.
-             * @param[in]   buildMap the QVariantMap map that  containing all parameters.
+             * @brief       Updates the progress bar and the status text with the estimated progress of the build.
+             */
+            void updateBuildProgress();
+
+            /**
+             * @brief       Handles build started/finished events.
+             * @param[in]   event the progress event.
              *
              * @returns     the ANSI escape formatted progress update.
              */
-            QString handleBuildProgress(QVariantMap buildMap);
+            QString handleBuildProgress(const Nedrysoft::BuildEvent &event);
 
             /**
-             * @brief       Handles "operation::" progress updates.
-             * @param[in]   buildMap the QVariantMap map that  containing all parameters.
+             * @brief       Handles operation events.
+             * @param[in]   event the progress event.
+             * @param[in]   count the number of consecutive events of the same kind that event represents.
+             *
+             * @returns     the ANSI escape formatted progress update.
              */
-            QString handleOperationProgress(QVariantMap buildMap);
+            QString handleOperationProgress(const Nedrysoft::BuildEvent &event, int count = 1);
+
+            /**
+             * @brief       Handles a line of output from a tool run by the build.
+             *
+             * @param[in]   event the tool output event.
+             *
+             * @returns     the ANSI escape formatted line, standard error is highlighted.
+             */
+            QString handleToolOutput(const Nedrysoft::BuildEvent &event);
 
             /**
              * @brief       Sets up the controls on the status bar.
              */
             void setupStatusBar();
 
+            /**
+             * @brief       Starts a background scan of the configuration to update the estimated image size.
+             *
+             * @note        Only one scan runs at a time, a request made while a scan is running starts a new scan
+             *              when the current one has finished.
+             */
+            void updateSizeEstimate();
+
             /**
              * @brief       Sets up the validators for ribbon bar line edits.
              */
@@ -392,11 +460,26 @@ namespace Nedrysoft {
             Image m_backgroundImage;                                //! the background image in our intermediate format
             QPixmap m_backgroundPixmap;                             //! the background image as a cached pixmap
             QList<QPointF> m_centroids;                             //! list of centroids discovered from image
+            FeatureDetector::Result m_features;                     //! the features discovered from image
+            FeatureCache m_featureCache;                            //! the on disk cache of detected features
+            QString m_backgroundFilename;                           //! the absolute filename of the current background
+            QString m_backgroundKey;                                //! the feature cache key of the current background
+            QString m_featuresKey;                                  //! the feature cache key that m_features belongs to
             QProgressBar *m_progressBar;                            //! Progress bar when build is taking place
+            QTimer m_buildEventTimer;                               //! delivers queued build events once per frame
             Builder *m_builder;                                     //! builder instance for generating DMG
+            BuildWorkerPool *m_workerPool;                          //! worker processes that builds are run in
+            int m_buildJobId;                                       //! the id of the build running in a worker or -1
+            int m_nextBuildJobId;                                   //! the id of the next worker build
+            BuildTrace m_buildTrace;                                //! the timed phases of the most recent build
+            BuildProgress m_buildProgress;                          //! the estimated progress of the running build
+            bool m_isProfiling;                                     //! whether builds are profiled
             QMovie *m_spinnerMovie;                                 //! The animated GIF used as a spinner
             QLabel *m_progressSpinner;                              //! The spinner label that is embedded in the status bar
             QLabel *m_stateLabel;                                   //! The current status of the application
+            QLabel *m_sizeLabel;                                    //! The estimated size of the image
+            bool m_sizeScanRunning;                                 //! whether a size estimate scan is running
+            bool m_sizeScanPending;                                 //! whether another scan is needed when it finishes
             QMovie *m_loadingMovie;                                 //! The loading spinner
             Nedrysoft::Utils::ThemeSupport *m_themeSupport;         //! Theme support instance
             Nedrysoft::SettingsDialog *m_settingsDialog;            //! Settings dialog instance
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PayloadScanner.h"
+
+#include <QFile>
+#include <QThread>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief       The folders that are waiting to be read, shared between the scanning threads.
+ */
+struct ScanState {
+    std::mutex mutex;                                       //! protects the members below
+    std::condition_variable condition;                      //! signalled when folders are added or the scan ends
+    std::vector<std::string> folders;                       //! folders waiting to be read
+    int pendingFolders = 0;                                 //! folders that are waiting or being read
+    Nedrysoft::PayloadScanner::Totals totals;               //! the totals from the threads that have finished
+};
+
+static qint64 roundedSize(qint64 size) {
+    return ((size+Nedrysoft::PayloadScanner::BlockSize-1)/Nedrysoft::PayloadScanner::BlockSize)*Nedrysoft::PayloadScanner::BlockSize;
+}
+
+static void addFile(Nedrysoft::PayloadScanner::Totals &totals, const struct stat &fileStat) {
+    if (S_ISREG(fileStat.st_mode)) {
+        totals.bytes += fileStat.st_size;
+        totals.allocatedBytes += roundedSize(fileStat.st_size);
+        totals.files++;
+    } else if (S_ISLNK(fileStat.st_mode)) {
+        totals.symlinks++;
+    }
+}
+
+static void readFolder(const std::string &folder, Nedrysoft::PayloadScanner::Totals &totals, std::vector<std::string> &subFolders) {
+    auto folderFd = open(folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (folderFd<0) {
+        return;
+    }
+
+    auto dir = fdopendir(folderFd);
+
+    if (!dir) {
+        close(folderFd);
+
+        return;
+    }
+
+    while (auto entry = readdir(dir)) {
+        struct stat entryStat;
+
+        if ((strcmp(entry->d_name, ".")==0) || (strcmp(entry->d_name, "..")==0)) {
+            continue;
+        }
+
+        // the entry type is usually known from the folder itself, which saves a stat for each sub folder
+
+        if (entry->d_type==DT_DIR) {
+            subFolders.push_back(folder+"/"+entry->d_name);
+
+            continue;
+        }
+
+        if (fstatat(folderFd, entry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW)!=0) {
+            continue;
+        }
+
+        if (S_ISDIR(entryStat.st_mode)) {
+            subFolders.push_back(folder+"/"+entry->d_name);
+        } else {
+            addFile(totals, entryStat);
+        }
+    }
+
+    closedir(dir);
+}
+
+Nedrysoft::PayloadScanner::PayloadScanner(int threadCount) :
+        m_threadCount(threadCount>0 ? threadCount : qMax(1, QThread::idealThreadCount())) {
+
+}
+
+Nedrysoft::PayloadScanner::Totals Nedrysoft::PayloadScanner::scan(const QStringList &paths) const {
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    ScanState state;
+
+    for (auto const &path : paths) {
+        auto sourcePath = std::string(QFile::encodeName(path).constData());
+        struct stat pathStat;
+
+        while ((sourcePath.size()>1) && (sourcePath.back()=='/')) {
+            sourcePath.pop_back();
+        }
+
+        if (lstat(sourcePath.c_str(), &pathStat)!=0) {
+            continue;
+        }
+
+        if (S_ISDIR(pathStat.st_mode)) {
+            state.folders.push_back(sourcePath);
+        } else {
+            addFile(state.totals, pathStat);
+        }
+    }
+
+    state.pendingFolders = static_cast<int>(state.folders.size());
+
+    auto scanWorker = [&state]() {
+        Totals totals;
+        std::vector<std::string> subFolders;
+        std::unique_lock<std::mutex> stateLock(state.mutex);
+
+        while (true) {
+            state.condition.wait(stateLock, [&state]() {
+                return (!state.folders.empty()) || (state.pendingFolders==0);
+            });
+
+            if (state.folders.empty()) {
+                break;
+            }
+
+            auto folder = std::move(state.folders.back());
+
+            state.folders.pop_back();
+
+            stateLock.unlock();
+
+            totals.directories++;
+
+            readFolder(folder, totals, subFolders);
+
+            stateLock.lock();
+
+            // the folder is only marked as done once its sub folders have been added, so the scan cannot end while
+            // there is still work to be found.
+
+            state.pendingFolders += static_cast<int>(subFolders.size())-1;
+
+            for (auto &subFolder : subFolders) {
+                state.folders.push_back(std::move(subFolder));
+            }
+
+            subFolders.clear();
+
+            state.condition.notify_all();
+        }
+
+        state.totals.bytes += totals.bytes;
+        state.totals.allocatedBytes += totals.allocatedBytes;
+        state.totals.files += totals.files;
+        state.totals.directories += totals.directories;
+        state.totals.symlinks += totals.symlinks;
+    };
+
+    if (!state.folders.empty()) {
+        for (auto threadIndex = 1; threadIndex<m_threadCount; threadIndex++) {
+            threads.emplace_back(scanWorker);
+        }
+
+        scanWorker();
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    state.totals.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-startTime).count();
+
+    return state.totals;
+}
+
+qint64 Nedrysoft::PayloadScanner::imageSize(const Totals &totals) {
+    auto payloadSize = totals.allocatedBytes+((totals.directories+totals.symlinks)*BlockSize)+((totals.files+totals.directories+totals.symlinks)*EntryOverhead);
+
+    return roundedSize(ReservedSize+payloadSize+((payloadSize*ReservedPercentage)/100));
+}
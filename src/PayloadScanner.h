@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_PAYLOADSCANNER_H
+#define NEDRYSOFT_PAYLOADSCANNER_H
+
+#include <QString>
+#include <QStringList>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The PayloadScanner class totals the size of the files and folders that are copied into an image.
+     *
+     * @details     Folders are read by a pool of threads which share a stack of folders that are waiting to be
+     *              read, so a bundle with tens of thousands of files is spread across all of the cores.  File sizes
+     *              are rounded up to the block size of the image filesystem, which gives the space that the payload
+     *              will occupy once it has been copied into the image.
+     *
+     * @note        The scanner does not hold any state between scans and can be used from any thread.
+     */
+    class PayloadScanner {
+        public:
+            /**
+             * @brief       Holds the totals for a scan.
+             */
+            struct Totals {
+                qint64 bytes = 0;                               //! the total size of the files in bytes
+                qint64 allocatedBytes = 0;                      //! the total size once rounded up to the block size
+                qint64 files = 0;                               //! number of regular files
+                qint64 directories = 0;                         //! number of folders
+                qint64 symlinks = 0;                            //! number of symlinks
+                qint64 duration = 0;                            //! the time taken by the scan in nanoseconds
+            };
+
+        public:
+            static constexpr qint64 BlockSize = 4096;           //! the allocation block size of the image filesystem
+            static constexpr qint64 EntryOverhead = 512;        //! catalog space used by each file, folder or symlink
+            static constexpr qint64 ReservedSize = 32*1024*1024;    //! journal, b-trees and the .DS_Store
+            static constexpr qint64 ReservedPercentage = 2;     //! allocation bitmap and b-tree growth
+
+        public:
+            /**
+             * @brief       Constructs a new PayloadScanner instance.
+             *
+             * @param[in]   threadCount the number of scanning threads, 0 uses the number of processor cores.
+             */
+            explicit PayloadScanner(int threadCount = 0);
+
+            /**
+             * @brief       Scans a list of files, folders and symlinks.
+             *
+             * @note        Symlinks are not followed, entries that do not exist are ignored.
+             *
+             * @param[in]   paths the absolute paths of the entries.
+             *
+             * @returns     the totals for all of the entries.
+             */
+            Totals scan(const QStringList &paths) const;
+
+            /**
+             * @brief       Returns the size of image that is needed to hold a payload.
+             *
+             * @param[in]   totals the totals of the payload.
+             *
+             * @returns     the image size in bytes, a multiple of the block size.
+             */
+            static qint64 imageSize(const Totals &totals);
+
+        private:
+            int m_threadCount;                                  //! the number of scanning threads
+    };
+}
+
+#endif //NEDRYSOFT_PAYLOADSCANNER_H
@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PayloadStager.h"
+
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <thread>
+#include <unistd.h>
+
+#if defined(Q_OS_MACOS)
+#include <copyfile.h>
+#include <sys/clonefile.h>
+#elif defined(Q_OS_LINUX)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+constexpr size_t copyBufferSize = 1024*1024;                //! buffer size for the read/write fallback
+constexpr size_t kernelCopyChunkSize = 64*1024*1024;        //! maximum bytes per copy_file_range/sendfile call
+constexpr auto cancelledError = "staging was cancelled";
+
+#if defined(Q_OS_MACOS)
+#define MODIFIED_TIME(fileStat) (fileStat).st_mtimespec
+#else
+#define MODIFIED_TIME(fileStat) (fileStat).st_mtim
+#endif
+
+static std::string systemError(const std::string &operation, const std::string &path) {
+    return operation+" "+path+": "+strerror(errno);
+}
+
+static bool isUnsupported(int error) {
+    return (error==ENOTSUP) || (error==EOPNOTSUPP) || (error==EXDEV) || (error==EINVAL) || (error==ENOSYS) || (error==ENOTTY);
+}
+
+Nedrysoft::PayloadStager::PayloadStager(int threadCount) :
+        m_threadCount(threadCount>0 ? threadCount : qMax(1, QThread::idealThreadCount())),
+        m_cloneSupported(true),
+        m_kernelCopySupported(true),
+        m_cancelled(false) {
+
+}
+
+void Nedrysoft::PayloadStager::setCancelled(bool cancelled) {
+    m_cancelled = cancelled;
+}
+
+void Nedrysoft::PayloadStager::setProgressFunction(ProgressFunction progressFunction) {
+    m_progressFunction = progressFunction;
+}
+
+void Nedrysoft::PayloadStager::addProgress(qint64 bytes) {
+    if ((m_progressFunction) && (bytes>0)) {
+        m_progressFunction(bytes);
+    }
+}
+
+bool Nedrysoft::PayloadStager::stage(const QString &source, const QString &destinationFolder, Statistics &statistics, QString *error) {
+    auto startTime = std::chrono::steady_clock::now();
+    auto sourcePath = std::string(QFile::encodeName(source).constData());
+    auto trimmedSource = sourcePath;
+
+    while ((trimmedSource.size()>1) && (trimmedSource.back()=='/')) {
+        trimmedSource.pop_back();
+    }
+
+    auto destination = std::string(QFile::encodeName(destinationFolder).constData())+"/"+trimmedSource.substr(trimmedSource.find_last_of('/')+1);
+    std::vector<FileCopy> files;
+    std::vector<FolderTime> folders;
+    std::string stageError;
+
+    if (!walk(trimmedSource, destination, files, folders, statistics, stageError)) {
+        if (error) {
+            *error = QString::fromStdString(stageError);
+        }
+
+        return false;
+    }
+
+    // the largest files are started first so that one large file does not end up being copied on its own at the end
+
+    std::sort(files.begin(), files.end(), [](const FileCopy &first, const FileCopy &second) {
+        return first.size>second.size;
+    });
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<qint64> copiedBytes(0), clonedFiles(0);
+    std::atomic<bool> failed(false);
+    std::mutex errorMutex;
+    std::vector<std::thread> threads;
+
+    auto copyWorker = [&]() {
+        std::string copyError;
+
+        while ((!failed) && (!m_cancelled)) {
+            auto fileIndex = nextFile++;
+            auto isCloned = false;
+
+            if (fileIndex>=files.size()) {
+                break;
+            }
+
+            if (!copyFile(files[fileIndex], isCloned, copyError)) {
+                std::lock_guard<std::mutex> errorLock(errorMutex);
+
+                if (!failed.exchange(true)) {
+                    stageError = copyError;
+                }
+
+                break;
+            }
+
+            copiedBytes += files[fileIndex].size;
+
+            if (isCloned) {
+                clonedFiles++;
+
+                addProgress(files[fileIndex].size);
+            }
+        }
+    };
+
+    auto threadCount = std::min(static_cast<size_t>(m_threadCount), files.size());
+
+    for (size_t threadIndex = 1; threadIndex<threadCount; threadIndex++) {
+        threads.emplace_back(copyWorker);
+    }
+
+    copyWorker();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (m_cancelled) {
+        stageError = cancelledError;
+    }
+
+    if ((failed) || (m_cancelled)) {
+        if (error) {
+            *error = QString::fromStdString(stageError);
+        }
+
+        return false;
+    }
+
+    // folders were created writable so that they could be filled, their permissions and times are set last, deepest
+    // first, as creating entries inside a folder updates its time and a read only parent would stop the change.
+
+    for (auto folder = folders.rbegin(); folder!=folders.rend(); ++folder) {
+        struct timespec times[2] = {folder->modified, folder->modified};
+
+        utimensat(AT_FDCWD, folder->destination.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        chmod(folder->destination.c_str(), folder->mode);
+    }
+
+    statistics.bytes += copiedBytes;
+    statistics.files += static_cast<qint64>(files.size());
+    statistics.clonedFiles += clonedFiles;
+    statistics.duration += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-startTime).count();
+
+    return true;
+}
+
+bool Nedrysoft::PayloadStager::walk(const std::string &source, const std::string &destination, std::vector<FileCopy> &files, std::vector<FolderTime> &folders, Statistics &statistics, std::string &error) {
+    struct stat sourceStat;
+
+    if (m_cancelled) {
+        error = cancelledError;
+
+        return false;
+    }
+
+    if (lstat(source.c_str(), &sourceStat)!=0) {
+        error = systemError("stat", source);
+
+        return false;
+    }
+
+    if (S_ISLNK(sourceStat.st_mode)) {
+        std::vector<char> target(static_cast<size_t>(sourceStat.st_size>0 ? sourceStat.st_size : PATH_MAX)+1);
+        auto targetLength = readlink(source.c_str(), target.data(), target.size()-1);
+
+        if (targetLength<0) {
+            error = systemError("readlink", source);
+
+            return false;
+        }
+
+        target[static_cast<size_t>(targetLength)] = 0;
+
+        if (symlink(target.data(), destination.c_str())!=0) {
+            error = systemError("symlink", destination);
+
+            return false;
+        }
+
+        struct timespec times[2] = {MODIFIED_TIME(sourceStat), MODIFIED_TIME(sourceStat)};
+
+        utimensat(AT_FDCWD, destination.c_str(), times, AT_SYMLINK_NOFOLLOW);
+
+        copyAttributes(source, destination);
+
+        statistics.symlinks++;
+
+        return true;
+    }
+
+    if (S_ISREG(sourceStat.st_mode)) {
+        files.push_back(FileCopy{source, destination, sourceStat.st_size, static_cast<mode_t>(sourceStat.st_mode & 07777), MODIFIED_TIME(sourceStat)});
+
+        return true;
+    }
+
+    if (!S_ISDIR(sourceStat.st_mode)) {
+        // sockets, devices and pipes have no place in a disk image
+
+        return true;
+    }
+
+    if ((mkdir(destination.c_str(), S_IRWXU)!=0) && (errno!=EEXIST)) {
+        error = systemError("mkdir", destination);
+
+        return false;
+    }
+
+    copyAttributes(source, destination);
+
+    folders.push_back(FolderTime{destination, static_cast<mode_t>(sourceStat.st_mode & 07777), MODIFIED_TIME(sourceStat)});
+
+    statistics.directories++;
+
+    auto dir = opendir(source.c_str());
+
+    if (!dir) {
+        error = systemError("opendir", source);
+
+        return false;
+    }
+
+    std::vector<std::string> names;
+
+    while (auto entry = readdir(dir)) {
+        if ((strcmp(entry->d_name, ".")!=0) && (strcmp(entry->d_name, "..")!=0)) {
+            names.emplace_back(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+
+    for (auto const &name : names) {
+        if (!walk(source+"/"+name, destination+"/"+name, files, folders, statistics, error)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Nedrysoft::PayloadStager::copyFile(const FileCopy &file, bool &isCloned, std::string &error) {
+    isCloned = false;
+
+#if defined(Q_OS_MACOS)
+    if (m_cloneSupported) {
+        if (clonefile(file.source.c_str(), file.destination.c_str(), CLONE_NOFOLLOW)==0) {
+            isCloned = true;
+
+            return true;
+        }
+
+        if (isUnsupported(errno)) {
+            m_cloneSupported = false;
+        }
+    }
+#endif
+
+    auto sourceFd = open(file.source.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (sourceFd<0) {
+        error = systemError("open", file.source);
+
+        return false;
+    }
+
+    auto destinationFd = open(file.destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+    if (destinationFd<0) {
+        error = systemError("create", file.destination);
+
+        close(sourceFd);
+
+        return false;
+    }
+
+    auto isCopied = false;
+    auto isAttributesCopied = false;
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    if (m_cloneSupported) {
+        if (ioctl(destinationFd, FICLONE, sourceFd)==0) {
+            isCopied = true;
+            isCloned = true;
+        } else if (isUnsupported(errno)) {
+            m_cloneSupported = false;
+        }
+    }
+#endif
+
+    if ((!isCopied) && (!copyData(sourceFd, destinationFd, file.size, isAttributesCopied))) {
+        error = systemError("copy", file.destination);
+
+        close(sourceFd);
+        close(destinationFd);
+
+        return false;
+    }
+
+    // attributes are copied before the permissions are applied, a read only file cannot be given attributes
+
+    if (!isAttributesCopied) {
+        copyAttributes(file.source, file.destination);
+    }
+
+    struct timespec times[2] = {file.modified, file.modified};
+
+    fchmod(destinationFd, file.mode);
+    futimens(destinationFd, times);
+
+    close(sourceFd);
+    close(destinationFd);
+
+    return true;
+}
+
+bool Nedrysoft::PayloadStager::copyData(int sourceFd, int destinationFd, off_t size, bool &isAttributesCopied) {
+    isAttributesCopied = false;
+
+#if defined(Q_OS_MACOS)
+    // fcopyfile copies the data and the extended attributes (including resource forks) in the kernel
+
+    if (m_kernelCopySupported) {
+        if (fcopyfile(sourceFd, destinationFd, nullptr, COPYFILE_DATA | COPYFILE_XATTR)==0) {
+            isAttributesCopied = true;
+
+            addProgress(size);
+
+            return true;
+        }
+
+        if (!isUnsupported(errno)) {
+            return false;
+        }
+
+        m_kernelCopySupported = false;
+    }
+#elif defined(Q_OS_LINUX)
+    if (m_kernelCopySupported) {
+        off_t remaining = size;
+
+        while ((remaining>0) && (!m_cancelled)) {
+            auto copied = copy_file_range(sourceFd, nullptr, destinationFd, nullptr, std::min(static_cast<size_t>(remaining), kernelCopyChunkSize), 0);
+
+            if (copied<0) {
+                if (errno==EINTR) {
+                    continue;
+                }
+
+                break;
+            }
+
+            if (copied==0) {
+                break;
+            }
+
+            remaining -= copied;
+
+            addProgress(copied);
+        }
+
+        // copy_file_range is not supported between all filesystems, sendfile works with any pair
+
+        while ((remaining>0) && (!m_cancelled)) {
+            auto copied = sendfile(destinationFd, sourceFd, nullptr, std::min(static_cast<size_t>(remaining), kernelCopyChunkSize));
+
+            if (copied<0) {
+                if (errno==EINTR) {
+                    continue;
+                }
+
+                if (!isUnsupported(errno)) {
+                    return false;
+                }
+
+                m_kernelCopySupported = false;
+
+                break;
+            }
+
+            if (copied==0) {
+                // the file was truncated while it was being copied
+
+                return true;
+            }
+
+            remaining -= copied;
+
+            addProgress(copied);
+        }
+
+        if (remaining==0) {
+            return true;
+        }
+
+        // continue from the current offsets with the read/write loop
+    }
+#endif
+
+    std::vector<char> buffer(copyBufferSize);
+
+    while (!m_cancelled) {
+        auto bytesRead = read(sourceFd, buffer.data(), buffer.size());
+
+        if (bytesRead<0) {
+            if (errno==EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        if (bytesRead==0) {
+            return true;
+        }
+
+        auto bytesWritten = 0;
+
+        while (bytesWritten<bytesRead) {
+            auto written = write(destinationFd, buffer.data()+bytesWritten, static_cast<size_t>(bytesRead-bytesWritten));
+
+            if (written<0) {
+                if (errno==EINTR) {
+                    continue;
+                }
+
+                return false;
+            }
+
+            bytesWritten += static_cast<int>(written);
+        }
+
+        addProgress(bytesRead);
+    }
+
+    errno = ECANCELED;
+
+    return false;
+}
+
+bool Nedrysoft::PayloadStager::copyAttributes(const std::string &source, const std::string &destination) {
+#if defined(Q_OS_MACOS)
+    auto listLength = listxattr(source.c_str(), nullptr, 0, XATTR_NOFOLLOW);
+#else
+    auto listLength = llistxattr(source.c_str(), nullptr, 0);
+#endif
+
+    if (listLength<=0) {
+        return listLength==0;
+    }
+
+    std::vector<char> names(static_cast<size_t>(listLength));
+
+#if defined(Q_OS_MACOS)
+    listLength = listxattr(source.c_str(), names.data(), names.size(), XATTR_NOFOLLOW);
+#else
+    listLength = llistxattr(source.c_str(), names.data(), names.size());
+#endif
+
+    if (listLength<0) {
+        return false;
+    }
+
+    auto isCopied = true;
+
+    for (ssize_t nameOffset = 0; nameOffset<listLength; nameOffset += static_cast<ssize_t>(strlen(names.data()+nameOffset))+1) {
+        auto name = names.data()+nameOffset;
+
+#if defined(Q_OS_MACOS)
+        auto valueLength = getxattr(source.c_str(), name, nullptr, 0, 0, XATTR_NOFOLLOW);
+#else
+        auto valueLength = lgetxattr(source.c_str(), name, nullptr, 0);
+#endif
+
+        if (valueLength<0) {
+            isCopied = false;
+
+            continue;
+        }
+
+        std::vector<char> value(static_cast<size_t>(valueLength)+1);
+
+#if defined(Q_OS_MACOS)
+        valueLength = getxattr(source.c_str(), name, value.data(), value.size(), 0, XATTR_NOFOLLOW);
+
+        if ((valueLength<0) || (setxattr(destination.c_str(), name, value.data(), static_cast<size_t>(valueLength), 0, XATTR_NOFOLLOW)!=0)) {
+            isCopied = false;
+        }
+#else
+        valueLength = lgetxattr(source.c_str(), name, value.data(), value.size());
+
+        if ((valueLength<0) || (lsetxattr(destination.c_str(), name, value.data(), static_cast<size_t>(valueLength), 0)!=0)) {
+            isCopied = false;
+        }
+#endif
+    }
+
+    return isCopied;
+}
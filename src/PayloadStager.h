@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_PAYLOADSTAGER_H
+#define NEDRYSOFT_PAYLOADSTAGER_H
+
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The PayloadStager class copies payload files and folders into the mounted image.
+     *
+     * @details     The source tree is walked once to create the folders and symlinks and to collect the regular
+     *              files, the files are then copied by a pool of threads with the largest files first.  Each file is
+     *              cloned if the filesystem supports it, otherwise the data is copied in the kernel
+     *              (copy_file_range or sendfile on Linux, fcopyfile on macOS) with a read/write loop as the last
+     *              resort.  Permissions, modification times, extended attributes and symlinks are preserved.
+     *
+     * @note        The stager does not use Qt file classes, it is called from the build thread while the GIL is
+     *              released.
+     */
+    class PayloadStager {
+        public:
+            /**
+             * @brief       Holds the totals for a staging run.
+             */
+            struct Statistics {
+                qint64 bytes = 0;                               //! number of bytes of file data staged
+                qint64 files = 0;                               //! number of regular files staged
+                qint64 directories = 0;                         //! number of folders created
+                qint64 symlinks = 0;                            //! number of symlinks created
+                qint64 clonedFiles = 0;                         //! number of files that were cloned rather than copied
+                qint64 duration = 0;                            //! the time taken in nanoseconds
+            };
+
+        public:
+            /**
+             * @brief       Function called as file data is staged.
+             *
+             * @note        Called from the copy threads, so it must be thread safe.
+             *
+             * @param[in]   bytes the number of bytes staged since the previous call.
+             */
+            using ProgressFunction = std::function<void(qint64 bytes)>;
+
+        public:
+            /**
+             * @brief       Constructs a new PayloadStager instance.
+             *
+             * @param[in]   threadCount the number of copy threads, 0 uses the number of processor cores.
+             */
+            explicit PayloadStager(int threadCount = 0);
+
+            /**
+             * @brief       Stages a file, folder or symlink into a destination folder.
+             *
+             * @param[in]   source the absolute path of the payload entry.
+             * @param[in]   destinationFolder the folder that the entry is created in.
+             * @param[out]  statistics the totals are added to this.
+             * @param[out]  error if not null, receives a description of the failure.
+             *
+             * @returns     true if the entry was staged; otherwise false.
+             */
+            bool stage(const QString &source, const QString &destinationFolder, Statistics &statistics, QString *error = nullptr);
+
+            /**
+             * @brief       Sets whether staging is cancelled.
+             *
+             * @details     A cancelled stager stops copying at the next chunk of data and any staging that is in
+             *              progress (or is started later) fails until the stager is reset by passing false.
+             *
+             * @note        May be called from any thread.
+             *
+             * @param[in]   cancelled true to cancel; false to allow staging.
+             */
+            void setCancelled(bool cancelled);
+
+            /**
+             * @brief       Sets the function that is called as file data is staged.
+             *
+             * @details     The function is called after each file that is cloned or copied in a single call and after
+             *              each chunk of a file that is copied in parts, so that the progress of large files is seen.
+             *
+             * @note        Must not be called while staging is in progress.
+             *
+             * @param[in]   progressFunction the function; or nullptr to stop reporting progress.
+             */
+            void setProgressFunction(ProgressFunction progressFunction);
+
+        private:
+            /**
+             * @brief       Holds a regular file that is waiting to be copied.
+             */
+            struct FileCopy {
+                std::string source;                             //! the source path
+                std::string destination;                        //! the destination path
+                off_t size;                                     //! the size of the file in bytes
+                mode_t mode;                                    //! the permissions of the file
+                struct timespec modified;                       //! the modification time of the file
+            };
+
+            /**
+             * @brief       Holds a folder whose permissions and modification time are set once its contents have been
+             *              staged.
+             */
+            struct FolderTime {
+                std::string destination;                        //! the destination path
+                mode_t mode;                                    //! the permissions of the source folder
+                struct timespec modified;                       //! the modification time of the source folder
+            };
+
+            /**
+             * @brief       Walks a source tree, creating folders and symlinks and collecting the regular files.
+             *
+             * @param[in]   source the source path.
+             * @param[in]   destination the destination path.
+             * @param[out]  files the regular files to copy.
+             * @param[out]  folders the folders whose permissions and times must be set.
+             * @param[out]  statistics the totals are added to this.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true on success; otherwise false.
+             */
+            bool walk(const std::string &source, const std::string &destination, std::vector<FileCopy> &files, std::vector<FolderTime> &folders, Statistics &statistics, std::string &error);
+
+            /**
+             * @brief       Copies a single regular file.
+             *
+             * @param[in]   file the file to copy.
+             * @param[out]  isCloned set to true if the file was cloned.
+             * @param[out]  error receives a description of the failure.
+             *
+             * @returns     true on success; otherwise false.
+             */
+            bool copyFile(const FileCopy &file, bool &isCloned, std::string &error);
+
+            /**
+             * @brief       Copies the data of a file between two open descriptors without cloning.
+             *
+             * @param[in]   sourceFd the source file.
+             * @param[in]   destinationFd the destination file.
+             * @param[in]   size the number of bytes to copy.
+             * @param[out]  isAttributesCopied set to true if the extended attributes were copied with the data.
+             *
+             * @returns     true on success; otherwise false with errno set.
+             */
+            bool copyData(int sourceFd, int destinationFd, off_t size, bool &isAttributesCopied);
+
+            /**
+             * @brief       Reports staged bytes to the progress function, if one is set.
+             *
+             * @param[in]   bytes the number of bytes staged.
+             */
+            void addProgress(qint64 bytes);
+
+            /**
+             * @brief       Copies the extended attributes of a file, folder or symlink.
+             *
+             * @param[in]   source the source path.
+             * @param[in]   destination the destination path.
+             *
+             * @returns     true on success; otherwise false.
+             */
+            static bool copyAttributes(const std::string &source, const std::string &destination);
+
+        private:
+            int m_threadCount;                                  //! the number of copy threads
+            std::atomic<bool> m_cloneSupported;                 //! cleared when the destination cannot clone
+            std::atomic<bool> m_kernelCopySupported;            //! cleared when in kernel copies are not possible
+            std::atomic<bool> m_cancelled;                      //! set when staging has been cancelled
+            ProgressFunction m_progressFunction;                //! called as file data is staged
+    };
+}
+
+#endif //NEDRYSOFT_PAYLOADSTAGER_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PreflightCheck.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+constexpr auto imageHeaderSize = 32;                        //! bytes read from an image to identify it
+constexpr auto bytesPerMegabyte = 1024.0*1024.0;
+constexpr auto nanosecondsPerMillisecond = 1000000.0;
+
+/**
+ * @brief       The names that dmgbuild uses for its own files in the root of the image.
+ */
+constexpr const char *reservedNames[] = {
+    ".background",
+    ".DS_Store",
+    ".VolumeIcon.icns",
+};
+
+/**
+ * @brief       An entry of the configuration that is checked by the pool of threads.
+ */
+struct PreflightEntry {
+    /**
+     * @brief       What the entry is used for, this decides which checks are made.
+     */
+    enum Kind {
+        File,                                               /**< A file or folder copied into the image. */
+        SymlinkTarget,                                      /**< The target of a symlink in the image. */
+        Background,                                         /**< The background image. */
+        Icon                                                /**< The volume icon. */
+    };
+
+    Kind kind;                                              //! what the entry is used for
+    QString path;                                           //! the absolute path of the entry
+};
+
+using Problem = Nedrysoft::PreflightCheck::Problem;
+
+static QString errorText(int error) {
+    return QString::fromLocal8Bit(strerror(error)).toLower();
+}
+
+static quint32 bigEndian32(const unsigned char *data) {
+    return (static_cast<quint32>(data[0])<<24) | (static_cast<quint32>(data[1])<<16) | (static_cast<quint32>(data[2])<<8) | static_cast<quint32>(data[3]);
+}
+
+static bool startsWith(const unsigned char *header, ssize_t length, const char *signature, ssize_t signatureLength) {
+    return (length>=signatureLength) && (memcmp(header, signature, static_cast<size_t>(signatureLength))==0);
+}
+
+/**
+ * @brief       Checks the header of an image, the formats are the ones that the editor and dmgbuild can load.
+ */
+static void checkImageHeader(const PreflightEntry &entry, const unsigned char *header, ssize_t length, const struct stat &entryStat, QVector<Problem> &problems) {
+    auto isIcns = startsWith(header, length, "icns", 4);
+
+    if (isIcns) {
+        if ((length<8) || (bigEndian32(header+4)!=static_cast<quint32>(entryStat.st_size))) {
+            problems.append(Problem{Problem::Error, entry.path, "is not a complete ICNS file"});
+        }
+
+        return;
+    }
+
+    if (entry.kind==PreflightEntry::Icon) {
+        problems.append(Problem{Problem::Warning, entry.path, "is not an ICNS file, Finder will not show it as the volume icon"});
+
+        return;
+    }
+
+    if (startsWith(header, length, "\x89PNG\r\n\x1a\n", 8)) {
+        if ((length<24) || (memcmp(header+12, "IHDR", 4)!=0) || (bigEndian32(header+16)==0) || (bigEndian32(header+20)==0)) {
+            problems.append(Problem{Problem::Error, entry.path, "has an invalid PNG header"});
+        }
+
+        return;
+    }
+
+    if ((startsWith(header, length, "\xff\xd8\xff", 3)) ||
+        (startsWith(header, length, "GIF87a", 6)) ||
+        (startsWith(header, length, "GIF89a", 6)) ||
+        (startsWith(header, length, "II*\0", 4)) ||
+        (startsWith(header, length, "MM\0*", 4)) ||
+        (startsWith(header, length, "BM", 2)) ||
+        (startsWith(header, length, "%PDF", 4))) {
+
+        return;
+    }
+
+    problems.append(Problem{Problem::Error, entry.path, "is not a PNG, JPEG, TIFF, GIF, BMP, PDF or ICNS image"});
+}
+
+static void checkEntry(const PreflightEntry &entry, QVector<Problem> &problems) {
+    auto path = std::string(QFile::encodeName(entry.path).constData());
+    struct stat entryStat;
+
+    if (entry.kind==PreflightEntry::SymlinkTarget) {
+        // the link is resolved on the machine that mounts the image, so a missing target does not stop the build
+
+        if (stat(path.c_str(), &entryStat)!=0) {
+            problems.append(Problem{Problem::Warning, entry.path, "is the target of a symlink but does not exist"});
+        }
+
+        return;
+    }
+
+    // payload symlinks are copied as symlinks, they are not followed
+
+    auto statResult = (entry.kind==PreflightEntry::File) ? lstat(path.c_str(), &entryStat) : stat(path.c_str(), &entryStat);
+
+    if (statResult!=0) {
+        problems.append(Problem{Problem::Error, entry.path, errno==ENOENT ? QString("does not exist") : errorText(errno)});
+
+        return;
+    }
+
+    if (S_ISLNK(entryStat.st_mode)) {
+        struct stat targetStat;
+
+        if (stat(path.c_str(), &targetStat)!=0) {
+            problems.append(Problem{Problem::Warning, entry.path, "is a symlink to a file that does not exist"});
+        }
+
+        return;
+    }
+
+    if (S_ISDIR(entryStat.st_mode)) {
+        if (entry.kind!=PreflightEntry::File) {
+            problems.append(Problem{Problem::Error, entry.path, "is a folder"});
+        } else if (access(path.c_str(), R_OK | X_OK)!=0) {
+            problems.append(Problem{Problem::Error, entry.path, QString("cannot be read (%1)").arg(errorText(errno))});
+        }
+
+        return;
+    }
+
+    if (!S_ISREG(entryStat.st_mode)) {
+        problems.append(Problem{Problem::Error, entry.path, "is not a file or folder"});
+
+        return;
+    }
+
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd<0) {
+        problems.append(Problem{Problem::Error, entry.path, QString("cannot be read (%1)").arg(errorText(errno))});
+
+        return;
+    }
+
+    if (entry.kind!=PreflightEntry::File) {
+        unsigned char header[imageHeaderSize];
+        auto length = read(fd, header, sizeof(header));
+
+        if (length<0) {
+            problems.append(Problem{Problem::Error, entry.path, QString("cannot be read (%1)").arg(errorText(errno))});
+        } else if (length==0) {
+            problems.append(Problem{Problem::Error, entry.path, "is empty"});
+        } else {
+            checkImageHeader(entry, header, length, entryStat, problems);
+        }
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief       Checks the names of the icons in the window, each name becomes an entry in the root of the image.
+ */
+static void checkNames(const Nedrysoft::BuildConfiguration &configuration, QVector<Problem> &problems) {
+    QMap<QString, QString> names;
+
+    auto addName = [&](const QString &name, const QString &source) {
+        if (name.isEmpty()) {
+            problems.append(Problem{Problem::Error, source, "has an empty name"});
+
+            return;
+        }
+
+        if (name.contains('/')) {
+            problems.append(Problem{Problem::Error, name, "is not a valid name as it contains a /"});
+
+            return;
+        }
+
+        for (auto reservedName : reservedNames) {
+            if (name.compare(reservedName, Qt::CaseInsensitive)==0) {
+                problems.append(Problem{Problem::Error, source, QString("uses the name %1 which is reserved for the image layout").arg(name)});
+
+                return;
+            }
+        }
+
+        auto key = name.toCaseFolded();
+
+        if (names.contains(key)) {
+            problems.append(Problem{Problem::Error, name, QString("is used by both %1 and %2").arg(names.value(key)).arg(source)});
+        } else {
+            names[key] = source;
+        }
+    };
+
+    for (auto const &file : configuration.files) {
+        addName(QFileInfo(file.path).fileName(), file.path);
+    }
+
+    for (auto const &symlink : configuration.symlinks) {
+        addName(symlink.name, QString("symlink %1").arg(symlink.name));
+    }
+}
+
+/**
+ * @brief       Checks that the image can be written to the output folder.
+ */
+static void checkOutput(const QString &outputFilename, qint64 imageSize, QVector<Problem> &problems) {
+    if (outputFilename.isEmpty()) {
+        problems.append(Problem{Problem::Error, "output", "no output filename is set"});
+
+        return;
+    }
+
+    auto outputFolder = QFileInfo(outputFilename).absolutePath();
+    auto folderPath = std::string(QFile::encodeName(outputFolder).constData());
+    auto outputPath = std::string(QFile::encodeName(outputFilename).constData());
+    struct stat outputStat;
+    struct statvfs folderStat;
+
+    if ((stat(outputPath.c_str(), &outputStat)==0) && (S_ISDIR(outputStat.st_mode))) {
+        problems.append(Problem{Problem::Error, outputFilename, "is a folder"});
+
+        return;
+    }
+
+    if (stat(folderPath.c_str(), &outputStat)!=0) {
+        problems.append(Problem{Problem::Error, outputFolder, errno==ENOENT ? QString("does not exist") : errorText(errno)});
+
+        return;
+    }
+
+    if (access(folderPath.c_str(), W_OK | X_OK)!=0) {
+        problems.append(Problem{Problem::Error, outputFolder, QString("cannot be written to (%1)").arg(errorText(errno))});
+
+        return;
+    }
+
+    if (statvfs(folderPath.c_str(), &folderStat)==0) {
+        auto freeSpace = static_cast<qint64>(folderStat.f_bavail)*static_cast<qint64>(folderStat.f_frsize);
+
+        if (freeSpace<imageSize) {
+            problems.append(Problem{Problem::Error, outputFolder, QString("has %1 MB free but the image needs %2 MB")
+                    .arg(freeSpace/bytesPerMegabyte, 0, 'f', 1)
+                    .arg(imageSize/bytesPerMegabyte, 0, 'f', 1)});
+        }
+    }
+}
+
+bool Nedrysoft::PreflightCheck::Result::hasErrors() const {
+    return std::any_of(problems.begin(), problems.end(), [](const Problem &problem) {
+        return problem.severity==Problem::Error;
+    });
+}
+
+QStringList Nedrysoft::PreflightCheck::Result::lines() const {
+    QStringList lines;
+    auto errors = std::count_if(problems.begin(), problems.end(), [](const Problem &problem) {
+        return problem.severity==Problem::Error;
+    });
+
+    for (auto const &problem : problems) {
+        lines.append(QString("preflight: %1, %2 %3.")
+                .arg(problem.severity==Problem::Error ? "error" : "warning")
+                .arg(problem.path)
+                .arg(problem.message));
+    }
+
+    lines.append(QString("preflight: %1 errors, %2 warnings, %3 MB image (checked in %4 ms).")
+            .arg(errors)
+            .arg(problems.count()-errors)
+            .arg(imageSize/bytesPerMegabyte, 0, 'f', 1)
+            .arg(duration/nanosecondsPerMillisecond, 0, 'f', 2));
+
+    return lines;
+}
+
+Nedrysoft::PreflightCheck::PreflightCheck(int threadCount) :
+        m_threadCount(threadCount>0 ? threadCount : qMax(1, QThread::idealThreadCount())) {
+
+}
+
+Nedrysoft::PreflightCheck::Result Nedrysoft::PreflightCheck::check(const BuildConfiguration &configuration) const {
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<PreflightEntry> entries;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextEntry(0);
+    QStringList contents;
+    Result result;
+
+    for (auto const &file : configuration.files) {
+        entries.push_back(PreflightEntry{PreflightEntry::File, file.path});
+        contents.append(file.path);
+    }
+
+    for (auto const &symlink : configuration.symlinks) {
+        if (symlink.target.isEmpty()) {
+            result.problems.append(Problem{Problem::Error, QString("symlink %1").arg(symlink.name), "has no target"});
+        } else {
+            entries.push_back(PreflightEntry{PreflightEntry::SymlinkTarget, symlink.target});
+        }
+    }
+
+    if (configuration.background.isEmpty()) {
+        result.problems.append(Problem{Problem::Error, "background", "no background image is set"});
+    } else {
+        entries.push_back(PreflightEntry{PreflightEntry::Background, configuration.background});
+        contents.append(configuration.background);
+    }
+
+    if (!configuration.icon.isEmpty()) {
+        entries.push_back(PreflightEntry{PreflightEntry::Icon, configuration.icon});
+        contents.append(configuration.icon);
+    }
+
+    // each entry writes to its own list so the threads only share the index of the next entry
+
+    std::vector<QVector<Problem> > entryProblems(entries.size());
+
+    auto checkWorker = [&]() {
+        for (auto entryIndex = nextEntry++; entryIndex<entries.size(); entryIndex = nextEntry++) {
+            checkEntry(entries[entryIndex], entryProblems[entryIndex]);
+        }
+    };
+
+    auto threadCount = std::min(static_cast<size_t>(m_threadCount), entries.size());
+
+    for (size_t threadIndex = 0; threadIndex<threadCount; threadIndex++) {
+        threads.emplace_back(checkWorker);
+    }
+
+    // the payload is scanned while the entries are checked, entries that do not exist are ignored by the scan
+
+    result.payload = PayloadScanner(m_threadCount).scan(contents);
+    result.payload.symlinks += configuration.symlinks.count();
+    result.imageSize = PayloadScanner::imageSize(result.payload);
+
+    checkNames(configuration, result.problems);
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto const &problems : entryProblems) {
+        result.problems.append(problems);
+    }
+
+    checkOutput(configuration.outputFilename, result.imageSize, result.problems);
+
+    std::stable_sort(result.problems.begin(), result.problems.end(), [](const Problem &first, const Problem &second) {
+        return (first.severity==Problem::Error) && (second.severity!=Problem::Error);
+    });
+
+    result.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-startTime).count();
+
+    return result;
+}
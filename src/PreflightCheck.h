@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_PREFLIGHTCHECK_H
+#define NEDRYSOFT_PREFLIGHTCHECK_H
+
+#include "BuildConfiguration.h"
+#include "PayloadScanner.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The PreflightCheck class validates a configuration before a build is started.
+     *
+     * @details     Every file, symlink target, the background and the volume icon are checked by a pool of threads
+     *              for existence and readability, images have their header read to make sure that they are a
+     *              format that can be used.  While the entries are being checked the payload is scanned to find the
+     *              size of the image, which is compared with the space free on the output volume.  The names of
+     *              the icons in the window are compared for collisions, the image filesystem is not case sensitive
+     *              so names that only differ by case collide.
+     *
+     *              A check only reads file metadata and the first few bytes of the images, so a build that would
+     *              fail is stopped before the image is created.
+     *
+     * @note        The check does not hold any state and can be used from any thread.
+     */
+    class PreflightCheck {
+        public:
+            /**
+             * @brief       Holds a problem found by the check.
+             */
+            struct Problem {
+                /**
+                 * @brief       How serious a problem is.
+                 */
+                enum Severity {
+                    Warning,                                    /**< The build can continue. */
+                    Error                                       /**< The build would fail. */
+                };
+
+                Severity severity;                              //! how serious the problem is
+                QString path;                                   //! the file or name the problem refers to
+                QString message;                                //! a description of the problem
+            };
+
+            /**
+             * @brief       Holds the result of a check.
+             */
+            struct Result {
+                QVector<Problem> problems;                      //! the problems that were found, errors first
+                PayloadScanner::Totals payload;                 //! the totals of the payload scan
+                qint64 imageSize = 0;                           //! the size of image needed for the payload
+                qint64 duration = 0;                            //! the time taken by the check in nanoseconds
+
+                /**
+                 * @brief       Returns whether the check found a problem that would fail the build.
+                 *
+                 * @returns     true if there are errors; otherwise false.
+                 */
+                bool hasErrors() const;
+
+                /**
+                 * @brief       Returns the problems as lines of text.
+                 *
+                 * @returns     one line for each problem.
+                 */
+                QStringList lines() const;
+            };
+
+        public:
+            /**
+             * @brief       Constructs a new PreflightCheck instance.
+             *
+             * @param[in]   threadCount the number of checking threads, 0 uses the number of processor cores.
+             */
+            explicit PreflightCheck(int threadCount = 0);
+
+            /**
+             * @brief       Checks a configuration.
+             *
+             * @param[in]   configuration the configuration, the paths must be absolute.
+             *
+             * @returns     the result of the check.
+             */
+            Result check(const BuildConfiguration &configuration) const;
+
+        private:
+            int m_threadCount;                                  //! the number of checking threads
+    };
+}
+
+#endif //NEDRYSOFT_PREFLIGHTCHECK_H
@@ -43,7 +43,8 @@
 Nedrysoft::PreviewWidget::PreviewWidget(QWidget *parent) :
         QWidget(parent),
         m_iconPosition(),
-        m_builder(nullptr) {
+        m_builder(nullptr),
+        m_nextIconId(0) {
 
     m_targetPixmap = QPixmap(":/icons/target.png");
 
@@ -64,31 +65,35 @@ Nedrysoft::PreviewWidget::PreviewWidget(QWidget *parent) :
 void Nedrysoft::PreviewWidget::setBuilder(Nedrysoft::Builder *builder) {
     m_builder = builder;
 
-    connect(builder, &Nedrysoft::Builder::iconSizeChanged, [=](int iconSize) {
-        setIconSize(iconSize);
-    });
+    m_snapshot = builder->snapshot();
 
-    connect(builder, &Nedrysoft::Builder::iconVisibilityChanged, [=](bool isVisible) {
-        setIconsVisible(isVisible);
-    });
+    m_snapEngine.setGridSize(m_snapshot.gridSize);
 
-    connect(builder, &Nedrysoft::Builder::textSizeChanged, [=](bool textSize) {
-        setTextSize(textSize);
-    });
+    connect(builder, &Nedrysoft::Builder::snapshotChanged, [=](const Nedrysoft::Builder::Snapshot &snapshot) {
+        auto previousSnapshot = m_snapshot;
 
-    connect(builder, &Nedrysoft::Builder::gridSizeChanged, [=](QSize gridSize) {
-        if (m_builder->property("gridvisible").toBool()) {
-            setGridSize(gridSize);
-        } else {
-            setGridSize(QSize());
+        m_snapshot = snapshot;
+
+        m_snapEngine.setGridSize(m_snapshot.gridSize);
+
+        if (m_snapshot.iconSize!=previousSnapshot.iconSize) {
+            setIconSize(m_snapshot.iconSize);
         }
-    });
 
-    connect(builder, &Nedrysoft::Builder::gridVisibilityChanged, [=](bool isVisible) {
-        if (m_builder->property("gridvisible").toBool()) {
-            setGridSize(m_builder->property("gridsize").toSize());
-        } else {
-            setGridSize(QSize());
+        if (m_snapshot.iconsVisible!=previousSnapshot.iconsVisible) {
+            setIconsVisible(m_snapshot.iconsVisible);
+        }
+
+        if (m_snapshot.textSize!=previousSnapshot.textSize) {
+            setTextSize(m_snapshot.textSize);
+        }
+
+        if ((m_snapshot.gridSize!=previousSnapshot.gridSize) || (m_snapshot.gridVisible!=previousSnapshot.gridVisible)) {
+            if (m_snapshot.gridVisible) {
+                setGridSize(m_snapshot.gridSize);
+            } else {
+                setGridSize(QSize());
+            }
         }
     });
 
@@ -97,11 +102,12 @@ void Nedrysoft::PreviewWidget::setBuilder(Nedrysoft::Builder *builder) {
 
         for (auto item : m_graphicsScene.items()) {
             if ((item->data(Qt::UserRole).isValid()) && (item->data(Qt::UserRole)==Icon)) {
+                m_snapEngine.removeIcon(item->data(IconIdRole).toInt());
                 m_graphicsScene.removeItem(item);
             }
         }
 
-        auto iconSize = m_builder->property("iconsize").toFloat();
+        auto iconSize = static_cast<float>(m_snapshot.iconSize);
 
         for (auto file : files) {
             auto filename = Nedrysoft::Helper::resolvedPath(file->file);
@@ -117,11 +123,12 @@ void Nedrysoft::PreviewWidget::setBuilder(Nedrysoft::Builder *builder) {
     connect(builder, &Nedrysoft::Builder::symlinksChanged, [=](QList<Nedrysoft::Builder::Symlink *> symlinks) {
         for (auto item : m_graphicsScene.items()) {
             if ((item->data(Qt::UserRole).isValid()) && (item->data(Qt::UserRole)==Shortcut)) {
+                m_snapEngine.removeIcon(item->data(IconIdRole).toInt());
                 m_graphicsScene.removeItem(item);
             }
         }
 
-        auto iconSize = m_builder->property("iconsize").toFloat();
+        auto iconSize = static_cast<float>(m_snapshot.iconSize);
 
         for (auto symlink : symlinks) {
             QTemporaryDir temporaryDir;
@@ -168,6 +175,8 @@ void Nedrysoft::PreviewWidget::setPixmap(QPixmap &pixmap) {
 void Nedrysoft::PreviewWidget::setCentroids(QList<QPointF> &centroids) {
     m_centroids = centroids;
 
+    m_snapEngine.setCentroids(m_centroids);
+
     for (auto item : m_graphicsScene.items()) {
         if ((item->data(Qt::UserRole).isValid()) && (item->data(Qt::UserRole)==Centroid)) {
             m_graphicsScene.removeItem(item);
@@ -194,62 +203,49 @@ void Nedrysoft::PreviewWidget::addIcon(QString text, Nedrysoft::Image *image, co
         pixmap = QPixmap(":/icons/invalid.png");
     }
 
-    auto scale = static_cast<float>(m_builder->property("iconsize").toFloat())/static_cast<float>(pixmap.width());
+    auto scale = static_cast<float>(m_snapshot.iconSize)/static_cast<float>(pixmap.width());
     QPoint textPos(point);
 
     //textPos += QPoint(0, (pixmap.height()*scale)+48);
     //addText(textPos, "App");
 
-    auto snappedIcon = new SnappedGraphicsPixmapItem([pixmap, this, updateFunction](const QPoint &point) {
-        QPoint snapPoint = point;
-        auto iconSize = m_builder->property("iconsize").toFloat();
-        auto scale = static_cast<float>(iconSize)/static_cast<float>(pixmap.width());
-        auto width = static_cast<float>(pixmap.width())*scale;
-        auto height = static_cast<float>(pixmap.height())*scale;
-
-        if (m_builder->property("snaptofeatures").toBool()) {
-            float closestDistance = MAXFLOAT;
-
-            for (auto const centroid : m_centroids) {
-                auto dx = centroid.x()-point.x();
-                auto dy = centroid.y()-point.y();
+    auto iconId = m_nextIconId++;
 
-                float distance = sqrtf(powf(dx, 2) + powf(dy, 2));
+    auto snappedIcon = new SnappedGraphicsPixmapItem([this, iconId, updateFunction](const QPoint &point) {
+        SnapEngine::Targets targets = SnapEngine::None;
 
-                if ((distance<50) && (distance < closestDistance)) {
-                    snapPoint = centroid.toPoint();
-
-                    closestDistance = distance;
-                }
-            }
+        if (m_snapshot.snapToFeatures) {
+            targets |= SnapEngine::Features | SnapEngine::Icons;
         }
 
-        if (m_builder->property("snaptogrid").toBool()) {
-            auto gridSize = m_builder->property("gridsize").toSize();
+        if (m_snapshot.snapToGrid) {
+            targets |= SnapEngine::Grid;
+        }
 
-            auto x = (point.x()/gridSize.width())*gridSize.width();
-            auto y = (point.y()/gridSize.height())*gridSize.height();
+        auto snapPoint = m_snapEngine.snap(iconId, point, targets);
 
-            snapPoint = QPoint(x, y);
-        }
+        m_snapEngine.setIconPosition(iconId, snapPoint);
 
         updateFunction(snapPoint);
 
         return snapPoint;
     });
 
-    float iconSize = m_builder->property("iconsize").toFloat();
+    auto iconSize = static_cast<float>(m_snapshot.iconSize);
 
     snappedIcon->setPixmap(pixmap);
     snappedIcon->setPos(point);
     snappedIcon->setOffset(-(static_cast<float>(pixmap.width())/2.0), -(static_cast<float>(pixmap.height())/2.0));
     snappedIcon->setScale(static_cast<float>(iconSize)/static_cast<float>(pixmap.width()));
     snappedIcon->setData(Qt::UserRole, iconType);
+    snappedIcon->setData(IconIdRole, iconId);
     snappedIcon->setZValue(1);
     snappedIcon->setTransformationMode(Qt::SmoothTransformation);
-    snappedIcon->setVisible(m_builder->property("iconsvisible").toBool());
+    snappedIcon->setVisible(m_snapshot.iconsVisible);
 
     m_graphicsScene.addItem(snappedIcon);
+
+    m_snapEngine.setIconPosition(iconId, point);
 }
 
 void Nedrysoft::PreviewWidget::setIconsVisible(bool isVisible) {
@@ -271,7 +267,7 @@ void Nedrysoft::PreviewWidget::setIconSize(int size) {
         return;
     }
 
-    float iconSize = m_builder->property("iconsize").toFloat();
+    auto iconSize = static_cast<float>(size);
 
     for (auto item : m_graphicsScene.items()) {
         if (item->data(Qt::UserRole).isValid()) {
@@ -292,6 +288,8 @@ void Nedrysoft::PreviewWidget::setIconSize(int size) {
 void Nedrysoft::PreviewWidget::clearCentroids() {
     m_centroids.clear();
 
+    m_snapEngine.setCentroids(m_centroids);
+
     for (auto item : m_graphicsScene.items()) {
         if ((item->data(Qt::UserRole).isValid()) && (item->data(Qt::UserRole)==Centroid)) {
             m_graphicsScene.removeItem(item);
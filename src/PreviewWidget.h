@@ -26,6 +26,7 @@
 
 #include "Builder.h"
 #include "GridGraphicsScene.h"
+#include "SnapEngine.h"
 
 #include <QGraphicsItemGroup>
 #include <QGraphicsScene>
@@ -59,6 +60,8 @@ namespace Nedrysoft {
 
             Q_ENUM(IconType)
 
+            static constexpr auto IconIdRole = Qt::UserRole+1;  //! item data role that holds the snap engine id of an icon
+
         public:
             /**
              * @brief       Constructs a new PreviewWidget instance which is a child of the parent.
@@ -173,6 +176,8 @@ namespace Nedrysoft {
             QPixmap m_pixmap;                           //! the background image pixmap
             QPixmap m_targetPixmap;                     //! target snap location image
             QList<QPointF> m_centroids;                 //! centroid points
+            SnapEngine m_snapEngine;                    //! spatial index of the snap targets
+            int m_nextIconId;                           //! the id to be given to the next icon added
 
             QPointF m_iconPosition;                     //! holds position of icon for drag & drop
 
@@ -183,6 +188,7 @@ namespace Nedrysoft {
             QGridLayout m_layout;                       //! the layout to hold the widgets
 
             Nedrysoft::Builder *m_builder;              //! the builder object that contains the current configuration.
+            Nedrysoft::Builder::Snapshot m_snapshot;    //! the most recent configuration snapshot from the builder
     };
 }
 
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_PYREF_H
+#define NEDRYSOFT_PYREF_H
+
+#include <utility>
+
+#include <Python.h>         //! @note global python include must be included after other includes
+
+namespace Nedrysoft {
+    /**
+     * @brief       The PyRef class owns a reference to a python object.
+     *
+     * @details     The reference is released when the PyRef is destroyed, copying a PyRef adds a reference and
+     *              moving one transfers it.  New references returned by the python API are adopted with the
+     *              constructor, borrowed references are taken with borrowed().
+     *
+     * @note        The GIL must be held whenever a PyRef that holds an object is created, copied or destroyed.
+     */
+    class PyRef {
+        public:
+            /**
+             * @brief       Constructs an empty PyRef.
+             */
+            PyRef() :
+                    m_object(nullptr) {
+
+            }
+
+            /**
+             * @brief       Constructs a PyRef which takes ownership of a new reference.
+             *
+             * @param[in]   object the new reference, may be nullptr.
+             */
+            explicit PyRef(PyObject *object) :
+                    m_object(object) {
+
+            }
+
+            /**
+             * @brief       Constructs a PyRef that holds another reference to the same object.
+             *
+             * @param[in]   other the reference to copy.
+             */
+            PyRef(const PyRef &other) :
+                    m_object(other.m_object) {
+
+                Py_XINCREF(m_object);
+            }
+
+            /**
+             * @brief       Constructs a PyRef that takes the reference from another PyRef.
+             *
+             * @param[in]   other the reference to move, it is left empty.
+             */
+            PyRef(PyRef &&other) noexcept :
+                    m_object(std::exchange(other.m_object, nullptr)) {
+
+            }
+
+            /**
+             * @brief       Destroys the PyRef, releasing the reference.
+             */
+            ~PyRef() {
+                Py_XDECREF(m_object);
+            }
+
+            /**
+             * @brief       Replaces the reference with another reference to an object.
+             *
+             * @param[in]   other the reference to copy.
+             *
+             * @returns     this PyRef.
+             */
+            PyRef &operator=(const PyRef &other) {
+                if (this!=&other) {
+                    Py_XINCREF(other.m_object);
+                    Py_XSETREF(m_object, other.m_object);
+                }
+
+                return *this;
+            }
+
+            /**
+             * @brief       Replaces the reference with the reference held by another PyRef.
+             *
+             * @param[in]   other the reference to move, it is left empty.
+             *
+             * @returns     this PyRef.
+             */
+            PyRef &operator=(PyRef &&other) noexcept {
+                if (this!=&other) {
+                    Py_XSETREF(m_object, std::exchange(other.m_object, nullptr));
+                }
+
+                return *this;
+            }
+
+            /**
+             * @brief       Returns a PyRef that holds a new reference to a borrowed object.
+             *
+             * @param[in]   object the borrowed reference, may be nullptr.
+             *
+             * @returns     the PyRef.
+             */
+            static PyRef borrowed(PyObject *object) {
+                Py_XINCREF(object);
+
+                return PyRef(object);
+            }
+
+            /**
+             * @brief       Returns the object without affecting the reference count.
+             *
+             * @returns     the object; or nullptr if empty.
+             */
+            PyObject *get() const {
+                return m_object;
+            }
+
+            /**
+             * @brief       Gives up ownership of the reference, used when an API steals the reference.
+             *
+             * @returns     the object; or nullptr if empty.
+             */
+            PyObject *release() {
+                return std::exchange(m_object, nullptr);
+            }
+
+            /**
+             * @brief       Returns whether an object is held.
+             *
+             * @returns     true if an object is held; otherwise false.
+             */
+            explicit operator bool() const {
+                return m_object!=nullptr;
+            }
+
+        private:
+            PyObject *m_object;                                 //! the owned reference
+    };
+}
+
+#endif //NEDRYSOFT_PYREF_H
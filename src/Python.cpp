@@ -21,11 +21,21 @@
 
 #include "Python.h"
 
+#include "PyRef.h"
+#include "ScriptProfiler.h"
+
+#include <marshal.h>
+
 #include <QApplication>
 #include <QByteArray>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
 #include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QTextStream>
 #include <filesystem>
 #include <fstream>
@@ -34,15 +44,97 @@
 #include <thread>
 #include <utility>
 
-Nedrysoft::Python::Python() {
-    Py_Initialize();
+QMap<QString, Py_tss_t *> Nedrysoft::Python::m_variables = QMap<QString, Py_tss_t *>();
+std::mutex Nedrysoft::Python::m_interpreterMutex;
+PyThreadState *Nedrysoft::Python::m_mainThreadState = nullptr;
+std::list<std::thread> Nedrysoft::Python::m_warmupThreads;
+std::atomic<int> Nedrysoft::Python::m_runningScripts(0);
+QMap<QByteArray, PyObject *> Nedrysoft::Python::m_codeCache;
+QString Nedrysoft::Python::m_moduleArchive;
+
+constexpr auto codeCacheFolder = "python";
+constexpr auto codeCacheExtension = ".marshal";
+constexpr auto moduleArchivePrefix = "packages-";
+constexpr auto moduleArchiveExtension = ".zip";
+constexpr auto moduleArchiveKeyLength = 16;                  //! the number of hex digits of the content hash in the filename
+
+Nedrysoft::Python::Python() :
+        m_isRunning(false),
+        m_isProfiling(false) {
+
 }
 
 Nedrysoft::Python::~Python() {
+
+}
+
+void Nedrysoft::Python::initialise(const QStringList &preloadModules) {
+    std::lock_guard<std::mutex> lock(m_interpreterMutex);
+
+    if (!Py_IsInitialized()) {
+        Py_Initialize();
+
+        if ((!m_moduleArchive.isEmpty()) && (!installModuleArchive())) {
+            qWarning() << "unable to use the bundled python packages in" << m_moduleArchive;
+        }
+
+        // release the GIL, from here on every thread (including this one) must acquire it with PyGILState_Ensure
+
+        m_mainThreadState = PyEval_SaveThread();
+    }
+
+    if (preloadModules.isEmpty()) {
+        return;
+    }
+
+    m_warmupThreads.emplace_back([preloadModules]() {
+        auto gilState = PyGILState_Ensure();
+
+        importModules(preloadModules);
+
+        PyGILState_Release(gilState);
+    });
+}
+
+void Nedrysoft::Python::shutdown() {
+    std::lock_guard<std::mutex> lock(m_interpreterMutex);
+
+    for (auto &thread : m_warmupThreads) {
+        thread.join();
+    }
+
+    m_warmupThreads.clear();
+
+    if ((!m_mainThreadState) || (m_runningScripts)) {
+        return;
+    }
+
+    PyEval_RestoreThread(m_mainThreadState);
+
+    m_mainThreadState = nullptr;
+
+    // the cached code objects belong to this interpreter, they must not outlive it
+
+    for (auto code : m_codeCache) {
+        Py_DECREF(code);
+    }
+
+    m_codeCache.clear();
+
     Py_Finalize();
 }
 
-QMap<QString, Py_tss_t *> Nedrysoft::Python::m_variables = QMap<QString, Py_tss_t *>();
+void Nedrysoft::Python::importModules(const QStringList &modules) {
+    for (auto const &moduleName : modules) {
+        auto module = PyImport_ImportModule(moduleName.toUtf8().constData());
+
+        if (module) {
+            Py_DECREF(module);
+        } else {
+            PyErr_Print();
+        }
+    }
+}
 
 void Nedrysoft::Python::run(QString &filename) {
     QFile pythonFile(filename);
@@ -51,7 +143,7 @@ void Nedrysoft::Python::run(QString &filename) {
         QByteArray pythonContent = pythonFile.readAll();
 
         if (pythonContent.length()) {
-            runScript(QString::fromUtf8(pythonContent), nullptr);
+            runScript(QString::fromUtf8(pythonContent), nullptr, QFileInfo(filename).absoluteFilePath(), true);
         } else {
             Q_EMIT finished(ScriptInvalid, 0);
         }
@@ -60,42 +152,226 @@ void Nedrysoft::Python::run(QString &filename) {
     }
 }
 
+void Nedrysoft::Python::setModuleArchive(const QString &resourceName) {
+    m_moduleArchive = resourceName;
+}
+
+bool Nedrysoft::Python::installModuleArchive() {
+    QFile resourceFile(m_moduleArchive);
+
+    if (!resourceFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    auto archive = resourceFile.readAll();
+
+    // the archive comment is the last thing in the file, it holds the magic number of the bytecode in the archive
+
+    auto magicNumber = PyImport_GetMagicNumber();
+    QByteArray magic;
+
+    for (auto byteIndex = 0; byteIndex<4; byteIndex++) {
+        magic.append(static_cast<char>((magicNumber >> (byteIndex*8)) & 0xff));
+    }
+
+    if ((magicNumber==-1) || (!archive.endsWith(magic.toHex()))) {
+        PyErr_Clear();
+
+        return false;
+    }
+
+    // zipimport can only read from the file system, so the archive is copied out of the resources once for each
+    // version of the archive.
+
+    auto key = QCryptographicHash::hash(archive, QCryptographicHash::Sha256).toHex().left(moduleArchiveKeyLength);
+    auto cacheFolder = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(codeCacheFolder);
+    auto archiveFilename = QDir(cacheFolder).filePath(QString("%1%2%3").arg(moduleArchivePrefix).arg(QString::fromLatin1(key)).arg(moduleArchiveExtension));
+
+    if (!QFileInfo(archiveFilename).isFile()) {
+        if (!QDir().mkpath(cacheFolder)) {
+            return false;
+        }
+
+        QSaveFile archiveFile(archiveFilename);
+
+        if ((!archiveFile.open(QFile::WriteOnly)) || (archiveFile.write(archive)!=archive.size()) || (!archiveFile.commit())) {
+            return false;
+        }
+    }
+
+    auto systemPath = PySys_GetObject("path");
+    auto archivePath = PyRef(PyUnicode_FromString(archiveFilename.toUtf8().constData()));
+
+    if ((!systemPath) || (!archivePath) || (PyList_Insert(systemPath, 0, archivePath.get())!=0)) {
+        PyErr_Clear();
+
+        return false;
+    }
+
+    return true;
+}
+
 void Nedrysoft::Python::addModulePaths(QStringList modulePaths) {
-    m_modulePaths = std::move(modulePaths);
+    m_modulePaths.clear();
+
+    for (const auto& modulePath : modulePaths) {
+        QDirIterator dirIterator(modulePath);
+
+        while (dirIterator.hasNext()) {
+            QFileInfo fileInfo(dirIterator.next());
+
+            if (fileInfo.fileName().startsWith(".")) {
+                continue;
+            }
+
+            m_modulePaths.append(fileInfo.absoluteFilePath());
+        }
+    }
+}
+
+PyObject *Nedrysoft::Python::compile(const QString &script, const QString &scriptName, bool persistent) {
+    auto source = script.toUtf8();
+    QCryptographicHash keyHash(QCryptographicHash::Sha256);
+
+    // the script name is part of the key as the code object records it as the filename used in tracebacks
+
+    keyHash.addData(scriptName.toUtf8());
+    keyHash.addData(QByteArray(1, '\0'));
+    keyHash.addData(source);
+
+    auto key = keyHash.result().toHex();
+
+    if (m_codeCache.contains(key)) {
+        auto code = m_codeCache[key];
+
+        Py_INCREF(code);
+
+        return code;
+    }
+
+    PyObject *code = nullptr;
+    QString cacheFilename;
+
+    if (persistent) {
+        // the bytecode format is only valid for the python version that created it
+
+        auto cacheFolder = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(codeCacheFolder);
+
+        cacheFilename = QDir(cacheFolder).filePath(QString("%1-%2%3").arg(QString::fromLatin1(key)).arg(PY_VERSION_HEX, 8, 16, QChar('0')).arg(codeCacheExtension));
+
+        QFile cacheFile(cacheFilename);
+
+        if (cacheFile.open(QFile::ReadOnly)) {
+            auto bytecode = cacheFile.readAll();
+
+            code = PyMarshal_ReadObjectFromString(bytecode.constData(), bytecode.size());
+
+            if ((code) && (!PyCode_Check(code))) {
+                Py_CLEAR(code);
+            }
+
+            PyErr_Clear();
+        }
+    }
+
+    if (!code) {
+        code = Py_CompileString(source.constData(), scriptName.toUtf8().constData(), Py_file_input);
+
+        if (!code) {
+            return nullptr;
+        }
+
+        if (persistent) {
+            auto bytecode = PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION);
+
+            if ((bytecode) && (QDir().mkpath(QFileInfo(cacheFilename).absolutePath()))) {
+                QSaveFile cacheFile(cacheFilename);
+
+                if (cacheFile.open(QFile::WriteOnly)) {
+                    cacheFile.write(PyBytes_AS_STRING(bytecode), PyBytes_GET_SIZE(bytecode));
+                    cacheFile.commit();
+                }
+            }
+
+            Py_XDECREF(bytecode);
+
+            PyErr_Clear();
+        }
+    }
+
+    Py_INCREF(code);
+
+    m_codeCache[key] = code;
+
+    return code;
 }
 
-void Nedrysoft::Python::runScript(const QString& script, PyObject *locals) {
-    auto threadState = PyEval_SaveThread();
+QString Nedrysoft::Python::formatException() {
+    PyObject *type, *value, *traceback;
+    QString text;
 
-    auto thread = std::thread([this, script, locals, threadState]() {
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+
+    if (!type) {
+        return text;
+    }
+
+    auto tracebackModule = PyRef(PyImport_ImportModule("traceback"));
+    auto lines = tracebackModule ? PyRef(PyObject_CallMethod(tracebackModule.get(), "format_exception", "OOO", type, value ? value : Py_None, traceback ? traceback : Py_None)) : PyRef();
+    auto separator = PyRef(PyUnicode_FromString(""));
+    auto joinedLines = (lines && separator) ? PyRef(PyUnicode_Join(separator.get(), lines.get())) : PyRef();
+    auto utf8 = joinedLines ? PyUnicode_AsUTF8(joinedLines.get()) : nullptr;
+
+    if (utf8) {
+        text = QString::fromUtf8(utf8);
+    }
+
+    // any error raised while formatting is discarded in favour of the original exception
+
+    PyErr_Clear();
+    PyErr_Restore(type, value, traceback);
+
+    return text;
+}
+
+QSharedPointer<Nedrysoft::BuildHandle> Nedrysoft::Python::runScript(const QString& script, PyObject *locals, const QString &scriptName, bool persistent) {
+    // the handle is kept alive by the script thread, it is deleted on the thread that created it
+
+    auto handle = QSharedPointer<BuildHandle>(new BuildHandle, &QObject::deleteLater);
+
+    initialise();
+
+    m_runningScripts++;
+
+    m_isRunning = true;
+
+    auto thread = std::thread([this, handle, script, locals, scriptName, persistent, isProfiling = m_isProfiling]() {
         PyGILState_STATE gilState;
+        auto errorCode = Ok;
+        auto exitCode = 0;
+        QString traceback;
+        ScriptProfile profile;
 
         gilState = PyGILState_Ensure();
 
+        handle->setThreadId(PyThread_get_thread_ident());
+
         PyObject *systemModule = PyImport_ImportModule("sys");
         PyObject *systemPath = PyObject_GetAttrString(systemModule, "path");
 
-        // add our local packages & dependencies to load first
+        // add our local packages & dependencies to load first, the interpreter is shared so paths that were
+        // added by a previous run are not added again.
 
         for (const auto& modulePath : m_modulePaths) {
-            QDirIterator dirIterator(modulePath);
-
-            while (dirIterator.hasNext()) {
-                QFileInfo fileInfo(dirIterator.next());
-
-                if (fileInfo.fileName().startsWith(".")) {
-                    continue;
-                }
-
-                auto localModulePath = PyUnicode_FromString(fileInfo.absoluteFilePath().toLatin1().data());
+            auto localModulePath = PyUnicode_FromString(modulePath.toUtf8().data());
 
+            if (PySequence_Contains(systemPath, localModulePath)==0) {
                 PyList_Insert(systemPath, 0, localModulePath);
-
-                Py_DECREF(localModulePath);
             }
-        }
 
-        auto dict = PyDict_New();
+            Py_DECREF(localModulePath);
+        }
 
         QMapIterator<QString, PyMethodDef *> moduleIterator(m_modules);
 
@@ -105,6 +381,14 @@ void Nedrysoft::Python::runScript(const QString& script, PyObject *locals) {
             auto dmgeeModule = PyImport_AddModule(moduleIterator.key().toLatin1().constData());
 
             PyModule_AddFunctions(dmgeeModule, moduleIterator.value());
+
+            QMapIterator<QString, long> constantIterator(m_moduleConstants.value(moduleIterator.key()));
+
+            while (constantIterator.hasNext()) {
+                constantIterator.next();
+
+                PyModule_AddIntConstant(dmgeeModule, constantIterator.key().toLatin1().constData(), constantIterator.value());
+            }
         }
 
         QMapIterator<QString, void *> variableIterator(m_threadVariables);
@@ -115,25 +399,109 @@ void Nedrysoft::Python::runScript(const QString& script, PyObject *locals) {
             addVariable(variableIterator.key(), variableIterator.value());
         }
 
-        // TODO: this should actually be PyObject_CallObject as that will allow us to get a return value
+        // each run gets a fresh namespace, modules that were imported by a previous run (or by the warm up) are
+        // shared through sys.modules so they do not need to be loaded again.
+
+        auto globals = PyDict_New();
+        auto moduleName = PyUnicode_FromString("__main__");
+
+        PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
+        PyDict_SetItemString(globals, "__name__", moduleName);
+
+        Py_DECREF(moduleName);
+
+        if (locals) {
+            PyDict_Update(globals, locals);
+        }
+
+        // a script that was cancelled before the thread started is not run
+
+        auto isStarted = !handle->isCancelled();
+
+        if (isStarted) {
+            auto code = compile(script, scriptName, persistent);
+
+            if (code) {
+                // only the script itself is profiled, compiling and setting up the namespace are excluded
+
+                ScriptProfiler profiler;
+
+                if (isProfiling) {
+                    profiler.start();
+                }
+
+                auto result = PyEval_EvalCode(code, globals, globals);
+
+                profile = profiler.stop();
+
+                Py_XDECREF(result);
+                Py_DECREF(code);
+            }
+        }
+
+        if (PyErr_Occurred()) {
+            if (PyErr_ExceptionMatches(PyExc_SystemExit)) {
+                // PyErr_Print would exit the application, so the exit code is taken from the exception instead
+
+                PyObject *type, *value, *exceptionTraceback;
+
+                PyErr_Fetch(&type, &value, &exceptionTraceback);
+                PyErr_NormalizeException(&type, &value, &exceptionTraceback);
+
+                auto code = value ? PyRef(PyObject_GetAttrString(value, "code")) : PyRef();
+
+                if ((!code) || (code.get()==Py_None)) {
+                    exitCode = 0;
+                } else if (PyLong_Check(code.get())) {
+                    exitCode = static_cast<int>(PyLong_AsLong(code.get()));
+                } else {
+                    exitCode = 1;
+                }
+
+                Py_XDECREF(type);
+                Py_XDECREF(value);
+                Py_XDECREF(exceptionTraceback);
+
+                PyErr_Clear();
+
+                errorCode = exitCode ? ScriptFailed : Ok;
+            } else {
+                errorCode = ScriptFailed;
+                traceback = formatException();
+
+                PyErr_Print();
+            }
+        }
+
+        // an interrupted script may fail with a different exception, for example when a native call was stopped
 
-        auto result = PyRun_String(script.toLatin1().data(), Py_file_input, dict, locals);
+        if ((!isStarted) || ((errorCode!=Ok) && (handle->isCancelled()))) {
+            errorCode = handle->isTimedOut() ? ScriptTimedOut : ScriptCancelled;
+        }
 
-        PyErr_Print();
+        handle->setThreadId(0);
 
+        Py_DECREF(globals);
+        Py_XDECREF(locals);
         Py_DECREF(systemModule);
         Py_DECREF(systemPath);
 
         PyGILState_Release(gilState);
 
-        Q_EMIT finished(Ok, 0);
+        m_runningScripts--;
+
+        m_isRunning = false;
+
+        // completing the handle may cause this instance to be deleted, so it must be the last thing that is done
 
-        QMetaObject::invokeMethod(qobject_cast<QApplication *>(QCoreApplication::instance()), [threadState]() {
-            PyEval_RestoreThread(threadState);
-        });
+        Q_EMIT finished(errorCode, exitCode);
+
+        handle->setFinished(errorCode, exitCode, traceback, profile);
     });
 
     thread.detach();
+
+    return handle;
 }
 
 void Nedrysoft::Python::addModule(const QString &moduleName, PyMethodDef moduleMethods[]) {
@@ -144,6 +512,18 @@ void Nedrysoft::Python::addModule(const QString &moduleName, PyMethodDef moduleM
     }
 }
 
+void Nedrysoft::Python::addModuleConstant(const QString &moduleName, const QString &name, long value) {
+    m_moduleConstants[moduleName][name] = value;
+}
+
+bool Nedrysoft::Python::isRunning() const {
+    return m_isRunning;
+}
+
+void Nedrysoft::Python::setProfiling(bool isProfiling) {
+    m_isProfiling = isProfiling;
+}
+
 void Nedrysoft::Python::setVariable(const QString &key, void *value) {
     m_threadVariables[key] = value;
 }
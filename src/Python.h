@@ -22,13 +22,20 @@
 #ifndef NEDRYSOFT_PYTHON_H
 #define NEDRYSOFT_PYTHON_H
 
+#include "BuildHandle.h"
+
+#include <QByteArray>
 #include <QObject>
 #include <QMap>
+#include <QSharedPointer>
 #include <QString>
 #include <QStringList>
 
+#include <atomic>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include <Python.h>         //! @note global python include must be included after other includes
 
@@ -51,7 +58,10 @@ namespace Nedrysoft {
             enum ErrorCode {
                 Ok,                                                 /**< Script was sucessfully run. */
                 ScriptNotFound,                                     /**< Script does not exist */
-                ScriptInvalid                                       /**< The script could not be validated */
+                ScriptInvalid,                                      /**< The script could not be validated */
+                ScriptFailed,                                       /**< The script raised an exception */
+                ScriptCancelled,                                    /**< The script was cancelled */
+                ScriptTimedOut                                      /**< The script was cancelled as it ran for too long */
             };
 
         private:
@@ -67,16 +77,54 @@ namespace Nedrysoft {
             /**
              * @brief       Constructs a new Python instance.
              *
-             * @note        The python instance is bound to the thread that constructed it, do not call any other functions
-             *              from a different thread as this will result in crash.
+             * @note        All instances share a single interpreter which is created by initialise (or when the first
+             *              script is run), scripts run by an instance are given their own namespace so that one build
+             *              cannot see the state of another.
              */
             Python();
 
             /**
              * @brief       Destroys the Python.
+             *
+             * @note        The shared interpreter is not affected, it is finalised by calling shutdown.
              */
             ~Python();
 
+            /**
+             * @brief       Initialises the shared python interpreter if it has not already been initialised.
+             *
+             * @details     The interpreter is created on the calling thread which then releases the GIL, the modules in
+             *              preloadModules are imported on a background thread so that they are already loaded when the
+             *              first script is run.  Calling this function again only imports any new modules.
+             *
+             * @note        Must be called from the main thread.
+             *
+             * @param[in]   preloadModules the list of modules to be imported in the background.
+             */
+            static void initialise(const QStringList &preloadModules = QStringList());
+
+            /**
+             * @brief       Sets the bytecode archive that the interpreter imports its bundled packages from.
+             *
+             * @details     The archive is built by python/bundle.py and embedded as a resource, it is copied to the
+             *              cache folder under a hash of its content and placed at the front of sys.path when the
+             *              interpreter is created.  Packages in the archive take precedence over any installed with
+             *              pip.  The archive is ignored if it was compiled for a different python version.
+             *
+             * @note        Must be called before initialise.
+             *
+             * @param[in]   resourceName the resource name of the archive.
+             */
+            static void setModuleArchive(const QString &resourceName);
+
+            /**
+             * @brief       Finalises the shared python interpreter.
+             *
+             * @note        Must be called from the main thread.  If a script is still running then the interpreter is
+             *              left running as it is not safe to finalise it.
+             */
+            static void shutdown();
+
             /**
              * @brief       Loads the script from disk and then executes it.
              *
@@ -93,14 +141,28 @@ namespace Nedrysoft {
              * @note        The python script is executed in a separate thread as to not block the UI, the object will
              *              emit the finished signal with an error code once the script has finished.
              *
+             * @note        The caller must not hold the GIL.  Ownership of locals is transferred to this function, the
+             *              contents are copied into the namespace that the script is run in.
+             *
+             * @note        The script is compiled the first time it is seen and the code object is cached for the rest of
+             *              the session, if persistent is true then the compiled code is also stored on disk so that the
+             *              script does not need to be compiled in future sessions.
+             *
              * @param[in]   script the python script to execute.
              * @param[in]   locals the python object (Dict) that contains local variables that can be accessed from python.
+             * @param[in]   scriptName the name of the script used in tracebacks.
+             * @param[in]   persistent true if the compiled code should be stored on disk; otherwise false.
+             *
+             * @returns     the handle of the script, used to cancel it and to retrieve the result.
              */
-            void runScript(const QString &script, PyObject *locals);
+            QSharedPointer<BuildHandle> runScript(const QString &script, PyObject *locals, const QString &scriptName = "<dmgee>", bool persistent = false);
 
             /**
              * @brief       Inserts paths to local python modules to override system libraries.
              *
+             * @details     Each folder in the given paths is added to sys.path, the folders are found when this is
+             *              called so that running a script does not need to read the file system.
+             *
              * @param[in]   modulePaths the list of paths to insert.
              */
             void addModulePaths(QStringList modulePaths);
@@ -113,6 +175,31 @@ namespace Nedrysoft {
              */
             void addModule(const QString &moduleName, PyMethodDef moduleMethods[]);
 
+            /**
+             * @brief       Adds an integer constant to a C module.
+             *
+             * @param[in]   moduleName the name of the module.
+             * @param[in]   name the name of the constant.
+             * @param[in]   value the value of the constant.
+             */
+            void addModuleConstant(const QString &moduleName, const QString &name, long value);
+
+            /**
+             * @brief       Returns whether a script started by this instance is running.
+             *
+             * @returns     true if running; otherwise false.
+             */
+            bool isRunning() const;
+
+            /**
+             * @brief       Sets whether scripts started by this instance are profiled.
+             *
+             * @note        The profile is available from the BuildHandle once the script has finished.
+             *
+             * @param[in]   isProfiling true if scripts should be profiled; otherwise false.
+             */
+            void setProfiling(bool isProfiling);
+
             /**
              * @brief       Sets a variable for this instance.
              *
@@ -146,12 +233,55 @@ namespace Nedrysoft {
              */
             static void addVariable(const QString &key, void *value);
 
+            /**
+             * @brief       Imports the given modules, errors are printed and cleared.
+             *
+             * @note        The caller must hold the GIL.
+             *
+             * @param[in]   modules the list of modules to import.
+             */
+            static void importModules(const QStringList &modules);
+
+            /**
+             * @brief       Returns the compiled code object for a script.
+             *
+             * @details     Code objects are cached by a hash of the script name and source, persistent scripts are also
+             *              stored on disk as marshalled bytecode keyed by that hash and the python version.
+             *
+             * @note        The caller must hold the GIL.
+             *
+             * @param[in]   script the python script.
+             * @param[in]   scriptName the name of the script used in tracebacks.
+             * @param[in]   persistent true if the compiled code should be stored on disk; otherwise false.
+             *
+             * @returns     a new reference to the code object; or nullptr if the script failed to compile.
+             */
+            static PyObject *compile(const QString &script, const QString &scriptName, bool persistent);
+
+            /**
+             * @brief       Takes the pending exception and formats it in the same way as the interpreter would.
+             *
+             * @note        The caller must hold the GIL, the exception is left set so that it can still be printed.
+             *
+             * @returns     the formatted traceback; or an empty string if it could not be formatted.
+             */
+            static QString formatException();
+
+            /**
+             * @brief       Copies the module archive to the cache folder and adds it to sys.path.
+             *
+             * @note        The caller must hold the GIL.
+             *
+             * @returns     true if the archive was added; otherwise false.
+             */
+            static bool installModuleArchive();
+
         public:
             /**
              * @brief       This signal is emitted when the python script has completed.
              *
              * @param[in]   result zero if no error occurred; otherwise it indicates an error occured.
-             * @param[in]   pythonResult the error code from python if applicable.
+             * @param[in]   pythonResult the exit code that the script passed to sys.exit.
              */
             Q_SIGNAL void finished(int result, int pythonResult);
 
@@ -159,10 +289,21 @@ namespace Nedrysoft {
             QStringList m_modulePaths;                          //! list of extra paths to search for modules in
 
             QMap<QString, PyMethodDef *> m_modules;             //! list of c modules to be imported
+            QMap<QString, QMap<QString, long> > m_moduleConstants;  //! integer constants for each c module
 
             QMap<QString, void *> m_threadVariables;            //! list of variable values for this instance.  These are added to the thread that the interpreter runs in.
 
+            std::atomic<bool> m_isRunning;                      //! whether a script is running
+            bool m_isProfiling;                                 //! whether scripts are profiled
+
             static QMap<QString, Py_tss_t *> m_variables;       //! global list of thread variables
+
+            static std::mutex m_interpreterMutex;               //! protects the interpreter state below
+            static PyThreadState *m_mainThreadState;            //! the main thread state saved when the GIL was released
+            static std::list<std::thread> m_warmupThreads;      //! threads that are importing modules in the background
+            static std::atomic<int> m_runningScripts;           //! the number of scripts currently running
+            static QMap<QByteArray, PyObject *> m_codeCache;    //! compiled code objects by name and source hash (GIL protected)
+            static QString m_moduleArchive;                     //! the resource name of the bundled package archive
 };
 };
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScriptProfile.h"
+
+#include <QLocale>
+
+constexpr auto nanosecondsPerMillisecond = 1000000.0;
+constexpr auto bytesPerMegabyte = 1024.0*1024.0;
+
+static QString milliseconds(qint64 time) {
+    return QString::number(static_cast<double>(time)/nanosecondsPerMillisecond, 'f', 2);
+}
+
+static QString megabytes(qint64 bytes) {
+    return QString::number(static_cast<double>(bytes)/bytesPerMegabyte, 'f', 2);
+}
+
+QStringList Nedrysoft::ScriptProfile::summary(int count) const {
+    QStringList lines;
+    qint64 totalCalls = 0;
+
+    for (auto const &function : functions) {
+        totalCalls += function.calls;
+    }
+
+    auto header = QString("Python profile: %1 ms, %2 calls").arg(milliseconds(duration)).arg(QLocale().toString(totalCalls));
+
+    if (peakMemory>=0) {
+        header += QString(", %1 MB peak memory, %2 MB in use at the end").arg(megabytes(peakMemory)).arg(megabytes(currentMemory));
+    }
+
+    lines << header;
+
+    lines << QString("%1 %2 %3  %4").arg("own ms", 10).arg("total ms", 10).arg("calls", 9).arg("function");
+
+    for (auto const &function : functions.mid(0, count)) {
+        lines << QString("%1 %2 %3  %4.%5")
+                .arg(milliseconds(function.ownTime), 10)
+                .arg(milliseconds(function.totalTime), 10)
+                .arg(function.calls, 9)
+                .arg(function.module)
+                .arg(function.name);
+    }
+
+    lines << QString("%1 %2 %3  %4").arg("own ms", 10).arg("retained", 10).arg("calls", 9).arg("module");
+
+    for (auto const &module : modules.mid(0, count)) {
+        lines << QString("%1 %2 %3  %4")
+                .arg(milliseconds(module.ownTime), 10)
+                .arg(peakMemory>=0 ? QString("%1 MB").arg(megabytes(module.retainedMemory)) : QString("-"), 10)
+                .arg(module.calls, 9)
+                .arg(module.name);
+    }
+
+    return lines;
+}
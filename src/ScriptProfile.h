@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_SCRIPTPROFILE_H
+#define NEDRYSOFT_SCRIPTPROFILE_H
+
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The ScriptProfile structure holds the time spent in each python function during a build.
+     *
+     * @details     A profile is recorded by ScriptProfiler when profiling is enabled, it does not depend on python
+     *              so it can be sent by a build worker and stored with the trace of a build.  Times are in
+     *              nanoseconds, memory is the memory allocated by python as traced by tracemalloc.
+     */
+    struct ScriptProfile {
+        /**
+         * @brief       Holds the totals for a single function.
+         */
+        struct Function {
+            QString name;                                   //! the qualified name of the function
+            QString module;                                 //! the module that the function belongs to
+            qint64 calls = 0;                               //! the number of times the function was called
+            qint64 totalTime = 0;                           //! time spent in the function, including the functions it called
+            qint64 ownTime = 0;                             //! time spent in the function itself
+        };
+
+        /**
+         * @brief       Holds the totals for all of the functions of a module.
+         */
+        struct Module {
+            QString name;                                   //! the name of the module
+            qint64 calls = 0;                               //! the number of calls to functions in the module
+            qint64 ownTime = 0;                             //! time spent in the functions of the module
+            qint64 retainedMemory = 0;                      //! memory allocated by the module that was still in use at the end
+        };
+
+        QVector<Function> functions;                        //! the functions, ordered by own time
+        QVector<Module> modules;                            //! the modules, ordered by own time
+        qint64 start = 0;                                   //! the time profiling started (monotonic clock)
+        qint64 duration = 0;                                //! the time that the script was profiled for
+        qint64 currentMemory = -1;                          //! memory in use at the end, -1 if not traced
+        qint64 peakMemory = -1;                             //! the most memory in use at once, -1 if not traced
+
+        static constexpr auto DefaultSummaryCount = 10;     //! the number of functions and modules in a summary
+
+        /**
+         * @brief       Returns whether the profile holds any functions.
+         *
+         * @returns     true if empty; otherwise false.
+         */
+        bool isEmpty() const {
+            return functions.isEmpty();
+        }
+
+        /**
+         * @brief       Returns a text summary of the functions and modules that took the most time.
+         *
+         * @param[in]   count the number of functions and modules to include.
+         *
+         * @returns     the lines of the summary.
+         */
+        QStringList summary(int count = DefaultSummaryCount) const;
+    };
+}
+
+Q_DECLARE_METATYPE(Nedrysoft::ScriptProfile)
+
+#endif //NEDRYSOFT_SCRIPTPROFILE_H
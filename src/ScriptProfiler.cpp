@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Python.h"                         //! @note must be included first
+
+#include "ScriptProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+constexpr auto tracedFrameCount = 1;                        //! frames stored by tracemalloc for each allocation
+
+static qint64 profileTimestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static QString profileString(PyObject *value) {
+    Py_ssize_t length;
+
+    if ((!value) || (!PyUnicode_Check(value))) {
+        return QString();
+    }
+
+    auto data = PyUnicode_AsUTF8AndSize(value, &length);
+
+    if (!data) {
+        PyErr_Clear();
+
+        return QString();
+    }
+
+    return QString::fromUtf8(data, static_cast<int>(length));
+}
+
+Nedrysoft::ScriptProfiler::ScriptProfiler(bool isTracingMemory) :
+        m_startTime(0),
+        m_isTracingMemory(isTracingMemory),
+        m_isTracingStarted(false),
+        m_isRunning(false) {
+
+}
+
+Nedrysoft::ScriptProfiler::~ScriptProfiler() {
+    if (m_isRunning) {
+        stop();
+    }
+}
+
+void Nedrysoft::ScriptProfiler::start() {
+    if (m_isRunning) {
+        return;
+    }
+
+    m_capsule = PyRef(PyCapsule_New(this, nullptr, nullptr));
+
+    if (!m_capsule) {
+        PyErr_Clear();
+
+        return;
+    }
+
+    // memory is only reported if this profiler started tracing, otherwise the figures would include allocations
+    // made before the build started.
+
+    if (m_isTracingMemory) {
+        auto tracemallocModule = PyRef(PyImport_ImportModule("tracemalloc"));
+        auto isTracing = tracemallocModule ? PyRef(PyObject_CallMethod(tracemallocModule.get(), "is_tracing", nullptr)) : PyRef();
+
+        if ((isTracing) && (isTracing.get()==Py_False)) {
+            m_isTracingStarted = static_cast<bool>(PyRef(PyObject_CallMethod(tracemallocModule.get(), "start", "i", tracedFrameCount)));
+        }
+
+        PyErr_Clear();
+    }
+
+    m_startTime = profileTimestamp();
+    m_isRunning = true;
+
+    PyEval_SetProfile(profile, m_capsule.get());
+}
+
+Nedrysoft::ScriptProfile Nedrysoft::ScriptProfiler::stop() {
+    ScriptProfile profile;
+
+    if (!m_isRunning) {
+        return profile;
+    }
+
+    PyEval_SetProfile(nullptr, nullptr);
+
+    m_isRunning = false;
+
+    // calls that have not returned belong to a script that was interrupted, they end now
+
+    while (!m_calls.empty()) {
+        leave();
+    }
+
+    profile.start = m_startTime;
+    profile.duration = profileTimestamp()-m_startTime;
+
+    QMap<QString, qint64> fileMemory;
+
+    if (m_isTracingStarted) {
+        PyObject *type, *value, *traceback;
+
+        // the script may have left an exception set, it is put back once the snapshot has been taken
+
+        PyErr_Fetch(&type, &value, &traceback);
+
+        fileMemory = tracedMemory(profile.currentMemory, profile.peakMemory);
+
+        PyErr_Restore(type, value, traceback);
+
+        m_isTracingStarted = false;
+    }
+
+    QMap<QString, ScriptProfile::Module> modules;
+    QMap<QString, QString> fileModules;
+
+    for (auto const &entry : m_entries) {
+        auto &module = modules[entry.module];
+
+        module.name = entry.module;
+        module.calls += entry.calls;
+        module.ownTime += entry.ownTime;
+
+        if (!entry.filename.isEmpty()) {
+            fileModules[entry.filename] = entry.module;
+        }
+
+        profile.functions.append(ScriptProfile::Function{entry.name, entry.module, entry.calls, entry.totalTime, entry.ownTime});
+    }
+
+    for (auto fileIterator = fileMemory.constBegin(); fileIterator!=fileMemory.constEnd(); ++fileIterator) {
+        if (fileModules.contains(fileIterator.key())) {
+            modules[fileModules[fileIterator.key()]].retainedMemory += fileIterator.value();
+        }
+    }
+
+    for (auto const &module : modules) {
+        profile.modules.append(module);
+    }
+
+    std::sort(profile.functions.begin(), profile.functions.end(), [](const ScriptProfile::Function &first, const ScriptProfile::Function &second) {
+        return first.ownTime>second.ownTime;
+    });
+
+    std::sort(profile.modules.begin(), profile.modules.end(), [](const ScriptProfile::Module &first, const ScriptProfile::Module &second) {
+        return first.ownTime>second.ownTime;
+    });
+
+    m_entryIndexes.clear();
+    m_entries.clear();
+    m_codeObjects.clear();
+    m_capsule = PyRef();
+
+    return profile;
+}
+
+int Nedrysoft::ScriptProfiler::profile(PyObject *object, PyFrameObject *frame, int what, PyObject *arg) {
+    auto profiler = static_cast<ScriptProfiler *>(PyCapsule_GetPointer(object, nullptr));
+
+    switch (what) {
+        case PyTrace_CALL: {
+            profiler->enter(profiler->pythonEntry(frame));
+            break;
+        }
+
+        case PyTrace_C_CALL: {
+            profiler->enter(profiler->cEntry(arg));
+            break;
+        }
+
+        case PyTrace_RETURN:
+        case PyTrace_C_RETURN:
+        case PyTrace_C_EXCEPTION: {
+            profiler->leave();
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+int Nedrysoft::ScriptProfiler::pythonEntry(PyFrameObject *frame) {
+    auto code = PyFrame_GetCode(frame);
+    auto entryIterator = m_entryIndexes.find(code);
+
+    if (entryIterator!=m_entryIndexes.end()) {
+        Py_DECREF(code);
+
+        return entryIterator->second;
+    }
+
+    // the names are only looked up the first time that a function is seen, the code object is kept so that the
+    // address cannot be reused by another function while profiling.
+
+    PyObject *type, *value, *traceback;
+    Entry entry;
+
+    PyErr_Fetch(&type, &value, &traceback);
+
+#if PY_VERSION_HEX >= 0x030B0000
+    auto globals = PyRef(PyFrame_GetGlobals(frame));
+
+    entry.name = profileString(code->co_qualname);
+#else
+    auto globals = PyRef::borrowed(frame->f_globals);
+
+    entry.name = profileString(code->co_name);
+#endif
+    entry.module = profileString(globals ? PyDict_GetItemString(globals.get(), "__name__") : nullptr);
+    entry.filename = profileString(code->co_filename);
+
+    if (entry.module.isEmpty()) {
+        entry.module = "<unknown>";
+    }
+
+    PyErr_Restore(type, value, traceback);
+
+    m_codeObjects.emplace_back(reinterpret_cast<PyObject *>(code));
+    m_entries.push_back(entry);
+
+    return m_entryIndexes[code] = static_cast<int>(m_entries.size()-1);
+}
+
+int Nedrysoft::ScriptProfiler::cEntry(PyObject *function) {
+    auto isCFunction = PyCFunction_Check(function);
+    auto cFunction = reinterpret_cast<PyCFunctionObject *>(function);
+    const void *key = isCFunction ? static_cast<const void *>(cFunction->m_ml) : static_cast<const void *>(Py_TYPE(function));
+    auto entryIterator = m_entryIndexes.find(key);
+
+    if (entryIterator!=m_entryIndexes.end()) {
+        return entryIterator->second;
+    }
+
+    PyObject *type, *value, *traceback;
+    Entry entry;
+
+    PyErr_Fetch(&type, &value, &traceback);
+
+    entry.module = "builtins";
+
+    if (!isCFunction) {
+        entry.name = QString::fromUtf8(Py_TYPE(function)->tp_name);
+    } else if ((cFunction->m_self) && (PyModule_Check(cFunction->m_self))) {
+        auto moduleName = PyModule_GetName(cFunction->m_self);
+
+        entry.name = QString::fromUtf8(cFunction->m_ml->ml_name);
+        entry.module = moduleName ? QString::fromUtf8(moduleName) : entry.module;
+    } else if (cFunction->m_self) {
+        // a method of a C type, the type name includes the module unless it is a builtin type
+
+        auto typeName = QString::fromUtf8(Py_TYPE(cFunction->m_self)->tp_name);
+        auto separatorIndex = typeName.lastIndexOf('.');
+
+        if (separatorIndex>=0) {
+            entry.module = typeName.left(separatorIndex);
+            typeName = typeName.mid(separatorIndex+1);
+        }
+
+        entry.name = QString("%1.%2").arg(typeName).arg(QString::fromUtf8(cFunction->m_ml->ml_name));
+    } else {
+        entry.name = QString::fromUtf8(cFunction->m_ml->ml_name);
+    }
+
+    PyErr_Clear();
+    PyErr_Restore(type, value, traceback);
+
+    m_entries.push_back(entry);
+
+    return m_entryIndexes[key] = static_cast<int>(m_entries.size()-1);
+}
+
+void Nedrysoft::ScriptProfiler::enter(int entryIndex) {
+    auto &entry = m_entries[entryIndex];
+
+    entry.calls++;
+    entry.activeCalls++;
+
+    m_calls.push_back(Call{entryIndex, profileTimestamp(), 0});
+}
+
+void Nedrysoft::ScriptProfiler::leave() {
+    if (m_calls.empty()) {
+        return;
+    }
+
+    auto call = m_calls.back();
+    auto elapsed = profileTimestamp()-call.start;
+    auto &entry = m_entries[call.entryIndex];
+
+    m_calls.pop_back();
+
+    entry.ownTime += elapsed-call.childTime;
+
+    // a recursive call is already included in the time of the outermost call
+
+    if (--entry.activeCalls==0) {
+        entry.totalTime += elapsed;
+    }
+
+    if (!m_calls.empty()) {
+        m_calls.back().childTime += elapsed;
+    }
+}
+
+QMap<QString, qint64> Nedrysoft::ScriptProfiler::tracedMemory(qint64 &current, qint64 &peak) {
+    auto tracemallocModule = PyRef(PyImport_ImportModule("tracemalloc"));
+    QMap<QString, qint64> fileMemory;
+
+    current = -1;
+    peak = -1;
+
+    if (!tracemallocModule) {
+        PyErr_Clear();
+
+        return fileMemory;
+    }
+
+    auto tracedMemory = PyRef(PyObject_CallMethod(tracemallocModule.get(), "get_traced_memory", nullptr));
+
+    if ((tracedMemory) && (PyTuple_Check(tracedMemory.get())) && (PyTuple_GET_SIZE(tracedMemory.get())==2)) {
+        current = PyLong_AsLongLong(PyTuple_GET_ITEM(tracedMemory.get(), 0));
+        peak = PyLong_AsLongLong(PyTuple_GET_ITEM(tracedMemory.get(), 1));
+    }
+
+    // the snapshot groups the allocations that are still in use by the file of the python code that made them
+
+    auto snapshot = PyRef(PyObject_CallMethod(tracemallocModule.get(), "take_snapshot", nullptr));
+    auto statistics = snapshot ? PyRef(PyObject_CallMethod(snapshot.get(), "statistics", "s", "filename")) : PyRef();
+    auto statisticsCount = statistics ? PySequence_Size(statistics.get()) : 0;
+
+    for (Py_ssize_t statisticIndex = 0; statisticIndex<statisticsCount; statisticIndex++) {
+        auto statistic = PyRef(PySequence_GetItem(statistics.get(), statisticIndex));
+        auto size = statistic ? PyRef(PyObject_GetAttrString(statistic.get(), "size")) : PyRef();
+        auto traceback = statistic ? PyRef(PyObject_GetAttrString(statistic.get(), "traceback")) : PyRef();
+        auto frame = traceback ? PyRef(PySequence_GetItem(traceback.get(), 0)) : PyRef();
+        auto filename = frame ? PyRef(PyObject_GetAttrString(frame.get(), "filename")) : PyRef();
+
+        if ((size) && (filename)) {
+            fileMemory[profileString(filename.get())] += PyLong_AsLongLong(size.get());
+        }
+
+        PyErr_Clear();
+    }
+
+    PyRef(PyObject_CallMethod(tracemallocModule.get(), "stop", nullptr));
+
+    PyErr_Clear();
+
+    return fileMemory;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_SCRIPTPROFILER_H
+#define NEDRYSOFT_SCRIPTPROFILER_H
+
+#include "PyRef.h"
+#include "ScriptProfile.h"
+
+#include <QMap>
+#include <QString>
+#include <unordered_map>
+#include <vector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The ScriptProfiler class records the time spent in each python function run on a thread.
+     *
+     * @details     A C profile hook is installed with PyEval_SetProfile, each call and return is matched against
+     *              a stack and the time is added to a table entry for the function.  Functions are identified by
+     *              their code object (or method definition for C functions) so that names are only looked up the
+     *              first time a function is seen.  C functions are included, time spent waiting for other processes
+     *              is shown against the function that waited.
+     *
+     *              When memory is traced, tracemalloc is started with a single frame and the memory still in use
+     *              at the end is attributed to the modules that allocated it.
+     *
+     * @note        The GIL must be held when calling any function of the profiler, it must be stopped on the
+     *              thread that started it.
+     */
+    class ScriptProfiler {
+        public:
+            /**
+             * @brief       Constructs a new ScriptProfiler instance.
+             *
+             * @param[in]   isTracingMemory true if python memory use should be traced; otherwise false.
+             */
+            explicit ScriptProfiler(bool isTracingMemory = true);
+
+            /**
+             * @brief       Destroys the ScriptProfiler, removing the profile hook if it is still installed.
+             */
+            ~ScriptProfiler();
+
+            /**
+             * @brief       Installs the profile hook on the calling thread.
+             */
+            void start();
+
+            /**
+             * @brief       Removes the profile hook and returns the profile.
+             *
+             * @returns     the profile.
+             */
+            ScriptProfile stop();
+
+        private:
+            /**
+             * @brief       Holds the totals for a function while profiling.
+             */
+            struct Entry {
+                QString name;                                   //! the qualified name of the function
+                QString module;                                 //! the module of the function
+                QString filename;                               //! the source file of a python function
+                qint64 calls = 0;                               //! number of calls
+                qint64 totalTime = 0;                           //! time including called functions
+                qint64 ownTime = 0;                             //! time excluding called functions
+                int activeCalls = 0;                            //! number of calls on the stack, for recursion
+            };
+
+            /**
+             * @brief       Holds a call that has not returned.
+             */
+            struct Call {
+                int entryIndex;                                 //! the function that was called
+                qint64 start;                                   //! the time of the call
+                qint64 childTime;                               //! time spent in functions it called
+            };
+
+            /**
+             * @brief       The profile hook.
+             *
+             * @param[in]   object the capsule holding the profiler.
+             * @param[in]   frame the frame of the python function.
+             * @param[in]   what the kind of event.
+             * @param[in]   arg the C function for C events.
+             *
+             * @returns     0 to continue.
+             */
+            static int profile(PyObject *object, PyFrameObject *frame, int what, PyObject *arg);
+
+            /**
+             * @brief       Returns the entry for the python function of a frame, creating it if needed.
+             *
+             * @param[in]   frame the frame.
+             *
+             * @returns     the index of the entry.
+             */
+            int pythonEntry(PyFrameObject *frame);
+
+            /**
+             * @brief       Returns the entry for a C function, creating it if needed.
+             *
+             * @param[in]   function the function object.
+             *
+             * @returns     the index of the entry.
+             */
+            int cEntry(PyObject *function);
+
+            /**
+             * @brief       Adds a call to the stack.
+             *
+             * @param[in]   entryIndex the function that was called.
+             */
+            void enter(int entryIndex);
+
+            /**
+             * @brief       Removes the most recent call from the stack and adds its time to the function.
+             */
+            void leave();
+
+            /**
+             * @brief       Returns the memory still in use at the end of the profile by source file.
+             *
+             * @param[out]  current receives the memory in use.
+             * @param[out]  peak receives the most memory in use at once.
+             *
+             * @returns     the memory in bytes, by filename.
+             */
+            QMap<QString, qint64> tracedMemory(qint64 &current, qint64 &peak);
+
+        private:
+            std::unordered_map<const void *, int> m_entryIndexes;   //! index of each function in m_entries
+            std::vector<Entry> m_entries;                       //! the functions that have been called
+            std::vector<Call> m_calls;                          //! the calls that have not returned
+            std::vector<PyRef> m_codeObjects;                   //! keeps code objects alive so their addresses are not reused
+            PyRef m_capsule;                                    //! the object passed to the profile hook
+            qint64 m_startTime;                                 //! the time the hook was installed
+            bool m_isTracingMemory;                             //! whether memory should be traced
+            bool m_isTracingStarted;                            //! whether this profiler started tracemalloc
+            bool m_isRunning;                                   //! whether the hook is installed
+    };
+}
+
+#endif //NEDRYSOFT_SCRIPTPROFILER_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SnapEngine.h"
+
+#include <QtMath>
+#include <cmath>
+
+Nedrysoft::SnapEngine::SnapEngine(int snapRadius, int alignRadius) :
+        m_snapRadius(std::max(snapRadius, 1)),
+        m_alignRadius(alignRadius) {
+
+}
+
+quint64 Nedrysoft::SnapEngine::cellKey(int column, int row) {
+    return (static_cast<quint64>(static_cast<quint32>(column)) << 32) | static_cast<quint32>(row);
+}
+
+void Nedrysoft::SnapEngine::setCentroids(const QList<QPointF> &centroids) {
+    m_centroids = centroids.toVector();
+    m_cells.clear();
+
+    for (auto index = 0; index < m_centroids.count(); index++) {
+        auto column = qFloor(m_centroids[index].x() / m_snapRadius);
+        auto row = qFloor(m_centroids[index].y() / m_snapRadius);
+
+        m_cells[cellKey(column, row)].append(index);
+    }
+}
+
+void Nedrysoft::SnapEngine::setGridSize(const QSize &gridSize) {
+    m_gridSize = gridSize;
+}
+
+void Nedrysoft::SnapEngine::setIconPosition(int id, const QPoint &point) {
+    removeIcon(id);
+
+    m_iconPositions[id] = point;
+    m_iconsByX.insert(point.x(), id);
+    m_iconsByY.insert(point.y(), id);
+}
+
+void Nedrysoft::SnapEngine::removeIcon(int id) {
+    if (!m_iconPositions.contains(id)) {
+        return;
+    }
+
+    auto point = m_iconPositions.take(id);
+
+    m_iconsByX.remove(point.x(), id);
+    m_iconsByY.remove(point.y(), id);
+}
+
+void Nedrysoft::SnapEngine::clearIcons() {
+    m_iconPositions.clear();
+    m_iconsByX.clear();
+    m_iconsByY.clear();
+}
+
+bool Nedrysoft::SnapEngine::nearestCentroid(const QPointF &point, QPointF &centroid) const {
+    auto column = qFloor(point.x() / m_snapRadius);
+    auto row = qFloor(point.y() / m_snapRadius);
+    auto closestDistance = static_cast<qreal>(m_snapRadius * m_snapRadius);
+    auto found = false;
+
+    // the cell size is the same as the radius, so any centroid within range is in this cell or a neighbour
+
+    for (auto y = row - 1; y <= row + 1; y++) {
+        for (auto x = column - 1; x <= column + 1; x++) {
+            auto cell = m_cells.constFind(cellKey(x, y));
+
+            if (cell == m_cells.constEnd()) {
+                continue;
+            }
+
+            for (auto index : cell.value()) {
+                auto dx = m_centroids[index].x() - point.x();
+                auto dy = m_centroids[index].y() - point.y();
+                auto distance = (dx * dx) + (dy * dy);
+
+                if (distance < closestDistance) {
+                    centroid = m_centroids[index];
+                    closestDistance = distance;
+                    found = true;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+bool Nedrysoft::SnapEngine::nearestAxis(const QMultiMap<int, int> &axis, int id, int value, int &aligned) const {
+    auto closestDistance = m_alignRadius + 1;
+
+    for (auto it = axis.lowerBound(value - m_alignRadius); (it != axis.constEnd()) && (it.key() <= value + m_alignRadius); it++) {
+        if (it.value() == id) {
+            continue;
+        }
+
+        auto distance = std::abs(it.key() - value);
+
+        if (distance < closestDistance) {
+            aligned = it.key();
+            closestDistance = distance;
+        }
+    }
+
+    return closestDistance <= m_alignRadius;
+}
+
+QPoint Nedrysoft::SnapEngine::snap(int id, const QPoint &point, Targets targets) const {
+    QPoint snapPoint = point;
+    QPointF centroid;
+    auto snapped = false;
+
+    if ((targets & Features) && (nearestCentroid(point, centroid))) {
+        snapPoint = centroid.toPoint();
+        snapped = true;
+    }
+
+    if ((targets & Icons) && (!snapped) && (m_alignRadius > 0)) {
+        int aligned;
+
+        if (nearestAxis(m_iconsByX, id, point.x(), aligned)) {
+            snapPoint.setX(aligned);
+        }
+
+        if (nearestAxis(m_iconsByY, id, point.y(), aligned)) {
+            snapPoint.setY(aligned);
+        }
+    }
+
+    if ((targets & Grid) && (m_gridSize.isValid()) && (!m_gridSize.isEmpty())) {
+        auto x = (point.x() / m_gridSize.width()) * m_gridSize.width();
+        auto y = (point.y() / m_gridSize.height()) * m_gridSize.height();
+
+        snapPoint = QPoint(x, y);
+    }
+
+    return snapPoint;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_SNAPENGINE_H
+#define NEDRYSOFT_SNAPENGINE_H
+
+#include <QHash>
+#include <QList>
+#include <QMultiMap>
+#include <QPoint>
+#include <QPointF>
+#include <QSize>
+#include <QVector>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The SnapEngine class finds the point that an icon should snap to while it is being dragged.
+     *
+     * @details     Feature centroids are stored in a spatial hash with a cell size equal to the snap radius, so a
+     *              nearest point query only needs to visit the cell containing the point and its neighbours.  The
+     *              positions of the other icons are kept in maps sorted by x and y so that icons can be aligned
+     *              horizontally or vertically to each other without scanning every icon.
+     */
+    class SnapEngine {
+        public:
+            /**
+             * @brief       The types of target that a point can be snapped to.
+             */
+            enum Target {
+                None = 0,                                       /**< No snapping. */
+                Features = 1,                                   /**< Snap to detected features. */
+                Grid = 2,                                       /**< Snap to the grid. */
+                Icons = 4                                       /**< Align to the other icons. */
+            };
+
+            Q_DECLARE_FLAGS(Targets, Target)
+
+        public:
+            static constexpr auto DefaultSnapRadius = 50;       //! the distance in px that features attract an icon from
+            static constexpr auto DefaultAlignRadius = 8;       //! the distance in px that icons align to each other from
+
+        public:
+            /**
+             * @brief       Constructs a new SnapEngine instance.
+             *
+             * @param[in]   snapRadius the distance from a feature at which an icon will snap to it.
+             * @param[in]   alignRadius the distance from another icons axis at which an icon will align to it.
+             */
+            explicit SnapEngine(int snapRadius = DefaultSnapRadius, int alignRadius = DefaultAlignRadius);
+
+            /**
+             * @brief       Sets the feature centroids and rebuilds the spatial hash.
+             *
+             * @param[in]   centroids the list of snap points.
+             */
+            void setCentroids(const QList<QPointF> &centroids);
+
+            /**
+             * @brief       Sets the grid size.
+             *
+             * @param[in]   gridSize the size of a grid cell; an invalid size disables grid snapping.
+             */
+            void setGridSize(const QSize &gridSize);
+
+            /**
+             * @brief       Sets (or updates) the position of an icon.
+             *
+             * @param[in]   id the identifier of the icon.
+             * @param[in]   point the position of the icon.
+             */
+            void setIconPosition(int id, const QPoint &point);
+
+            /**
+             * @brief       Removes an icon from the engine.
+             *
+             * @param[in]   id the identifier of the icon.
+             */
+            void removeIcon(int id);
+
+            /**
+             * @brief       Removes all icons from the engine.
+             */
+            void clearIcons();
+
+            /**
+             * @brief       Finds the closest feature centroid to a point.
+             *
+             * @param[in]   point the point to search from.
+             * @param[out]  centroid the closest centroid.
+             *
+             * @returns     true if a centroid was found within the snap radius; otherwise false.
+             */
+            bool nearestCentroid(const QPointF &point, QPointF &centroid) const;
+
+            /**
+             * @brief       Returns the snapped position of an icon.
+             *
+             * @details     Features take priority over alignment to other icons, if grid snapping is enabled then
+             *              the grid overrides both.
+             *
+             * @param[in]   id the identifier of the icon being moved, it is excluded from icon alignment.
+             * @param[in]   point the proposed position of the icon.
+             * @param[in]   targets the types of target to snap to.
+             *
+             * @returns     the snapped position.
+             */
+            QPoint snap(int id, const QPoint &point, Targets targets) const;
+
+        private:
+            /**
+             * @brief       Returns the spatial hash key for a cell.
+             *
+             * @param[in]   column the column of the cell.
+             * @param[in]   row the row of the cell.
+             *
+             * @returns     the key.
+             */
+            static quint64 cellKey(int column, int row);
+
+            /**
+             * @brief       Returns the closest icon coordinate on one axis.
+             *
+             * @param[in]   axis the map of coordinates to icon identifiers for the axis.
+             * @param[in]   id the identifier of the icon being moved.
+             * @param[in]   value the proposed coordinate.
+             * @param[out]  aligned the coordinate to align to.
+             *
+             * @returns     true if an icon was found within the align radius; otherwise false.
+             */
+            bool nearestAxis(const QMultiMap<int, int> &axis, int id, int value, int &aligned) const;
+
+        private:
+            int m_snapRadius;                                   //! the snap radius for features
+            int m_alignRadius;                                  //! the align radius for icons
+            QSize m_gridSize;                                   //! the grid size
+
+            QVector<QPointF> m_centroids;                       //! the feature centroids
+            QHash<quint64, QVector<int> > m_cells;              //! the spatial hash, cell key to centroid indexes
+
+            QHash<int, QPoint> m_iconPositions;                 //! the icon positions by identifier
+            QMultiMap<int, int> m_iconsByX;                     //! x coordinate to icon identifier
+            QMultiMap<int, int> m_iconsByY;                     //! y coordinate to icon identifier
+    };
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Nedrysoft::SnapEngine::Targets)
+
+#endif //NEDRYSOFT_SNAPENGINE_H
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ToolProcess.h"
+
+#include <QProcess>
+
+constexpr auto processPollInterval = 100;                   //! how often a running tool is checked for cancellation (ms)
+
+Nedrysoft::ToolProcess::ToolProcess(LineFunction lineFunction, CancelFunction cancelFunction) :
+        m_lineFunction(std::move(lineFunction)),
+        m_cancelFunction(std::move(cancelFunction)) {
+
+}
+
+bool Nedrysoft::ToolProcess::Result::isSuccess() const {
+    return isStarted && (!isCancelled) && (exitCode==0);
+}
+
+Nedrysoft::ToolProcess::Result Nedrysoft::ToolProcess::run(const QString &program, const QStringList &arguments) const {
+    QByteArray pendingOutput, pendingError;
+    QProcess process;
+    Result result;
+
+    process.start(program, arguments);
+
+    if (!process.waitForStarted()) {
+        result.errorString = process.errorString();
+
+        return result;
+    }
+
+    result.isStarted = true;
+
+    // tools are never given any input, a tool that prompts then reads end of file rather than waiting forever
+
+    process.closeWriteChannel();
+
+    // waiting for standard output wakes as soon as a line is written, standard error is read into the buffer of the
+    // process at the same time.  A tool that has closed standard output is waited on until it exits instead.
+
+    while (process.state()!=QProcess::NotRunning) {
+        if (!process.waitForReadyRead(processPollInterval)) {
+            process.waitForFinished(processPollInterval);
+        }
+
+        readLines(process.readAllStandardOutput(), BuildEvent::StandardOutput, false, pendingOutput, result.standardOutput);
+        readLines(process.readAllStandardError(), BuildEvent::StandardError, false, pendingError, result.standardError);
+
+        if ((process.state()!=QProcess::NotRunning) && (m_cancelFunction) && (m_cancelFunction())) {
+            process.kill();
+            process.waitForFinished(-1);
+
+            result.isCancelled = true;
+
+            return result;
+        }
+    }
+
+    readLines(process.readAllStandardOutput(), BuildEvent::StandardOutput, true, pendingOutput, result.standardOutput);
+    readLines(process.readAllStandardError(), BuildEvent::StandardError, true, pendingError, result.standardError);
+
+    if (process.exitStatus()==QProcess::NormalExit) {
+        result.exitCode = process.exitCode();
+    }
+
+    return result;
+}
+
+void Nedrysoft::ToolProcess::readLines(const QByteArray &data, BuildEvent::Channel channel, bool isFinished, QByteArray &pending, QByteArray &output) const {
+    output.append(data);
+
+    if (!m_lineFunction) {
+        return;
+    }
+
+    pending.append(data);
+
+    auto lineStart = 0;
+    auto lineEnd = pending.indexOf('\n');
+
+    while (lineEnd!=-1) {
+        auto length = lineEnd-lineStart;
+
+        if ((length>0) && (pending.at(lineEnd-1)=='\r')) {
+            length--;
+        }
+
+        m_lineFunction(channel, QString::fromUtf8(pending.constData()+lineStart, length));
+
+        lineStart = lineEnd+1;
+        lineEnd = pending.indexOf('\n', lineStart);
+    }
+
+    pending.remove(0, lineStart);
+
+    if ((isFinished) && (!pending.isEmpty())) {
+        m_lineFunction(channel, QString::fromUtf8(pending));
+
+        pending.clear();
+    }
+}
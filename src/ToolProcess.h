@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 Adrian Carpenter
+ *
+ * This file is part of dmgee
+ *
+ * Created by Adrian Carpenter on 18/10/2026.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEDRYSOFT_TOOLPROCESS_H
+#define NEDRYSOFT_TOOLPROCESS_H
+
+#include "BuildEvent.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+namespace Nedrysoft {
+    /**
+     * @brief       The ToolProcess class runs a command line tool and streams its output a line at a time.
+     *
+     * @details     Standard output and standard error are read through pipes while the tool is running, so a tool
+     *              that writes a lot of output is never blocked on a full pipe and each line is passed on as soon as
+     *              it has been written rather than when the tool exits.  The complete output is also kept so that
+     *              it can be parsed once the tool has finished.
+     *
+     * @note        The tool is run on the calling thread, which waits for it to finish.  Qt file classes are used,
+     *              but an event loop is not needed.
+     */
+    class ToolProcess {
+        public:
+            /**
+             * @brief       Function called with each line that the tool writes.
+             *
+             * @param[in]   channel the stream that the line was written to.
+             * @param[in]   line the line, without the line ending.
+             */
+            using LineFunction = std::function<void(BuildEvent::Channel channel, const QString &line)>;
+
+            /**
+             * @brief       Function called while the tool is running to check whether it should be stopped.
+             *
+             * @returns     true if the tool should be killed; otherwise false.
+             */
+            using CancelFunction = std::function<bool()>;
+
+            /**
+             * @brief       Holds the result of running a tool.
+             */
+            struct Result {
+                bool isStarted = false;                         //! whether the tool was started
+                bool isCancelled = false;                       //! whether the tool was killed because it was cancelled
+                int exitCode = -1;                              //! the exit code; or -1 if the tool did not exit normally
+                QByteArray standardOutput;                      //! everything that was written to standard output
+                QByteArray standardError;                       //! everything that was written to standard error
+                QString errorString;                            //! the reason the tool could not be started
+
+                /**
+                 * @brief       Returns whether the tool ran to completion with a zero exit code.
+                 *
+                 * @returns     true if the tool succeeded; otherwise false.
+                 */
+                bool isSuccess() const;
+            };
+
+        public:
+            /**
+             * @brief       Constructs a new ToolProcess instance.
+             *
+             * @param[in]   lineFunction the function called with each line; or nullptr if lines are not needed.
+             * @param[in]   cancelFunction the function that is polled for cancellation; or nullptr.
+             */
+            explicit ToolProcess(LineFunction lineFunction = nullptr, CancelFunction cancelFunction = nullptr);
+
+            /**
+             * @brief       Runs a tool and waits for it to finish.
+             *
+             * @param[in]   program the path of the tool.
+             * @param[in]   arguments the arguments passed to the tool.
+             *
+             * @returns     the result.
+             */
+            Result run(const QString &program, const QStringList &arguments) const;
+
+        private:
+            /**
+             * @brief       Appends data read from a stream and passes on each line that has been completed.
+             *
+             * @param[in]   data the data that was read.
+             * @param[in]   channel the stream that the data was read from.
+             * @param[in]   isFinished true if the stream has ended, any partial line is then passed on.
+             * @param[in,out]   pending the start of a line that has not yet been completed.
+             * @param[in,out]   output the complete output of the stream.
+             */
+            void readLines(const QByteArray &data, BuildEvent::Channel channel, bool isFinished, QByteArray &pending, QByteArray &output) const;
+
+        private:
+            LineFunction m_lineFunction;                        //! called with each line
+            CancelFunction m_cancelFunction;                    //! polled for cancellation
+    };
+}
+
+#endif //NEDRYSOFT_TOOLPROCESS_H
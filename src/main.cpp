@@ -23,6 +23,9 @@
 
 #include "Python.h"
 
+#include "BuildQueue.h"
+#include "BuildWorker.h"
+#include "Builder.h"
 #include "CLI/CLI.hpp"
 #include "MainWindow.h"
 #include "SplashScreen.h"
@@ -31,11 +34,16 @@
 #include <QComboBox>
 #include <QDateTime>
 #include <QDirIterator>
+#include <QFileInfo>
 #include <QFontDatabase>
+#include <QJsonArray>
+#include <QList>
+#include <QMap>
 #include <QMimeDatabase>
 #include <QRegularExpression>
 #include <QResource>
 #include <QStyle>
+#include <QTimer>
 
 #include "SettingsManager.h"
 
@@ -95,6 +103,10 @@ int main(int argc, char *argv[]) {
     QMimeDatabase mimeDatabase;
     int returnValue = 0;
 
+    // the vendored python packages are imported from the bytecode archive that is embedded in the application
+
+    Nedrysoft::Python::setModuleArchive(":/python/packages.zip");
+
     CLI::App appCli(QCoreApplication::translate("cli","dmge² is an application for designing and creating custom DMG images.").toStdString(), APPLICATION_SHORT_NAME);
 
     auto versionString = QString("%1.%2.%3 (%4 %5)")
@@ -107,16 +119,36 @@ int main(int argc, char *argv[]) {
 
     std::string configFilename;
     std::string dmgFilename;
+    std::vector<std::string> buildFilenames;
+    std::string workerServerName;
+    std::string traceFilename;
+    std::string imageBackendName;
+    int maximumJobs = 0;
+    int buildTimeout = 0;
 
     auto configOption = appCli.add_option("-c, --config", configFilename, QCoreApplication::translate("cli","the filename of the configuration file to be used to generate the DMG").toUtf8().data());
     auto outputOption = appCli.add_option("-o, --output", dmgFilename, QCoreApplication::translate("cli", "the filename of the created DMG. (overrides value in config file)").toUtf8().data());
     auto editOption = appCli.add_option("-e, --edit", nullptr, QCoreApplication::translate("cli", "Whether to open the editor (default false)").toUtf8().data());
-    auto buildOption = appCli.add_option("-b, --build", nullptr, QCoreApplication::translate("cli", "Uses the given configuration to build the DMG").toUtf8().data());
+    auto buildOption = appCli.add_option("-b, --build", buildFilenames, QCoreApplication::translate("cli", "Uses the given configurations to build the DMGs, several configurations are built at the same time").toUtf8().data());
+    auto jobsOption = appCli.add_option("-j, --jobs", maximumJobs, QCoreApplication::translate("cli", "the maximum number of DMGs to build at the same time (default is the number of processor cores)").toUtf8().data());
     auto webEngineOption = appCli.add_option("--remote-debugging-port", nullptr, QCoreApplication::translate("cli", "Uses the given configuration to build the DMG").toUtf8().data());
     auto defineOption = appCli.add_option("-d, --define", nullptr, QCoreApplication::translate("cli", "add a define, used to set the value of a placeholder.").toUtf8().data());
+    auto noCacheFlag = appCli.add_flag("--no-cache", QCoreApplication::translate("cli", "always build, even if an image built from the same inputs is in the cache").toUtf8().data());
+    auto cacheLinkFlag = appCli.add_flag("--cache-link", QCoreApplication::translate("cli", "hard links cached images to the output rather than copying them, the output must then not be modified (e.g. signed or stapled)").toUtf8().data());
+    auto timeoutOption = appCli.add_option("--timeout", buildTimeout, QCoreApplication::translate("cli", "cancels any build that takes longer than the given number of seconds").toUtf8().data());
+    auto traceOption = appCli.add_option("--trace", traceFilename, QCoreApplication::translate("cli", "writes the timed phases of each build to the given file in the Chrome trace format").toUtf8().data());
+    auto profileFlag = appCli.add_flag("--profile", QCoreApplication::translate("cli", "profiles the build scripts and prints the functions that took the most time").toUtf8().data());
+    auto imageBackendOption = appCli.add_option("--image-backend", imageBackendName, QCoreApplication::translate("cli", "the backend used to create images, hdiutil or directory (default is hdiutil on macOS)").toUtf8().data());
+    auto workerOption = appCli.add_option("--worker", workerServerName, "internal, runs builds for the process listening on the given server");
+
+    // --worker is only used when the editor starts a build worker, so it is left out of the help
+
+    workerOption->group("");
 
-    buildOption->needs(configOption);
-    buildOption->needs(outputOption);
+    jobsOption->needs(buildOption);
+    timeoutOption->needs(buildOption);
+    traceOption->needs(buildOption);
+    profileFlag->needs(buildOption);
 
     editOption->required(false);
 
@@ -132,7 +164,143 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    if ((editOption->count()) || (!buildOption->count())) {
+    if (imageBackendOption->count()) {
+        auto imageBackend = Nedrysoft::Builder::createImageBackend(QString::fromStdString(imageBackendName));
+
+        if (!imageBackend) {
+            std::cerr << QCoreApplication::translate("cli", "unknown image backend %1.").arg(QString::fromStdString(imageBackendName)).toStdString() << std::endl;
+
+            return 1;
+        }
+
+        delete imageBackend;
+
+        // the backend is passed through the environment so that build workers use it as well
+
+        qputenv(Nedrysoft::Builder::ImageBackendVariable, imageBackendName.c_str());
+    }
+
+    if (workerOption->count()) {
+        Nedrysoft::BuildWorker buildWorker(QString::fromStdString(workerServerName));
+
+        Nedrysoft::Python::initialise(QStringList() << "dmgbuild");
+
+        if (buildWorker.connectToServer()) {
+            QObject::connect(&buildWorker, &Nedrysoft::BuildWorker::quit, &application, &QApplication::quit, Qt::QueuedConnection);
+
+            returnValue = application.exec();
+        } else {
+            returnValue = 1;
+        }
+    } else if ((!editOption->count()) && (buildOption->count())) {
+        // build every configuration given on the command line, -c is accepted as an additional configuration
+
+        if (configOption->count()) {
+            buildFilenames.push_back(configFilename);
+        }
+
+        if ((outputOption->count()) && (buildFilenames.size()>1)) {
+            std::cerr << QCoreApplication::translate("cli", "--output can only be used when building a single configuration.").toStdString() << std::endl;
+
+            return 1;
+        }
+
+        Nedrysoft::BuildQueue buildQueue;
+        QList<int> buildIds;
+        auto buildFailed = false;
+
+        if (maximumJobs>0) {
+            buildQueue.setMaximumJobs(maximumJobs);
+        }
+
+        buildQueue.setCacheEnabled(!noCacheFlag->count());
+        buildQueue.setCacheLinkEnabled(cacheLinkFlag->count());
+        buildQueue.setTimeout(buildTimeout*1000);
+        buildQueue.setProfiling(profileFlag->count());
+
+        QObject::connect(&buildQueue, &Nedrysoft::BuildQueue::jobLog, [&buildQueue](int id, QString line) {
+            auto configName = QFileInfo(buildQueue.configurationFilename(id)).completeBaseName();
+
+            std::cout << "[" << configName.toStdString() << "] " << line.toStdString() << std::endl;
+        });
+
+        // progress is printed every 10%, with the estimate of the time left once there is one
+
+        QMap<int, int> reportedProgress;
+
+        QObject::connect(&buildQueue, &Nedrysoft::BuildQueue::jobProgress, [&buildQueue, &reportedProgress](int id, int value, int maximum) {
+            auto configName = QFileInfo(buildQueue.configurationFilename(id)).completeBaseName();
+            auto percentage = (maximum>0) ? (value*100)/maximum : 0;
+            auto remainingTime = buildQueue.remainingTime(id);
+
+            if ((percentage/10)<=reportedProgress.value(id, 0)) {
+                return;
+            }
+
+            reportedProgress[id] = percentage/10;
+
+            auto progressText = QCoreApplication::translate("cli", "%1% complete").arg(percentage);
+
+            if ((remainingTime>0) && (percentage<100)) {
+                progressText += ", "+QCoreApplication::translate("cli", "about %1 remaining").arg(Nedrysoft::BuildProgress::durationString(remainingTime));
+            }
+
+            std::cout << "[" << configName.toStdString() << "] " << progressText.toStdString() << std::endl;
+        });
+
+        QObject::connect(&buildQueue, &Nedrysoft::BuildQueue::jobFinished, [&buildQueue, &buildFailed](int id, Nedrysoft::BuildQueue::State state) {
+            auto configName = QFileInfo(buildQueue.configurationFilename(id)).completeBaseName();
+
+            if (state!=Nedrysoft::BuildQueue::Finished) {
+                std::cerr << "[" << configName.toStdString() << "] " << QCoreApplication::translate("cli", "build failed.").toStdString() << std::endl;
+
+                buildFailed = true;
+            }
+        });
+
+        QObject::connect(&buildQueue, &Nedrysoft::BuildQueue::idle, &application, &QApplication::quit, Qt::QueuedConnection);
+
+        for (auto const &buildFilename : buildFilenames) {
+            auto filename = QString::fromStdString(buildFilename);
+
+            auto buildId = buildQueue.enqueue(filename, QString::fromStdString(dmgFilename));
+
+            if (buildId==-1) {
+                std::cerr << QCoreApplication::translate("cli", "unable to load configuration %1.").arg(filename).toStdString() << std::endl;
+
+                buildFailed = true;
+            } else {
+                buildIds.append(buildId);
+            }
+        }
+
+        if (!buildQueue.isIdle()) {
+            application.exec();
+        }
+
+        if (traceOption->count()) {
+            // each configuration is shown as its own process in the trace
+
+            QJsonArray traceEvents;
+            QString traceError;
+
+            for (auto const &buildId : buildIds) {
+                auto configName = QFileInfo(buildQueue.configurationFilename(buildId)).completeBaseName();
+
+                for (auto const &traceEvent : buildQueue.trace(buildId).traceEvents(buildId+1, configName)) {
+                    traceEvents.append(traceEvent);
+                }
+            }
+
+            if (!Nedrysoft::BuildTrace::save(QString::fromStdString(traceFilename), traceEvents, &traceError)) {
+                std::cerr << QCoreApplication::translate("cli", "unable to write trace %1 (%2).").arg(QString::fromStdString(traceFilename)).arg(traceError).toStdString() << std::endl;
+
+                buildFailed = true;
+            }
+        }
+
+        returnValue = buildFailed ? 1 : 0;
+    } else {
         // search the /fonts folder in the resources and attempt to load any found fonts
 
         auto fontDirIterator = QDirIterator(applicationFontsPrefix, QDirIterator::Subdirectories);
@@ -164,10 +332,19 @@ int main(int argc, char *argv[]) {
 
         mainWindow->show();
 
+        // start python once the window is visible, the build modules are imported in the background so that the
+        // first build does not have to wait for them.
+
+        QTimer::singleShot(0, []() {
+            Nedrysoft::Python::initialise(QStringList() << "dmgbuild");
+        });
+
         returnValue = application.exec();
 
         delete mainWindow;
     }
 
+    Nedrysoft::Python::shutdown();
+
     return returnValue;
 }
\ No newline at end of file